@@ -0,0 +1,386 @@
+// arrayFunctionalHelpers.h
+
+// Versions of some of the functions in functionalHelpers.h that take and
+// return std::arrays, and can be evaluated at compile time, e.g.
+//
+//     constexpr auto squares = mapRange<256>([] (int x) { return x*x; });
+//     constexpr auto table = sorted(map(squares, hashOf));
+//
+// so that lookup tables can be built into the program rather than at
+// startup. Since the size of a std::array is part of its type, map, sorted
+// and range<N> return a std::array of the same size, while filter and reject
+// return a BoundedArray, which holds up to the same number of values along
+// with how many of them were kept.
+//
+// The values must be default constructible, and anything called on them must
+// be constexpr for a result to be computed at compile time. Lambdas are
+// constexpr whenever they can be. The functions work at run time too, but
+// adding or comparing values one at a time rather than with the vectorized
+// kernels of functionalHelpers.h, so that a sum gives the same result either
+// way.
+//
+// Requires C++17. If using Qt, include qtFunctionalHelpers.h before this file.
+
+#ifndef ARRAY_FUNCTIONAL_HELPERS_H_GUARD
+#define ARRAY_FUNCTIONAL_HELPERS_H_GUARD
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+#include <functionalHelpers.h>
+
+namespace FuncHelpUtils {
+    // std::invoke isn't constexpr until C++20, so member function pointers
+    // are called here the same way that std::ref would call them.
+    template <class F, class T>
+    constexpr decltype(auto) constexprCall(const F &func, const T &val)
+    {
+        if constexpr (std::is_member_function_pointer<F>::value) {
+            return (val.*func)();
+        } else if constexpr (std::is_member_object_pointer<F>::value) {
+            return val.*func;
+        } else {
+            return func(val);
+        }
+    }
+
+    template <class F, class T>
+    constexpr bool constexprCompare(const F &comp, const T &a, const T &b)
+    {
+        if constexpr (std::is_member_function_pointer<F>::value) {
+            return bool((a.*comp)(b));
+        } else {
+            return bool(comp(a, b));
+        }
+    }
+
+    template <class T>
+    struct ConstexprLess {
+        constexpr bool operator()(const T &a, const T &b) const { return a < b; }
+    };
+
+    // std::swap isn't constexpr until C++20 either.
+    template <class T>
+    constexpr void constexprSwap(T &a, T &b)
+    {
+        T temp = std::move(a);
+        a = std::move(b);
+        b = std::move(temp);
+    }
+
+    // Before C++20 made std::sort constexpr, arrays are heap sorted, which
+    // takes O(N log N) time without needing any extra space.
+    template <class T, size_t N, class F>
+    constexpr void siftDown(std::array<T, N> &array, size_t root, size_t end, const F &comp)
+    {
+        for(size_t child = 2*root + 1; child < end; child = 2*root + 1) {
+            if (child + 1 < end && constexprCompare(comp, array[child], array[child + 1])) {
+                ++child;
+            }
+
+            if (!constexprCompare(comp, array[root], array[child])) {
+                return;
+            }
+
+            constexprSwap(array[root], array[child]);
+            root = child;
+        }
+    }
+
+    template <class T, size_t N, class F>
+    constexpr void sortArray(std::array<T, N> &array, const F &comp)
+    {
+#if defined(__cpp_lib_constexpr_algorithms)
+        std::sort(array.begin(), array.end(), [&comp] (const T &a, const T &b) { return constexprCompare(comp, a, b); });
+#else
+        for(size_t root = N/2; root > 0; --root) {
+            siftDown(array, root - 1, N, comp);
+        }
+
+        for(size_t end = N; end > 1; --end) {
+            constexprSwap(array[0], array[end - 1]);
+            siftDown(array, 0, end - 1, comp);
+        }
+#endif
+    }
+}
+
+// BoundedArray<T, N> holds up to N values of type T in a std::array, along
+// with the number of them that are in use. It's what filter and reject return
+// for a std::array, since how many values pass isn't part of the type.
+template <class T, size_t N>
+class BoundedArray {
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using reference = T &;
+    using const_reference = const T &;
+    using iterator = typename std::array<T, N>::iterator;
+    using const_iterator = typename std::array<T, N>::const_iterator;
+
+    constexpr BoundedArray() : values(), count(0) {}
+
+    constexpr iterator begin() { return values.begin(); }
+    constexpr iterator end() { return values.begin() + count; }
+    constexpr const_iterator begin() const { return values.begin(); }
+    constexpr const_iterator end() const { return values.begin() + count; }
+    constexpr const_iterator cbegin() const { return values.begin(); }
+    constexpr const_iterator cend() const { return values.begin() + count; }
+
+    constexpr T *data() { return values.data(); }
+    constexpr const T *data() const { return values.data(); }
+    constexpr size_t size() const { return count; }
+    constexpr bool empty() const { return count == 0; }
+    static constexpr size_t capacity() { return N; }
+
+    constexpr T &operator[](size_t index) { return values[index]; }
+    constexpr const T &operator[](size_t index) const { return values[index]; }
+
+    // The values in use, with the rest of the array default constructed.
+    constexpr const std::array<T, N> &array() const { return values; }
+
+    constexpr void push_back(const T &val) { values[count++] = val; }
+
+    constexpr bool operator==(const BoundedArray &other) const
+    {
+        if (count != other.count) {
+            return false;
+        }
+
+        for(size_t i = 0; i < count; ++i) {
+            if (!(values[i] == other.values[i])) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    constexpr bool operator!=(const BoundedArray &other) const { return !(*this == other); }
+
+private:
+    std::array<T, N> values;
+    size_t count;
+};
+
+namespace FuncHelpUtils {
+    template <class T, size_t N, class F, bool Keep>
+    constexpr BoundedArray<T, N> filterArray(const std::array<T, N> &array, const F &predicate)
+    {
+        BoundedArray<T, N> result;
+
+        for(const T &val : array) {
+            if (bool(constexprCall(predicate, val)) == Keep) {
+                result.push_back(val);
+            }
+        }
+
+        return result;
+    }
+}
+
+// map
+
+template <class T,
+          size_t N,
+          class F>
+constexpr auto map(const std::array<T, N> &array, const F &func)
+ -> std::array<FuncHelpUtils::func_result<const T, F>, N>
+{
+    std::array<FuncHelpUtils::func_result<const T, F>, N> result{};
+
+    for(size_t i = 0; i < N; ++i) {
+        result[i] = FuncHelpUtils::constexprCall(func, array[i]);
+    }
+
+    return result;
+}
+
+// filter and reject
+
+template <class T,
+          size_t N,
+          class F>
+constexpr auto filter(const std::array<T, N> &array, const F &predicate)
+ -> BoundedArray<T, N>
+{
+    return FuncHelpUtils::filterArray<T, N, F, true>(array, predicate);
+}
+
+template <class T,
+          size_t N,
+          class F>
+constexpr auto reject(const std::array<T, N> &array, const F &predicate)
+ -> BoundedArray<T, N>
+{
+    return FuncHelpUtils::filterArray<T, N, F, false>(array, predicate);
+}
+
+// reduce and sum
+
+template <class T,
+          size_t N,
+          class F>
+constexpr T reduce(const std::array<T, N> &array, const F &func)
+{
+    if constexpr (N == 0) {
+        (void)array;
+        (void)func;
+        return T();
+    } else {
+        T memo = array[0];
+
+        for(size_t i = 1; i < N; ++i) {
+            memo = func(T(memo), array[i]);
+        }
+
+        return memo;
+    }
+}
+
+template <class T,
+          size_t N,
+          class F,
+          class ValType>
+constexpr ValType reduce(const std::array<T, N> &array, const F &func, ValType memo)
+{
+    for(const T &val : array) {
+        memo = func(ValType(memo), val);
+    }
+
+    return memo;
+}
+
+template <class T,
+          size_t N>
+constexpr T sum(const std::array<T, N> &array)
+{
+    return reduce(array, [] (const T &a, const T &b) { return a+b; });
+}
+
+template <class T,
+          size_t N,
+          class ValType>
+constexpr T sum(const std::array<T, N> &array, ValType memo)
+{
+    return reduce(array, [] (const T &a, const T &b) { return a+b; }, T(memo));
+}
+
+// min and max return T() for an empty array.
+
+namespace FuncHelpUtils {
+    // The position of the first value with the smallest key, or with the
+    // largest when Largest is true.
+    template <bool Largest, class T, size_t N, class F>
+    constexpr size_t extremumIndex(const std::array<T, N> &array, const F &key)
+    {
+        size_t result = 0;
+
+        for(size_t i = 1; i < N; ++i) {
+            const bool better = Largest ? (constexprCall(key, array[result]) < constexprCall(key, array[i]))
+                                        : (constexprCall(key, array[i]) < constexprCall(key, array[result]));
+
+            if (better) {
+                result = i;
+            }
+        }
+
+        return result;
+    }
+
+    template <class T>
+    struct ConstexprIdentity {
+        constexpr const T &operator()(const T &val) const { return val; }
+    };
+
+    template <bool Largest, class T, size_t N, class F>
+    constexpr T extremumOfArray(const std::array<T, N> &array, const F &key)
+    {
+        if constexpr (N == 0) {
+            (void)array;
+            (void)key;
+            return T();
+        } else {
+            return array[extremumIndex<Largest>(array, key)];
+        }
+    }
+}
+
+template <class T,
+          size_t N>
+constexpr T min(const std::array<T, N> &array)
+{
+    return FuncHelpUtils::extremumOfArray<false>(array, FuncHelpUtils::ConstexprIdentity<T>());
+}
+
+template <class T,
+          size_t N,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_callable<F, const T &>::value> >
+constexpr T min(const std::array<T, N> &array, const F &func)
+{
+    return FuncHelpUtils::extremumOfArray<false>(array, func);
+}
+
+template <class T,
+          size_t N>
+constexpr T max(const std::array<T, N> &array)
+{
+    return FuncHelpUtils::extremumOfArray<true>(array, FuncHelpUtils::ConstexprIdentity<T>());
+}
+
+template <class T,
+          size_t N,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_callable<F, const T &>::value> >
+constexpr T max(const std::array<T, N> &array, const F &func)
+{
+    return FuncHelpUtils::extremumOfArray<true>(array, func);
+}
+
+// sorted
+
+template <class T,
+          size_t N>
+constexpr std::array<T, N> sorted(std::array<T, N> array)
+{
+    FuncHelpUtils::sortArray(array, FuncHelpUtils::ConstexprLess<T>());
+    return array;
+}
+
+template <class T,
+          size_t N,
+          class F>
+constexpr std::array<T, N> sorted(std::array<T, N> array, const F &comp)
+{
+    FuncHelpUtils::sortArray(array, comp);
+    return array;
+}
+
+// range<N> and mapRange<N>
+
+// range<N>(start, inc) is an array of the N values start, start + inc, etc.
+template <size_t N,
+          class T = int>
+constexpr std::array<T, N> range(T start = T(0), T inc = T(1))
+{
+    std::array<T, N> result{};
+
+    for(size_t i = 0; i < N; ++i) {
+        result[i] = T(start + T(i) * inc);
+    }
+
+    return result;
+}
+
+// mapRange<N>(func) is an array of func(0), func(1), ..., func(N - 1).
+template <size_t N,
+          class F>
+constexpr auto mapRange(const F &func)
+ -> std::array<FuncHelpUtils::func_result<const int, F>, N>
+{
+    return map(range<N>(), func);
+}
+
+#endif // ARRAY_FUNCTIONAL_HELPERS_H_GUARD
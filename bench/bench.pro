@@ -0,0 +1,17 @@
+QT += core
+QT -= gui
+
+CONFIG += c++11 release
+CONFIG -= debug
+
+TARGET = cpp-functional-helpers-bench
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += main.cpp
+HEADERS += ../functionalHelpers.h \
+           ../qtFunctionalHelpers.h \
+           ../parallelFunctionalHelpers.h
+INCLUDEPATH += ..
@@ -0,0 +1,1089 @@
+#ifdef QT_CORE_LIB
+#include <qtFunctionalHelpers.h>
+#include <QLinkedList>
+#else
+#include <functionalHelpers.h>
+#endif
+#include <parallelFunctionalHelpers.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Benchmarks for functionalHelpers.h, and qtFunctionalHelpers.h when built
+// with Qt. Each helper is timed against a hand-written loop doing the same
+// work and, where there is one, the matching <algorithm> call, for every
+// container family, several element sizes and a range of container sizes.
+//
+// The results are written as JSON so that runs against different versions of
+// the headers can be compared. Each result records the helper, the variant
+// ("helper", "loop" or "algorithm"), the container, the element type and
+// size, n, and the time taken.
+//
+// Usage:
+//   cpp-functional-helpers-bench [--max-n N] [--max-bytes N] [--min-time-ms N]
+//                                [--filter TEXT] [--out FILE] [--quick]
+//
+// --max-n        largest container size to run (default 100000000)
+// --max-bytes    skip sizes where a container would take more memory than this
+//                (default 268435456)
+// --min-time-ms  how long to keep repeating each measurement (default 20)
+// --filter       only run benchmarks whose "helper/container/element" name
+//                contains TEXT
+// --out          write the JSON to FILE rather than stdout
+// --quick        shorthand for --max-n 10000 --min-time-ms 1, for checking
+//                that everything runs
+
+// An element type that's Size bytes large. Only key takes part in
+// comparisons.
+template <size_t Size>
+struct Payload {
+    Payload(uint32_t k = 0) : key(k) { std::memset(padding, 0, sizeof(padding)); }
+    bool operator==(const Payload &other) const { return key == other.key; }
+    bool operator<(const Payload &other) const { return key < other.key; }
+    bool operator>(const Payload &other) const { return key > other.key; }
+    Payload operator+(const Payload &other) const { return Payload(key + other.key); }
+
+    uint32_t key;
+    char padding[Size - sizeof(uint32_t)];
+};
+
+namespace std {
+    template <size_t Size>
+    struct hash<Payload<Size> > {
+        size_t operator()(const Payload<Size> &value) const { return std::hash<uint32_t>()(value.key); }
+    };
+}
+
+#ifdef QT_CORE_LIB
+template <size_t Size>
+uint qHash(const Payload<Size> &value, uint seed = 0) { return qHash(value.key, seed); }
+#endif
+
+uint32_t keyOf(int value) { return uint32_t(value); }
+uint32_t keyOf(char value) { return uint32_t(value); }
+template <size_t Size>
+uint32_t keyOf(const Payload<Size> &value) { return value.key; }
+
+template <class T>
+T makeValue(uint32_t key) { return T(key); }
+template <>
+int makeValue<int>(uint32_t key) { return int(key & 0x3fffffff); }
+template <>
+char makeValue<char>(uint32_t key) { return char('a' + key % 26); }
+
+// Spreads keys out so that containers aren't already sorted, while keeping
+// them unique and keeping their parity the same as i's.
+uint32_t scrambledKey(size_t i) { return uint32_t(i) * 2654435761u; }
+
+template <class T>
+T bumped(const T &value) { return makeValue<T>(keyOf(value) + 2); }
+
+template <class T>
+bool isEvenKey(const T &value) { return (keyOf(value) % 2) == 0; }
+
+template <class T>
+const char *elementName();
+template <> const char *elementName<int>() { return "int"; }
+template <> const char *elementName<char>() { return "char"; }
+template <> const char *elementName<Payload<16> >() { return "Payload<16>"; }
+template <> const char *elementName<Payload<64> >() { return "Payload<64>"; }
+template <> const char *elementName<Payload<256> >() { return "Payload<256>"; }
+
+// Prevents the compiler from optimizing away a result that's never used.
+template <class T>
+void keep(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static const void *volatile sink;
+    sink = &value;
+#endif
+}
+
+// Appends values to a container the way hand-written code would.
+template <class Container>
+class Appender {
+public:
+    explicit Appender(Container &container) : container(container) {}
+    template <class V> void operator()(const V &value) { container.push_back(value); }
+private:
+    Container &container;
+};
+
+template <class T>
+class Appender<std::set<T> > {
+public:
+    explicit Appender(std::set<T> &container) : container(container) {}
+    void operator()(const T &value) { container.insert(container.end(), value); }
+private:
+    std::set<T> &container;
+};
+
+template <class T>
+class Appender<std::forward_list<T> > {
+public:
+    explicit Appender(std::forward_list<T> &container) : container(container), tail(container.before_begin()) {}
+    void operator()(const T &value) { tail = container.insert_after(tail, value); }
+private:
+    std::forward_list<T> &container;
+    typename std::forward_list<T>::iterator tail;
+};
+
+#ifdef QT_CORE_LIB
+template <class T>
+class Appender<QSet<T> > {
+public:
+    explicit Appender(QSet<T> &container) : container(container) {}
+    void operator()(const T &value) { container.insert(value); }
+private:
+    QSet<T> &container;
+};
+#endif
+
+// An output iterator that uses Appender, so that <algorithm> calls can write
+// into any of the containers.
+template <class Container>
+class AppendIterator {
+public:
+    using iterator_category = std::output_iterator_tag;
+    using value_type = void;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = void;
+
+    explicit AppendIterator(Container &container) : appender(container) {}
+    template <class V> AppendIterator &operator=(const V &value) { appender(value); return *this; }
+    AppendIterator &operator*() { return *this; }
+    AppendIterator &operator++() { return *this; }
+    AppendIterator &operator++(int) { return *this; }
+private:
+    Appender<Container> appender;
+};
+
+template <class Container>
+AppendIterator<Container> appendTo(Container &container) { return AppendIterator<Container>(container); }
+
+template <class Container>
+void loopReserve(Container &, size_t) {}
+template <class T>
+void loopReserve(std::vector<T> &container, size_t size) { container.reserve(size); }
+void loopReserve(std::string &container, size_t size) { container.reserve(size); }
+#ifdef QT_CORE_LIB
+template <class T>
+void loopReserve(QVector<T> &container, size_t size) { container.reserve(int(size)); }
+template <class T>
+void loopReserve(QList<T> &container, size_t size) { container.reserve(int(size)); }
+#endif
+
+// Sorts a copy of a container using whatever <algorithm> or member function
+// applies to it.
+template <class Container>
+void algorithmSort(Container &container, std::random_access_iterator_tag) { std::sort(container.begin(), container.end()); }
+template <class Container>
+void algorithmSort(Container &container, std::bidirectional_iterator_tag) { container.sort(); }
+template <class Container>
+void algorithmSort(Container &container, std::forward_iterator_tag) { container.sort(); }
+template <class T>
+void algorithmSort(std::set<T> &, std::bidirectional_iterator_tag) {}
+#ifdef QT_CORE_LIB
+template <class T>
+void algorithmSort(QSet<T> &, std::forward_iterator_tag) {}
+template <class T>
+void algorithmSort(QLinkedList<T> &container, std::bidirectional_iterator_tag)
+{
+    std::vector<T> values(container.begin(), container.end());
+    std::sort(values.begin(), values.end());
+    std::copy(values.begin(), values.end(), container.begin());
+}
+#endif
+
+template <class Container>
+using iterator_category = typename std::iterator_traits<typename Container::const_iterator>::iterator_category;
+
+template <class Container>
+using is_random_access = std::is_base_of<std::random_access_iterator_tag, iterator_category<Container> >;
+
+// Running benchmarks
+
+struct Options {
+    size_t maxN = 100000000;
+    size_t maxBytes = size_t(1) << 28;
+    double minTimeMs = 20;
+    std::string filter;
+    std::string outPath;
+};
+
+class Runner {
+public:
+    explicit Runner(const Options &options) : options(options) {}
+
+    // Sets what the following calls to measure are benchmarking.
+    void setCase(const char *container, const char *element, size_t elementSize, size_t n)
+    {
+        this->container = container;
+        this->element = element;
+        this->elementSize = elementSize;
+        this->n = n;
+    }
+
+    bool wants(const char *helper) const
+    {
+        if (options.filter.empty()) {
+            return true;
+        }
+
+        std::string name = std::string(helper) + "/" + container + "/" + element;
+        return name.find(options.filter) != std::string::npos;
+    }
+
+    template <class F>
+    void measure(const char *helper, const char *variant, const F &func)
+    {
+        if (!wants(helper)) {
+            return;
+        }
+
+        using Clock = std::chrono::steady_clock;
+        keep(func());
+
+        double totalNs = 0;
+        double bestNs = 0;
+        size_t iterations = 0;
+
+        while(iterations == 0 || totalNs < options.minTimeMs * 1e6) {
+            Clock::time_point start = Clock::now();
+            keep(func());
+            double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+
+            totalNs += ns;
+            bestNs = (iterations == 0 || ns < bestNs) ? ns : bestNs;
+            ++iterations;
+        }
+
+        std::ostringstream json;
+        json << "{\"helper\": \"" << helper << "\", \"variant\": \"" << variant
+             << "\", \"container\": \"" << container << "\", \"element\": \"" << element
+             << "\", \"elementSize\": " << elementSize << ", \"n\": " << n
+             << ", \"iterations\": " << iterations << ", \"meanNs\": " << totalNs / iterations
+             << ", \"minNs\": " << bestNs << ", \"nsPerItem\": " << (n ? totalNs / iterations / n : 0.0) << "}";
+        results.push_back(json.str());
+        std::fprintf(stderr, "%-16s %-10s %-24s %-13s n=%-10zu %14.0f ns\n",
+                     helper, variant, container, element, n, totalNs / iterations);
+    }
+
+    void write() const
+    {
+        FILE *out = options.outPath.empty() ? stdout : std::fopen(options.outPath.c_str(), "w");
+
+        if (!out) {
+            std::fprintf(stderr, "Couldn't open %s\n", options.outPath.c_str());
+            std::exit(1);
+        }
+
+        std::fprintf(out, "{\n  \"compiler\": \"%s\",\n  \"cplusplus\": %ld,\n  \"qt\": %s,\n  \"threads\": %u,\n"
+                          "  \"minTimeMs\": %g,\n  \"results\": [\n",
+                     compilerName(), long(__cplusplus),
+#ifdef QT_CORE_LIB
+                     "\"" QT_VERSION_STR "\"",
+#else
+                     "null",
+#endif
+                     std::thread::hardware_concurrency(), options.minTimeMs);
+
+        for(size_t i = 0; i < results.size(); ++i) {
+            std::fprintf(out, "    %s%s\n", results[i].c_str(), (i + 1 < results.size()) ? "," : "");
+        }
+
+        std::fprintf(out, "  ]\n}\n");
+
+        if (out != stdout) {
+            std::fclose(out);
+        }
+    }
+
+    const Options options;
+
+private:
+    static const char *compilerName()
+    {
+#if defined(__clang__)
+        return "clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc";
+#else
+        return "unknown";
+#endif
+    }
+
+    const char *container = "";
+    const char *element = "";
+    size_t elementSize = 0;
+    size_t n = 0;
+    std::vector<std::string> results;
+};
+
+// The header can't sort sets, and can't build, take the size of or walk
+// backwards through containers like std::forward_list, so the benchmarks of
+// helpers that need to are only run for containers that support them.
+
+template <class Container>
+void benchSorted(Runner &, const Container &, std::false_type) {}
+
+template <class Container>
+void benchSorted(Runner &runner, const Container &data, std::true_type)
+{
+    runner.measure("sorted", "helper", [&] () { return sorted(data); });
+    runner.measure("sorted", "algorithm", [&] () {
+        Container result(data);
+        algorithmSort(result, iterator_category<Container>());
+        return result;
+    });
+
+    runner.measure("stableSorted", "helper", [&] () { return stableSorted(data); });
+
+    // sortedBy with an integer key, which is radix sorted, and with a key
+    // that has to be compared
+    using T = typename Container::value_type;
+    runner.measure("sortedBy", "helper", [&] () { return sortedBy(data, [] (const T &x) { return keyOf(x); }); });
+    runner.measure("sortedBy", "sorted", [&] () {
+        return sorted(data, [] (const T &a, const T &b) { return keyOf(a) < keyOf(b); });
+    });
+    runner.measure("sortedBy(pair)", "helper", [&] () {
+        return sortedBy(data, [] (const T &x) { return std::make_pair(keyOf(x) % 97, keyOf(x)); });
+    });
+    runner.measure("sortedBy(pair)", "sorted", [&] () {
+        return sorted(data, [] (const T &a, const T &b) {
+            return std::make_pair(keyOf(a) % 97, keyOf(a)) < std::make_pair(keyOf(b) % 97, keyOf(b));
+        });
+    });
+}
+
+template <class Container, class T>
+void benchBuilding(Runner &, const Container &, const T &, const std::vector<T> &, std::false_type) {}
+
+template <class Container, class T>
+void benchBuilding(Runner &runner, const Container &data, const T &present, const std::vector<T> &others, std::true_type)
+{
+    const size_t n = size_t(FuncHelpUtils::sizeHint(data));
+    auto f = [] (const T &x) { return bumped(x); };
+    auto predicate = [] (const T &x) { return isEvenKey(x); };
+    auto rejectPredicate = [] (const T &x) { return !isEvenKey(x); };
+    Container buffer;
+
+    // map
+    runner.measure("map", "helper", [&] () { return ::map(data, f); });
+    runner.measure("map", "loop", [&] () {
+        Container result;
+        loopReserve(result, n);
+        Appender<Container> append(result);
+
+        for(auto const &x : data) {
+            append(f(x));
+        }
+
+        return result;
+    });
+    runner.measure("map", "algorithm", [&] () {
+        Container result;
+        loopReserve(result, n);
+        std::transform(data.begin(), data.end(), appendTo(result), f);
+        return result;
+    });
+    runner.measure("mapInto", "helper", [&] () { return mapInto(buffer, data, f).size(); });
+
+    // compr
+    runner.measure("compr", "helper", [&] () { return compr(data, f, predicate); });
+    runner.measure("compr", "loop", [&] () {
+        Container result;
+        Appender<Container> append(result);
+
+        for(auto const &x : data) {
+            if (predicate(x)) {
+                append(f(x));
+            }
+        }
+
+        return result;
+    });
+
+    // filter
+    runner.measure("filter", "helper", [&] () { return filter(data, predicate); });
+    runner.measure("filter", "loop", [&] () {
+        Container result;
+        Appender<Container> append(result);
+
+        for(auto const &x : data) {
+            if (predicate(x)) {
+                append(x);
+            }
+        }
+
+        return result;
+    });
+    runner.measure("filter", "algorithm", [&] () {
+        Container result;
+        std::copy_if(data.begin(), data.end(), appendTo(result), predicate);
+        return result;
+    });
+    runner.measure("filterInto", "helper", [&] () { return filterInto(buffer, data, predicate).size(); });
+
+    // filter keeping only a few values, into a std::vector or a SmallVector
+    auto rare = [] (const T &x) { return (keyOf(x) % 16) == 0; };
+    runner.measure("filter(few)", "vector", [&] () { return filter<std::vector>(data, rare); });
+    runner.measure("filter(few)", "SmallVector", [&] () { return filter<SmallVector>(data, rare); });
+
+    // reject
+    runner.measure("reject", "helper", [&] () { return reject(data, rejectPredicate); });
+    runner.measure("reject", "loop", [&] () {
+        Container result;
+        Appender<Container> append(result);
+
+        for(auto const &x : data) {
+            if (!rejectPredicate(x)) {
+                append(x);
+            }
+        }
+
+        return result;
+    });
+    runner.measure("reject", "algorithm", [&] () {
+        Container result;
+        std::remove_copy_if(data.begin(), data.end(), appendTo(result), rejectPredicate);
+        return result;
+    });
+
+    // partition
+    runner.measure("partition", "helper", [&] () { return partition(data, predicate); });
+    runner.measure("partition", "loop", [&] () {
+        std::pair<Container, Container> result;
+        Appender<Container> appendPassed(result.first);
+        Appender<Container> appendFailed(result.second);
+
+        for(auto const &x : data) {
+            if (predicate(x)) {
+                appendPassed(x);
+            } else {
+                appendFailed(x);
+            }
+        }
+
+        return result;
+    });
+    runner.measure("partition", "algorithm", [&] () {
+        std::pair<Container, Container> result;
+        std::partition_copy(data.begin(), data.end(), appendTo(result.first), appendTo(result.second), predicate);
+        return result;
+    });
+    runner.measure("partitionBy", "helper", [&] () {
+        return partitionBy(data, [] (const T &x) { return int(keyOf(x) % 4); }, 4);
+    });
+
+    // groupBy, countBy and keyBy, into 1024 keys
+    auto bucket = [] (const T &x) { return keyOf(x) % 1024; };
+    runner.measure("groupBy", "helper", [&] () { return groupBy(data, bucket); });
+    runner.measure("groupBy", "loop", [&] () {
+        std::unordered_map<uint32_t, Container> result;
+
+        for(auto const &x : data) {
+            Appender<Container> append(result[bucket(x)]);
+            append(x);
+        }
+
+        return result;
+    });
+    runner.measure("countBy", "helper", [&] () { return countBy(data, bucket); });
+    runner.measure("countBy", "loop", [&] () {
+        std::unordered_map<uint32_t, size_t> result;
+
+        for(auto const &x : data) {
+            ++result[bucket(x)];
+        }
+
+        return result;
+    });
+    runner.measure("keyBy", "helper", [&] () { return keyBy(data, bucket); });
+
+    // minN, maxN and topK, selecting 10 values
+    const int best = 10;
+    runner.measure("minN", "helper", [&] () { return minN(data, best); });
+    runner.measure("minN", "sorted", [&] () {
+        std::vector<T> all(data.begin(), data.end());
+        std::sort(all.begin(), all.end());
+        all.resize(std::min(all.size(), size_t(best)));
+        return all;
+    });
+    runner.measure("minN", "algorithm", [&] () {
+        std::vector<T> result(std::min(size_t(data.size()), size_t(best)));
+        std::partial_sort_copy(data.begin(), data.end(), result.begin(), result.end());
+        return result;
+    });
+    runner.measure("maxN(func)", "helper", [&] () { return maxN(data, best, [] (const T &x) { return keyOf(x); }); });
+    runner.measure("topK", "helper", [&] () { return topK(data, best, [] (const T &a, const T &b) { return b < a; }); });
+
+    // omit and set algebra
+    runner.measure("omit(value)", "helper", [&] () { return omit(data, present); });
+    runner.measure("omit(value)", "algorithm", [&] () {
+        Container result;
+        std::remove_copy(data.begin(), data.end(), appendTo(result), present);
+        return result;
+    });
+    runner.measure("omit", "helper", [&] () { return omit(data, others); });
+    runner.measure("omit", "loop", [&] () {
+        std::unordered_set<T> excluded(others.begin(), others.end());
+        Container result;
+        Appender<Container> append(result);
+
+        for(auto const &x : data) {
+            if (excluded.count(x) == 0) {
+                append(x);
+            }
+        }
+
+        return result;
+    });
+    runner.measure("omit", "algorithm", [&] () {
+        std::vector<T> values(data.begin(), data.end());
+        std::vector<T> excluded(others);
+        std::sort(values.begin(), values.end());
+        std::sort(excluded.begin(), excluded.end());
+        Container result;
+        std::set_difference(values.begin(), values.end(), excluded.begin(), excluded.end(), appendTo(result));
+        return result;
+    });
+    runner.measure("filter(index)", "helper", [&] () { return filter(data, index(others)); });
+    runner.measure("filter(index)", "loop", [&] () {
+        std::unordered_set<T> included(others.begin(), others.end());
+        Container result;
+        Appender<Container> append(result);
+
+        for(auto const &x : data) {
+            if (included.count(x) != 0) {
+                append(x);
+            }
+        }
+
+        return result;
+    });
+    runner.measure("difference", "helper", [&] () { return difference(data, others); });
+    runner.measure("intersect", "helper", [&] () { return intersect(data, others); });
+    runner.measure("intersect", "algorithm", [&] () {
+        std::vector<T> values(data.begin(), data.end());
+        std::vector<T> included(others);
+        std::sort(values.begin(), values.end());
+        std::sort(included.begin(), included.end());
+        Container result;
+        std::set_intersection(values.begin(), values.end(), included.begin(), included.end(), appendTo(result));
+        return result;
+    });
+    runner.measure("unionOf", "helper", [&] () { return unionOf(data, others); });
+    runner.measure("unionOf", "algorithm", [&] () {
+        std::vector<T> values(data.begin(), data.end());
+        std::vector<T> added(others);
+        std::sort(values.begin(), values.end());
+        std::sort(added.begin(), added.end());
+        Container result;
+        std::set_union(values.begin(), values.end(), added.begin(), added.end(), appendTo(result));
+        return result;
+    });
+
+    // first
+    runner.measure("first", "helper", [&] () { return first(data); });
+    runner.measure("first", "loop", [&] () { return *data.begin(); });
+}
+
+template <class Container>
+void benchReversible(Runner &, const Container &, std::false_type) {}
+
+template <class Container>
+void benchReversible(Runner &runner, const Container &data, std::true_type)
+{
+    runner.measure("reversed", "helper", [&] () { return reversed(data); });
+    runner.measure("reversed", "loop", [&] () {
+        Container result;
+        loopReserve(result, size_t(FuncHelpUtils::sizeHint(data)));
+        Appender<Container> append(result);
+
+        for(auto it = data.rbegin(); it != data.rend(); ++it) {
+            append(*it);
+        }
+
+        return result;
+    });
+    runner.measure("reversed", "algorithm", [&] () {
+        Container result;
+        loopReserve(result, size_t(FuncHelpUtils::sizeHint(data)));
+        std::reverse_copy(data.begin(), data.end(), appendTo(result));
+        return result;
+    });
+    runner.measure("last", "helper", [&] () { return last(data); });
+    runner.measure("last", "loop", [&] () { return *data.rbegin(); });
+}
+
+template <class Container>
+void benchParallel(Runner &, const Container &, std::false_type) {}
+
+template <class Container>
+void benchParallel(Runner &runner, const Container &data, std::true_type)
+{
+    using T = FuncHelpUtils::iterator_deref_decay<Container>;
+    auto f = [] (const T &x) { return bumped(x); };
+    auto predicate = [] (const T &x) { return isEvenKey(x); };
+    auto add = [] (const T &a, const T &b) { return a + b; };
+
+    runner.measure("map(par)", "helper", [&] () { return ::map(par, data, f); });
+    runner.measure("compr(par)", "helper", [&] () { return compr(par, data, f, predicate); });
+    runner.measure("filter(par)", "helper", [&] () { return filter(par, data, predicate); });
+    runner.measure("filter(parUnord)", "helper", [&] () { return filter(parUnordered, data, predicate); });
+    runner.measure("reject(par)", "helper", [&] () { return reject(par, data, predicate); });
+    runner.measure("sorted(par)", "helper", [&] () { return sorted(par, data); });
+    runner.measure("stableSorted(par)", "helper", [&] () { return stableSorted(par, data); });
+    runner.measure("reduce(par)", "helper", [&] () { return reduce(par, data, add); });
+    runner.measure("sum(par)", "helper", [&] () { return sum(par, data); });
+    runner.measure("min(par)", "helper", [&] () { return min(par, data); });
+    runner.measure("max(par)", "helper", [&] () { return max(par, data); });
+    runner.measure("groupBy(par)", "helper", [&] () { return groupBy(par, data, [] (const T &x) { return keyOf(x) % 1024; }); });
+    runner.measure("countBy(par)", "helper", [&] () { return countBy(par, data, [] (const T &x) { return keyOf(x) % 1024; }); });
+}
+
+// Runs every benchmark that applies to containers of type Container.
+template <class Container>
+void benchContainer(Runner &runner, const Container &data, size_t n)
+{
+    using T = FuncHelpUtils::iterator_deref_decay<Container>;
+    auto f = [] (const T &x) { return bumped(x); };
+    auto predicate = [] (const T &x) { return isEvenKey(x); };
+    auto add = [] (const T &a, const T &b) { return a + b; };
+    auto less = [] (const T &a, const T &b) { return a < b; };
+    const T missing = makeValue<T>(scrambledKey(n));
+    const T present = makeValue<T>(scrambledKey(n / 2));
+
+    // Every fourth value, in reverse order, plus some that aren't in data
+    std::vector<T> others;
+
+    for(size_t i = n + (n / 4); i > 0; i -= 4) {
+        others.push_back(makeValue<T>(scrambledKey(i - 1)));
+
+        if (i < 4) {
+            break;
+        }
+    }
+
+    // allOf and anyOf
+    runner.measure("allOf", "helper", [&] () { return allOf(data, [&] (const T &x) { return !(x == missing); }); });
+    runner.measure("allOf", "pure", [&] () { return allOf(data, purePredicate([&] (const T &x) { return !(x == missing); })); });
+    runner.measure("allOf", "loop", [&] () {
+        for(auto const &x : data) {
+            if (x == missing) {
+                return false;
+            }
+        }
+
+        return true;
+    });
+    runner.measure("allOf", "algorithm", [&] () {
+        return std::all_of(data.begin(), data.end(), [&] (const T &x) { return !(x == missing); });
+    });
+    runner.measure("anyOf", "helper", [&] () { return anyOf(data, [&] (const T &x) { return x == missing; }); });
+    runner.measure("anyOf", "pure", [&] () { return anyOf(data, purePredicate([&] (const T &x) { return x == missing; })); });
+    runner.measure("anyOf", "loop", [&] () {
+        for(auto const &x : data) {
+            if (x == missing) {
+                return true;
+            }
+        }
+
+        return false;
+    });
+    runner.measure("anyOf", "algorithm", [&] () {
+        return std::any_of(data.begin(), data.end(), [&] (const T &x) { return x == missing; });
+    });
+
+    // extremum, min and max
+    runner.measure("extremum", "helper", [&] () { return extremum(data, less); });
+    runner.measure("extremum", "algorithm", [&] () { return *std::min_element(data.begin(), data.end(), less); });
+    runner.measure("min", "helper", [&] () { return min(data); });
+    runner.measure("min", "loop", [&] () {
+        auto it = data.begin();
+        T result = *it;
+
+        for(++it; it != data.end(); ++it) {
+            if (*it < result) {
+                result = *it;
+            }
+        }
+
+        return result;
+    });
+    runner.measure("min", "algorithm", [&] () { return *std::min_element(data.begin(), data.end()); });
+    runner.measure("max", "helper", [&] () { return max(data); });
+    runner.measure("max", "algorithm", [&] () { return *std::max_element(data.begin(), data.end()); });
+    runner.measure("min(func)", "helper", [&] () { return min(data, [] (const T &x) { return keyOf(x); }); });
+    runner.measure("min(func)", "algorithm", [&] () {
+        return *std::min_element(data.begin(), data.end(), [] (const T &a, const T &b) { return keyOf(a) < keyOf(b); });
+    });
+
+    // reduce and the sums
+    runner.measure("reduce", "helper", [&] () { return reduce(data, add, T()); });
+    runner.measure("reduce", "loop", [&] () {
+        T result = T();
+
+        for(auto const &x : data) {
+            result = result + x;
+        }
+
+        return result;
+    });
+    runner.measure("reduce", "algorithm", [&] () { return std::accumulate(data.begin(), data.end(), T(), add); });
+    runner.measure("sum", "helper", [&] () { return sum(data); });
+    runner.measure("sum", "algorithm", [&] () { return std::accumulate(data.begin(), data.end(), T()); });
+    runner.measure("wideSum", "helper", [&] () { return wideSum(data); });
+    runner.measure("compensatedSum", "helper", [&] () { return compensatedSum(data); });
+
+    // aggregate, with the values themselves and with keys
+    auto key = [] (const T &x) { return keyOf(x); };
+    runner.measure("aggregate", "helper", [&] () { return aggregate(data, minOf(), maxOf(), sumOf(), countOf()); });
+    runner.measure("aggregate", "separate", [&] () {
+        return std::make_tuple(min(data), max(data), sum(data), std::distance(data.begin(), data.end()));
+    });
+    runner.measure("aggregate(key)", "helper", [&] () {
+        return aggregate(data, minOf(key), maxOf(key), sumOf(key), meanOf(key), varianceOf(key));
+    });
+    runner.measure("aggregate(key)", "loop", [&] () {
+        const T *lowest = nullptr;
+        const T *highest = nullptr;
+        uint32_t total = 0;
+        double mean = 0;
+        double m2 = 0;
+        size_t count = 0;
+
+        for(auto const &x : data) {
+            const uint32_t k = keyOf(x);
+            lowest = (!lowest || k < keyOf(*lowest)) ? &x : lowest;
+            highest = (!highest || k > keyOf(*highest)) ? &x : highest;
+            total += k;
+            ++count;
+            const double delta = k - mean;
+            mean += delta / count;
+            m2 += delta * (k - mean);
+        }
+
+        return std::make_tuple(lowest, highest, total, mean, count ? m2 / count : 0.0);
+    });
+
+    // contains
+    runner.measure("contains", "helper", [&] () { return contains(data, missing); });
+    runner.measure("contains", "algorithm", [&] () { return std::find(data.begin(), data.end(), missing) != data.end(); });
+
+    // view
+    runner.measure("view", "helper", [&] () { return sum(view(data) | mapped(f) | filtered(predicate)); });
+    runner.measure("view", "loop", [&] () {
+        T result = T();
+
+        for(auto const &x : data) {
+            T y = f(x);
+
+            if (predicate(y)) {
+                result = result + y;
+            }
+        }
+
+        return result;
+    });
+
+    // zip and mapWith, pairing data up with a copy of itself
+    const Container twin(data);
+    using Pair = std::tuple<const T &, const T &>;
+    auto keysMatch = [] (const Pair &pair) { return keyOf(std::get<0>(pair)) == keyOf(std::get<1>(pair)); };
+    auto addKeys = [] (const T &a, const T &b) { return keyOf(a) + keyOf(b); };
+    runner.measure("allOf(zip)", "helper", [&] () { return allOf(zip(data, twin), keysMatch); });
+    runner.measure("allOf(zip)", "loop", [&] () {
+        auto it2 = twin.begin();
+
+        for(auto it1 = data.begin(); it1 != data.end(); ++it1, ++it2) {
+            if (keyOf(*it1) != keyOf(*it2)) {
+                return false;
+            }
+        }
+
+        return true;
+    });
+    runner.measure("mapWith", "helper", [&] () { return mapWith<std::vector>(data, twin, addKeys); });
+    runner.measure("mapWith", "pairs", [&] () {
+        std::vector<std::pair<T, T> > pairs;
+        loopReserve(pairs, n);
+
+        for(auto it1 = data.begin(), it2 = twin.begin(); it1 != data.end(); ++it1, ++it2) {
+            pairs.push_back(std::make_pair(*it1, *it2));
+        }
+
+        return ::map(pairs, [&addKeys] (const std::pair<T, T> &pair) { return addKeys(pair.first, pair.second); });
+    });
+    runner.measure("mapWith", "loop", [&] () {
+        std::vector<uint32_t> result;
+        loopReserve(result, n);
+        auto it2 = twin.begin();
+
+        for(auto it1 = data.begin(); it1 != data.end(); ++it1, ++it2) {
+            result.push_back(addKeys(*it1, *it2));
+        }
+
+        return result;
+    });
+
+    // chunked, summing the keys of each batch of 512 values
+    const size_t batchSize = 512;
+    auto sumKeys = [] (const SliceOf<Container> &batch) {
+        uint32_t total = 0;
+
+        for(auto const &x : batch) {
+            total += keyOf(x);
+        }
+
+        return total;
+    };
+    runner.measure("map(chunked)", "helper", [&] () { return ::map(chunked(data, batchSize), sumKeys); });
+    runner.measure("map(chunked)", "copies", [&] () {
+        std::vector<uint32_t> result;
+        std::vector<T> batch;
+
+        for(auto it = data.begin(); it != data.end();) {
+            batch.clear();
+
+            for(size_t i = 0; i < batchSize && it != data.end(); ++i, ++it) {
+                batch.push_back(*it);
+            }
+
+            result.push_back(::reduce(batch, [] (uint32_t memo, const T &x) { return memo + keyOf(x); }, uint32_t(0)));
+        }
+
+        return result;
+    });
+    runner.measure("map(chunked)", "loop", [&] () {
+        std::vector<uint32_t> result;
+        loopReserve(result, (n + batchSize - 1) / batchSize);
+        uint32_t total = 0;
+        size_t count = 0;
+
+        for(auto const &x : data) {
+            total += keyOf(x);
+
+            if (++count == batchSize) {
+                result.push_back(total);
+                total = 0;
+                count = 0;
+            }
+        }
+
+        if (count > 0) {
+            result.push_back(total);
+        }
+
+        return result;
+    });
+
+    benchSorted(runner, data, std::integral_constant<bool, FuncHelpUtils::has_mutable_items<Container>::value>());
+    benchBuilding(runner, data, present, others, std::integral_constant<bool, FuncHelpUtils::has_size<Container>::value>());
+    benchReversible(runner, data, std::integral_constant<bool, FuncHelpUtils::has_const_reverse_iterator<Container>::value>());
+    benchParallel(runner, data, std::integral_constant<bool, is_random_access<Container>::value>());
+}
+
+// Runs the benchmarks that produce a container from scratch rather than from
+// another container.
+void benchGenerators(Runner &runner, size_t n)
+{
+    const int end = int(n);
+
+    runner.measure("range", "helper", [&] () { return range<std::vector>(end); });
+    runner.measure("range", "loop", [&] () {
+        std::vector<int> result;
+        result.reserve(n);
+
+        for(int i = 0; i < end; ++i) {
+            result.push_back(i);
+        }
+
+        return result;
+    });
+    runner.measure("range", "algorithm", [&] () {
+        std::vector<int> result(n);
+        std::iota(result.begin(), result.end(), 0);
+        return result;
+    });
+    runner.measure("mapRange", "helper", [&] () { return mapRange<std::vector>(0, end, [] (int x) { return x * 3; }); });
+    runner.measure("mapRange", "loop", [&] () {
+        std::vector<int> result;
+        result.reserve(n);
+
+        for(int i = 0; i < end; ++i) {
+            result.push_back(i * 3);
+        }
+
+        return result;
+    });
+    runner.measure("sum(range)", "helper", [&] () { return sum(range(0LL, (long long)n)); });
+    runner.measure("sum(range)", "materialized", [&] () { return wideSum(range<std::vector>(end)); });
+    runner.measure("sum(range)", "loop", [&] () {
+        long long result = 0;
+
+        for(long long i = 0; i < (long long)n; ++i) {
+            result += i;
+        }
+
+        return result;
+    });
+    runner.measure("sum(mapRange)", "helper", [&] () { return sum(mapRange(0LL, (long long)n, [] (long long x) { return x * 3; })); });
+    runner.measure("sum(mapRange)", "materialized", [&] () { return wideSum(mapRange<std::vector>(0, end, [] (int x) { return x * 3; })); });
+    runner.measure("filter(range)", "helper", [&] () { return filter(range(0, end), [] (int x) { return (x % 3) == 0; }); });
+}
+
+template <class T>
+void benchFlatten(Runner &runner, size_t n)
+{
+    std::vector<std::vector<T> > nested((n + 15) / 16);
+
+    for(size_t i = 0; i < n; ++i) {
+        nested[i / 16].push_back(makeValue<T>(scrambledKey(i)));
+    }
+
+    runner.measure("flatten", "helper", [&] () { return flatten(nested); });
+    runner.measure("flatten", "loop", [&] () {
+        std::vector<T> result;
+
+        for(auto const &inner : nested) {
+            result.insert(result.end(), inner.begin(), inner.end());
+        }
+
+        return result;
+    });
+
+    // Every group is mapped to a copy of itself, so that only the overhead
+    // of building the groups differs
+    auto same = [] (const std::vector<T> &inner) { return inner; };
+    runner.measure("flatMap", "helper", [&] () { return flatMap(nested, same); });
+    runner.measure("flatMap", "map+flatten", [&] () { return flatten(::map(nested, same)); });
+    runner.measure("flatMap", "loop", [&] () {
+        std::vector<T> result;
+
+        for(auto const &inner : nested) {
+            std::vector<T> mapped = same(inner);
+            result.insert(result.end(), std::make_move_iterator(mapped.begin()), std::make_move_iterator(mapped.end()));
+        }
+
+        return result;
+    });
+}
+
+template <class Container>
+Container makeContainer(size_t n)
+{
+    using T = FuncHelpUtils::iterator_deref_decay<Container>;
+    Container result;
+    loopReserve(result, n);
+    Appender<Container> append(result);
+
+    for(size_t i = 0; i < n; ++i) {
+        append(makeValue<T>(scrambledKey(i)));
+    }
+
+    return result;
+}
+
+// Roughly how many bytes a container of n items takes, counting the
+// per-node overhead of node based containers.
+template <class T>
+size_t footprint(size_t n, size_t pointersPerItem) { return n * (sizeof(T) + pointersPerItem * sizeof(void *)); }
+
+template <class Container>
+void runFamily(Runner &runner, const char *containerName, size_t pointersPerItem, size_t n)
+{
+    using T = FuncHelpUtils::iterator_deref_decay<Container>;
+
+    // The benchmarks make a few copies of the container at once
+    if (footprint<T>(n, pointersPerItem) * 4 > runner.options.maxBytes) {
+        return;
+    }
+
+    runner.setCase(containerName, elementName<T>(), sizeof(T), n);
+    benchContainer(runner, makeContainer<Container>(n), n);
+}
+
+template <class T>
+void runElement(Runner &runner, size_t n)
+{
+    runFamily<std::vector<T> >(runner, "std::vector", 0, n);
+    runFamily<std::list<T> >(runner, "std::list", 2, n);
+    runFamily<std::forward_list<T> >(runner, "std::forward_list", 1, n);
+    runFamily<std::set<T> >(runner, "std::set", 4, n);
+#ifdef QT_CORE_LIB
+    runFamily<QVector<T> >(runner, "QVector", 0, n);
+    runFamily<QList<T> >(runner, "QList", 1, n);
+    runFamily<QLinkedList<T> >(runner, "QLinkedList", 2, n);
+    runFamily<QSet<T> >(runner, "QSet", 2, n);
+#endif
+
+    if (footprint<T>(n, 0) * 4 <= runner.options.maxBytes) {
+        runner.setCase("std::vector<std::vector>", elementName<T>(), sizeof(T), n);
+        benchFlatten<T>(runner, n);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--max-n" && hasValue) {
+            options.maxN = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--max-bytes" && hasValue) {
+            options.maxBytes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--min-time-ms" && hasValue) {
+            options.minTimeMs = std::atof(argv[++i]);
+        } else if (arg == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            options.outPath = argv[++i];
+        } else if (arg == "--quick") {
+            options.maxN = 10000;
+            options.minTimeMs = 1;
+        } else {
+            std::fprintf(stderr, "Unknown or incomplete argument: %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    Runner runner(options);
+
+    for(size_t n = 10; n <= options.maxN; n *= 10) {
+        if (footprint<int>(n, 0) * 4 <= options.maxBytes) {
+            runner.setCase("std::vector", "int", sizeof(int), n);
+            benchGenerators(runner, n);
+        }
+
+        runElement<int>(runner, n);
+        runElement<Payload<16> >(runner, n);
+        runElement<Payload<64> >(runner, n);
+        runElement<Payload<256> >(runner, n);
+
+        if (footprint<char>(n, 0) * 4 <= options.maxBytes) {
+            runner.setCase("std::string", "char", sizeof(char), n);
+            benchContainer(runner, makeContainer<std::string>(n), n);
+        }
+    }
+
+    runner.write();
+    return 0;
+}
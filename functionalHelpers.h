@@ -29,6 +29,31 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <tuple>
+#include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+
+template <class T>
+class LazyRange;
+
+template <class Pipeline>
+class LazyView;
+
+template <class T>
+class SmallVector;
 
 namespace FuncHelpUtils {
     // Default behavior of reserveSize is to do nothing
@@ -47,24 +72,199 @@ namespace FuncHelpUtils {
     }
     
     // And also STL strings
-    template<class U>
-    inline void reserveSize(std::basic_string<U> &container, int size)
+    template<class U, class T, class A>
+    inline void reserveSize(std::basic_string<U, T, A> &container, int size)
+    {
+        container.reserve(size);
+    }
+    
+    // Reserving for the unordered containers sizes the bucket array once
+    // rather than rehashing as items are added.
+    template<class U, class H, class E, class A>
+    inline void reserveSize(std::unordered_set<U, H, E, A> &container, int size)
+    {
+        container.reserve(size);
+    }
+    
+    template<class U, class H, class E, class A>
+    inline void reserveSize(std::unordered_multiset<U, H, E, A> &container, int size)
+    {
+        container.reserve(size);
+    }
+    
+    template<class K, class U, class H, class E, class A>
+    inline void reserveSize(std::unordered_map<K, U, H, E, A> &container, int size)
     {
         container.reserve(size);
     }
     
+    template<class K, class U, class H, class E, class A>
+    inline void reserveSize(std::unordered_multimap<K, U, H, E, A> &container, int size)
+    {
+        container.reserve(size);
+    }
+    
+    template<class U>
+    inline void reserveSize(SmallVector<U> &container, int size)
+    {
+        container.reserve(size_t(size));
+    }
+    
+    // reserveUpTo is used instead of reserveSize when size is only the most
+    // items that might be added, e.g. by filter. By default it reserves the
+    // same way, but a SmallVector isn't grown past its inline capacity for
+    // items that will usually not be added.
+    template<class Container>
+    inline void reserveUpTo(Container &container, int size)
+    {
+        FuncHelpUtils::reserveSize(container, size);
+    }
+    
+    template<class U>
+    inline void reserveUpTo(SmallVector<U> &container, int size)
+    {
+        (void)container;
+        (void)size;
+    }
+    
+    // shrinkSize releases the storage that a container doesn't use once it's
+    // using less than half of it, e.g. after filtering a container in place.
+    // By default it does nothing.
+    template<class Container>
+    inline void shrinkSize(Container &container)
+    {
+        (void)container;
+    }
+    
+    template<class U, class V>
+    inline void shrinkSize(std::vector<U, V> &container)
+    {
+        if (container.size() < container.capacity() / 2) {
+            container.shrink_to_fit();
+        }
+    }
+    
     template<class Container, class U>
     inline void addItem(Container &container, const U &item)
     {
         container.push_back(item);
     }
     
-    template<class U, class V>
-    inline void addItem(std::set<U, V> &container, const U &item)
+    template<class U, class C, class A>
+    inline void addItem(std::set<U, C, A> &container, const U &item)
+    {
+        container.insert(item);
+    }
+    
+    template<class U, class H, class E, class A>
+    inline void addItem(std::unordered_set<U, H, E, A> &container, const U &item)
+    {
+        container.insert(item);
+    }
+    
+    template<class U, class H, class E, class A>
+    inline void addItem(std::unordered_multiset<U, H, E, A> &container, const U &item)
     {
         container.insert(item);
     }
     
+    // OutputSink lets an output iterator stand in for a container, so that
+    // anything that fills a container using addItem can write to an iterator
+    // instead.
+    template<class Iterator>
+    struct OutputSink {
+        Iterator it;
+    };
+    
+    template<class Iterator, class U>
+    inline void addItem(OutputSink<Iterator> &sink, const U &item)
+    {
+        *sink.it = item;
+        ++sink.it;
+    }
+    
+    // addItems appends every item from first up to last. By default it calls
+    // addItem for each one, but containers that can append a whole range at
+    // once do so, which for trivially copyable items in contiguous storage
+    // comes down to a single memmove.
+    template<class Container, class Iterator>
+    inline void addItems(Container &container, Iterator first, Iterator last)
+    {
+        for(; first != last; ++first) {
+            FuncHelpUtils::addItem(container, *first);
+        }
+    }
+    
+    template<class U, class V, class Iterator>
+    inline void addItems(std::vector<U, V> &container, Iterator first, Iterator last)
+    {
+        container.insert(container.end(), first, last);
+    }
+    
+    template<class U, class T, class A, class Iterator>
+    inline void addItems(std::basic_string<U, T, A> &container, Iterator first, Iterator last)
+    {
+        container.append(first, last);
+    }
+    
+    template<class U, class Iterator>
+    inline void addItems(SmallVector<U> &container, Iterator first, Iterator last)
+    {
+        container.insert(container.end(), first, last);
+    }
+    
+    template<class Iterator, class InIterator>
+    inline void addItems(OutputSink<Iterator> &sink, InIterator first, InIterator last)
+    {
+        sink.it = std::copy(first, last, sink.it);
+    }
+    
+    // moveItem is used instead of addItem when the item comes from a
+    // temporary container and can be moved rather than copied. By default it
+    // falls back on addItem, so containers that only overload addItem still
+    // work.
+    template<class Container, class U>
+    inline void moveItem(Container &container, U &&item)
+    {
+        FuncHelpUtils::addItem(container, item);
+    }
+    
+    template<class U, class V>
+    inline void moveItem(std::vector<U, V> &container, U &&item)
+    {
+        container.push_back(std::move(item));
+    }
+    
+    template<class U>
+    inline void moveItem(SmallVector<U> &container, U &&item)
+    {
+        container.push_back(std::move(item));
+    }
+    
+    template<class U, class V>
+    inline void moveItem(std::list<U, V> &container, U &&item)
+    {
+        container.push_back(std::move(item));
+    }
+    
+    template<class U, class C, class A>
+    inline void moveItem(std::set<U, C, A> &container, U &&item)
+    {
+        container.insert(std::move(item));
+    }
+    
+    template<class U, class H, class E, class A>
+    inline void moveItem(std::unordered_set<U, H, E, A> &container, U &&item)
+    {
+        container.insert(std::move(item));
+    }
+    
+    template<class U, class H, class E, class A>
+    inline void moveItem(std::unordered_multiset<U, H, E, A> &container, U &&item)
+    {
+        container.insert(std::move(item));
+    }
+    
     // Helper to determine whether there's a const_iterator for T.
     template<typename T>
     struct has_const_iterator {
@@ -119,775 +319,5969 @@ namespace FuncHelpUtils {
     
     template <class Val, class F>
     using func_result = decay_t<decltype(std::ref(std::declval<F &>())(std::declval<Val &>()))>;
-}
-
-// map
-
-template <class OutType,
-          class InType,
-          class F>
-OutType map(const InType &container, const F &func)
-{
-    OutType result;
     
-    for(auto const &val : container) {
-        FuncHelpUtils::addItem(result, std::ref(func)(decltype(val)(val)));
-    }
+    // Helper to determine whether the items of a container can be assigned to
+    // through its iterators, which is not the case for sets.
+    template <class Container>
+    struct has_mutable_items {
+        enum { value = !std::is_const<typename std::remove_reference<iterator_deref<Container> >::type>::value };
+    };
     
-    return result;
-}
-
-template <template <class...> class InContainer,
-          template <class...> class OutContainer = InContainer,
-          class InType,
-          class F>
-auto map(const InContainer<InType> &container, const F &func)
- -> OutContainer<FuncHelpUtils::func_container_result<InContainer<InType>, F> >
-{
-    using OutType = FuncHelpUtils::func_container_result<InContainer<InType>, F>;
-    return map<OutContainer<OutType>, InContainer<InType> >(container, func);
-}
-
-template <template <class...> class OutContainer,
-          template <class...> class InContainer,
-          class InType,
-          class F,
-          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
-auto map(const InContainer<InType> &container, const F &func)
- -> OutContainer<FuncHelpUtils::func_container_result<InContainer<InType>, F> >
-{
-    return map<InContainer, OutContainer>(container, func);
-}
-
-// compr
-
-template <class OutType,
-          class InType,
-          class F1,
-          class F2>
-OutType compr(const InType &container, const F1 &func, const F2 &predicate)
-{
-    OutType result;
+    // Nor for lazy ranges, which compute their values rather than storing them.
+    template <class T>
+    struct has_mutable_items<LazyRange<T> > {
+        enum { value = false };
+    };
     
-    for(auto const &val : container) {
-        if (std::ref(predicate)(decltype(val)(val))) {
-            FuncHelpUtils::addItem(result, std::ref(func)(decltype(val)(val)));
-        }
+    // Or for views, which have no iterators at all.
+    template <class Pipeline>
+    struct has_mutable_items<LazyView<Pipeline> > {
+        enum { value = false };
+    };
+    
+    template <class Container>
+    using is_random_access = std::is_base_of<std::random_access_iterator_tag,
+                                             typename std::iterator_traits<decltype(std::declval<const Container &>().begin())>::iterator_category>;
+    
+    // Helper to determine whether an argument bound to T&& is a non-const
+    // rvalue, i.e. a temporary container whose storage can be reused.
+    template <class T>
+    struct is_reusable_rvalue {
+        enum { value = !std::is_reference<T>::value && !std::is_const<T>::value };
+    };
+    
+    // Helper to determine whether T has a size() member function.
+    template<typename T>
+    struct has_size {
+    private:
+        template<typename C> static char test(decltype(std::declval<const C &>().size())*);
+        template<typename C> static int  test(...);
+    public:
+        enum { value = sizeof(test<T>(0)) == sizeof(char) };
+    };
+    
+    // sizeHint returns the number of items in a container when that can be
+    // determined cheaply, and 0 otherwise (e.g. for std::forward_list, or
+    // when there are too many to count in an int). It's used to determine how
+    // much space to reserve in a result container before filling it.
+    template<class Container>
+    inline auto sizeHint(const Container &container)
+     -> enable_if_t<has_size<Container>::value, int>
+    {
+        const auto size = container.size();
+        return (size_t(size) <= size_t(std::numeric_limits<int>::max())) ? int(size) : 0;
     }
     
-    return result;
-}
-
-template <template <class...> class InContainer,
-          template <class...> class OutContainer = InContainer,
-          class InType,
-          class F1,
-          class F2>
-auto compr(const InContainer<InType> &container, const F1 &func, const F2 &predicate)
- -> OutContainer<FuncHelpUtils::func_container_result<InContainer<InType>, F1> >
-{
-    using OutType = FuncHelpUtils::func_container_result<InContainer<InType>, F1>;
-    return compr<OutContainer<OutType>, InContainer<InType> >(container, func, predicate);
-}
-
-template <template <class...> class OutContainer,
-          template <class...> class InContainer,
-          class InType,
-          class F1,
-          class F2,
-          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
-auto compr(const InContainer<InType> &container, const F1 &func, const F2 &predicate)
- -> OutContainer<FuncHelpUtils::func_container_result<InContainer<InType>, F1> >
-{
-    return compr<InContainer, OutContainer>(container, func, predicate);
-}
-
-// filter
-
-template <class InContainer,
-          class OutContainer,
-          class F>
-OutContainer filter(const InContainer &container, const F &predicate)
-{
-    OutContainer result;
+    template<class Container>
+    inline auto sizeHint(const Container &container)
+     -> enable_if_t<!has_size<Container>::value, int>
+    {
+        (void)container;
+        return 0;
+    }
     
-    for(auto val : container) {
-        if (std::ref(predicate)(decltype(val)(val))) {
-            FuncHelpUtils::addItem(result, val);
+    // The sum of the sizes of each container inside of a container of
+    // containers.
+    template<class Container>
+    inline int nestedSizeHint(const Container &container)
+    {
+        int result = 0;
+        
+        for(auto const &nested : container) {
+            result += sizeHint(nested);
         }
+        
+        return result;
     }
     
-    return result;
+    // The number of values that range(start, end, inc) will produce.
+    inline int rangeSize(int start, int end, int inc)
+    {
+        long long span = (long long)end - start;
+        
+        if (inc == 0 || (inc > 0 && span <= 0) || (inc < 0 && span >= 0)) {
+            return 0;
+        }
+        
+        return int((span + inc + ((inc > 0) ? -1 : 1)) / inc);
+    }
 }
 
-template <template <class...> class InContainer,
-          template <class...> class OutContainer = InContainer,
-          class ValType,
-          class F>
-auto filter(const InContainer<ValType> &container, const F &predicate)
- -> OutContainer<ValType>
-{
-    return filter<InContainer<ValType>, OutContainer<ValType>, F>(container, predicate);
-}
+// Profiling
 
-template <template <class...> class OutContainer,
-          template <class...> class InContainer,
-          class ValType,
-          class F,
-          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
-auto filter(const InContainer<ValType> &container, const F &predicate)
- -> OutContainer<ValType>
-{
-    return filter<InContainer, OutContainer>(container, predicate);
-}
+// Defining FUNC_HELPERS_PROFILE turns on counters for map, compr, filter,
+// reject and omit, including the Into and pmr versions. For each helper and
+// call site they count how many calls there were, how many values were
+// visited, how many times func or predicate was invoked (for omit, how many
+// values were looked up), how many items were added to the
+// result, how many times adding items made the result reallocate its storage,
+// and how many items the results ended up with. Without it, the hooks used by
+// those helpers expand to nothing. It must be defined the same way in every
+// file that includes this one, e.g. on the compiler's command line.
+//
+// A call site is marked by FUNC_HELPERS_PROFILE_SITE("label"), which applies
+// to the helpers called on the same thread until the end of the enclosing
+// block. Helpers called outside of any site are counted together.
+//
+// Each thread counts into its own buffer, and only locks it once per call to
+// add that call's counts. profileSnapshot() returns the totals over every
+// thread, including ones that have exited, dumpProfile() writes them out as a
+// table, and resetProfile() sets them back to zero.
 
-// reject
+#ifdef FUNC_HELPERS_PROFILE
 
-template <class InContainer,
-          class OutContainer,
-          class F>
-OutContainer reject(const InContainer &container, const F &predicate)
-{
-    OutContainer result;
+#include <cstdio>
+#include <mutex>
+
+struct HelperProfile {
+    std::string helper;
+    std::string site;
+    std::string file;
+    int line;
+    unsigned long long calls;
+    unsigned long long visited;
+    unsigned long long invocations;
+    unsigned long long added;
+    unsigned long long reallocations;
+    unsigned long long outputItems;
+    unsigned long long largestOutput;
+};
+
+namespace FuncHelpUtils {
+    struct ProfileSite {
+        const char *label;
+        const char *file;
+        int line;
+    };
     
-    for(auto val : container) {
-        if (!std::ref(predicate)(val)) {
-            FuncHelpUtils::addItem(result, val);
+    struct ProfileCounts {
+        ProfileCounts()
+            : calls(0), visited(0), invocations(0), added(0), reallocations(0), outputItems(0), largestOutput(0) {}
+        
+        void merge(const ProfileCounts &other)
+        {
+            calls += other.calls;
+            visited += other.visited;
+            invocations += other.invocations;
+            added += other.added;
+            reallocations += other.reallocations;
+            outputItems += other.outputItems;
+            largestOutput = std::max(largestOutput, other.largestOutput);
         }
-    }
+        
+        unsigned long long calls;
+        unsigned long long visited;
+        unsigned long long invocations;
+        unsigned long long added;
+        unsigned long long reallocations;
+        unsigned long long outputItems;
+        unsigned long long largestOutput;
+    };
     
-    return result;
+    // Counts are kept by the address of the helper's name and of its site,
+    // and only merged by the text of the name when they're read.
+    typedef std::pair<const char *, const ProfileSite *> ProfileKey;
+    
+    struct ProfileKeyHash {
+        size_t operator()(const ProfileKey &key) const
+        {
+            return std::hash<const void *>()(key.first) * 31 + std::hash<const void *>()(key.second);
+        }
+    };
+    
+    typedef std::unordered_map<ProfileKey, ProfileCounts, ProfileKeyHash> ProfileTable;
+    
+    inline void mergeProfileTable(ProfileTable &table, const ProfileTable &other)
+    {
+        for(auto const &entry : other) {
+            table[entry.first].merge(entry.second);
+        }
+    }
+    
+    struct ProfileBuffer;
+    
+    // Every thread's buffer, along with the counts of threads that have exited.
+    struct ProfileRegistry {
+        std::mutex mutex;
+        std::vector<ProfileBuffer *> buffers;
+        ProfileTable retired;
+    };
+    
+    inline ProfileRegistry &profileRegistry()
+    {
+        static ProfileRegistry registry;
+        return registry;
+    }
+    
+    struct ProfileBuffer {
+        ProfileBuffer()
+        {
+            ProfileRegistry &registry = profileRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.buffers.push_back(this);
+        }
+        
+        ~ProfileBuffer()
+        {
+            ProfileRegistry &registry = profileRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            std::lock_guard<std::mutex> tableLock(mutex);
+            mergeProfileTable(registry.retired, table);
+            registry.buffers.erase(std::find(registry.buffers.begin(), registry.buffers.end(), this));
+        }
+        
+        void record(const char *helper, const ProfileSite *site, const ProfileCounts &counts)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            table[std::make_pair(helper, site)].merge(counts);
+        }
+        
+        std::mutex mutex;
+        ProfileTable table;
+    };
+    
+    inline ProfileBuffer &profileBuffer()
+    {
+        static thread_local ProfileBuffer buffer;
+        return buffer;
+    }
+    
+    inline const ProfileSite *&activeProfileSite()
+    {
+        static thread_local const ProfileSite *site = nullptr;
+        return site;
+    }
+    
+    // Set by FUNC_HELPERS_PROFILE_SITE until the end of the enclosing block.
+    class ProfileSiteScope {
+    public:
+        explicit ProfileSiteScope(const ProfileSite &site)
+            : outer(activeProfileSite())
+        {
+            activeProfileSite() = &site;
+        }
+        
+        ~ProfileSiteScope()
+        {
+            activeProfileSite() = outer;
+        }
+        
+        ProfileSiteScope(const ProfileSiteScope &) = delete;
+        ProfileSiteScope &operator=(const ProfileSiteScope &) = delete;
+    
+    private:
+        const ProfileSite *outer;
+    };
+    
+    template <class Container>
+    inline auto profiledCapacity(const Container &container)
+     -> decltype(size_t(container.capacity()))
+    {
+        return size_t(container.capacity());
+    }
+    
+    inline size_t profiledCapacity(...)
+    {
+        return 0;
+    }
+    
+    // The counts for one call of a helper, which are added to the thread's
+    // buffer when it returns. Helpers called by func or predicate get their
+    // own ProfileScope, and the enclosing one is restored afterwards.
+    class ProfileScope {
+    public:
+        explicit ProfileScope(const char *helper)
+            : helper(helper), site(activeProfileSite()), outer(activeScope()), capacity(0), startSize(0)
+        {
+            counts.calls = 1;
+            activeScope() = this;
+        }
+        
+        ~ProfileScope()
+        {
+            activeScope() = outer;
+            profileBuffer().record(helper, site, counts);
+        }
+        
+        ProfileScope(const ProfileScope &) = delete;
+        ProfileScope &operator=(const ProfileScope &) = delete;
+        
+        static ProfileScope *&activeScope()
+        {
+            static thread_local ProfileScope *scope = nullptr;
+            return scope;
+        }
+        
+        // Notes the result's capacity and size before anything is added to it.
+        template <class Container>
+        void watch(const Container &result)
+        {
+            capacity = profiledCapacity(result);
+            startSize = sizeOf(result);
+        }
+        
+        template <class Container>
+        void add(const Container &result, size_t count)
+        {
+            const size_t current = profiledCapacity(result);
+            counts.added += count;
+            
+            if (current != capacity) {
+                ++counts.reallocations;
+                capacity = current;
+            }
+        }
+        
+        // Outputs that aren't containers, like output iterators, count the
+        // items that were added to them.
+        template <class Container>
+        void output(const Container &result)
+        {
+            const size_t size = has_const_iterator<Container>::value ? sizeOf(result) - startSize : size_t(counts.added);
+            counts.outputItems += size;
+            counts.largestOutput = std::max<unsigned long long>(counts.largestOutput, size);
+        }
+        
+        ProfileCounts counts;
+    
+    private:
+        template <class Container>
+        static auto sizeOf(const Container &container)
+         -> enable_if_t<has_size<Container>::value, size_t>
+        {
+            return size_t(container.size());
+        }
+        
+        template <class Container>
+        static auto sizeOf(const Container &container)
+         -> enable_if_t<!has_size<Container>::value && has_const_iterator<Container>::value, size_t>
+        {
+            return size_t(std::distance(container.begin(), container.end()));
+        }
+        
+        template <class Container>
+        static auto sizeOf(const Container &container)
+         -> enable_if_t<!has_size<Container>::value && !has_const_iterator<Container>::value, size_t>
+        {
+            (void)container;
+            return 0;
+        }
+        
+        const char *helper;
+        const ProfileSite *site;
+        ProfileScope *outer;
+        size_t capacity;
+        size_t startSize;
+    };
+    
+    // Helpers that aren't profiled can share the code of ones that are, in
+    // which case there's no scope to count into. Every profiled helper opens
+    // its own scope before calling shared code like appendMapped or moveIf,
+    // so that the counts aren't added to whichever helper called it.
+    template <class Container>
+    inline void profileWatch(const Container &result)
+    {
+        if (ProfileScope *scope = ProfileScope::activeScope()) {
+            scope->watch(result);
+        }
+    }
+    
+    inline void profileVisit(size_t count)
+    {
+        if (ProfileScope *scope = ProfileScope::activeScope()) {
+            scope->counts.visited += count;
+        }
+    }
+    
+    inline void profileCall(size_t count)
+    {
+        if (ProfileScope *scope = ProfileScope::activeScope()) {
+            scope->counts.invocations += count;
+        }
+    }
+    
+    template <class Container>
+    inline void profileAdd(const Container &result, size_t count)
+    {
+        if (ProfileScope *scope = ProfileScope::activeScope()) {
+            scope->add(result, count);
+        }
+    }
+    
+    template <class Container>
+    inline void profileOutput(const Container &result)
+    {
+        if (ProfileScope *scope = ProfileScope::activeScope()) {
+            scope->output(result);
+        }
+    }
+}
+
+// Returns the counts of every helper at every site, over all threads, sorted
+// by site and then by helper.
+inline std::vector<HelperProfile> profileSnapshot()
+{
+    FuncHelpUtils::ProfileRegistry &registry = FuncHelpUtils::profileRegistry();
+    FuncHelpUtils::ProfileTable table;
+    
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        FuncHelpUtils::mergeProfileTable(table, registry.retired);
+        
+        for(FuncHelpUtils::ProfileBuffer *buffer : registry.buffers) {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            FuncHelpUtils::mergeProfileTable(table, buffer->table);
+        }
+    }
+    
+    std::vector<HelperProfile> result;
+    
+    for(auto const &entry : table) {
+        const FuncHelpUtils::ProfileSite *site = entry.first.second;
+        auto existing = std::find_if(result.begin(), result.end(), [&entry, site] (const HelperProfile &profile) {
+            return profile.helper == entry.first.first && profile.line == (site ? site->line : 0) &&
+                   profile.site == (site ? site->label : "") && profile.file == (site ? site->file : "");
+        });
+        
+        if (existing == result.end()) {
+            HelperProfile profile = {entry.first.first, site ? site->label : "", site ? site->file : "", site ? site->line : 0,
+                                     0, 0, 0, 0, 0, 0, 0};
+            existing = result.insert(result.end(), profile);
+        }
+        
+        const FuncHelpUtils::ProfileCounts &counts = entry.second;
+        existing->calls += counts.calls;
+        existing->visited += counts.visited;
+        existing->invocations += counts.invocations;
+        existing->added += counts.added;
+        existing->reallocations += counts.reallocations;
+        existing->outputItems += counts.outputItems;
+        existing->largestOutput = std::max(existing->largestOutput, counts.largestOutput);
+    }
+    
+    std::sort(result.begin(), result.end(), [] (const HelperProfile &a, const HelperProfile &b) {
+        return std::tie(a.file, a.line, a.site, a.helper) < std::tie(b.file, b.line, b.site, b.helper);
+    });
+    
+    return result;
+}
+
+// Sets every thread's counts back to zero. Calls that are in progress on other
+// threads are still added when they return.
+inline void resetProfile()
+{
+    FuncHelpUtils::ProfileRegistry &registry = FuncHelpUtils::profileRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.retired.clear();
+    
+    for(FuncHelpUtils::ProfileBuffer *buffer : registry.buffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        buffer->table.clear();
+    }
+}
+
+// Writes profileSnapshot() to out as a table, one line per helper and site.
+inline void dumpProfile(std::FILE *out = stderr)
+{
+    std::fprintf(out, "%-12s %10s %12s %12s %12s %8s %12s %10s  %s\n", "helper", "calls", "visited", "invocations",
+                 "added", "reallocs", "output", "largest", "site");
+    
+    for(const HelperProfile &profile : profileSnapshot()) {
+        std::string site = profile.site.empty() ? std::string("-") : profile.site;
+        
+        if (!profile.file.empty()) {
+            site += " (" + profile.file + ":" + std::to_string(profile.line) + ")";
+        }
+        
+        std::fprintf(out, "%-12s %10llu %12llu %12llu %12llu %8llu %12llu %10llu  %s\n", profile.helper.c_str(),
+                     profile.calls, profile.visited, profile.invocations, profile.added, profile.reallocations,
+                     profile.outputItems, profile.largestOutput, site.c_str());
+    }
+}
+
+#define FUNC_HELPERS_PROFILE_CONCAT_(a, b) a##b
+#define FUNC_HELPERS_PROFILE_CONCAT(a, b) FUNC_HELPERS_PROFILE_CONCAT_(a, b)
+#define FUNC_HELPERS_PROFILE_SITE(label) \
+    static const FuncHelpUtils::ProfileSite FUNC_HELPERS_PROFILE_CONCAT(funcHelpersSite, __LINE__) = {label, __FILE__, __LINE__}; \
+    FuncHelpUtils::ProfileSiteScope FUNC_HELPERS_PROFILE_CONCAT(funcHelpersSiteScope, __LINE__)(FUNC_HELPERS_PROFILE_CONCAT(funcHelpersSite, __LINE__))
+#define FUNC_HELPERS_PROFILE_SCOPE(helper) FuncHelpUtils::ProfileScope funcHelpersProfileScope(helper)
+#define FUNC_HELPERS_PROFILE_WATCH(result) FuncHelpUtils::profileWatch(result)
+#define FUNC_HELPERS_PROFILE_VISIT(count) FuncHelpUtils::profileVisit(size_t(count))
+#define FUNC_HELPERS_PROFILE_CALL(count) FuncHelpUtils::profileCall(size_t(count))
+#define FUNC_HELPERS_PROFILE_ADD(result, count) FuncHelpUtils::profileAdd(result, size_t(count))
+#define FUNC_HELPERS_PROFILE_OUTPUT(result) FuncHelpUtils::profileOutput(result)
+
+#else
+
+#define FUNC_HELPERS_PROFILE_SITE(label)
+#define FUNC_HELPERS_PROFILE_SCOPE(helper)
+#define FUNC_HELPERS_PROFILE_WATCH(result)
+#define FUNC_HELPERS_PROFILE_VISIT(count)
+#define FUNC_HELPERS_PROFILE_CALL(count)
+#define FUNC_HELPERS_PROFILE_ADD(result, count)
+#define FUNC_HELPERS_PROFILE_OUTPUT(result)
+
+#endif
+
+// SmallVector
+
+// SmallVector<T> is a vector that stores up to 8 items inline, within the
+// object itself, and only allocates once it grows past that. It can be passed
+// as the container type of any function here, e.g. filter<SmallVector>(v, p),
+// so that results that are usually small don't need to be allocated at all.
+// SmallVectorOf<N>::type<T> stores up to N items inline instead, and can be
+// passed the same way, e.g. compr<SmallVectorOf<16>::type>(v, f, p). The
+// inline capacity isn't a template argument of SmallVector itself since
+// containers are given to these functions as templates of just their value
+// type. SmallVectors with different inline capacities can be copied and moved
+// into each other.
+//
+// Functions whose results have a known size, like map, reserve room for them
+// in a SmallVector up front. Ones where that's only an upper bound, like
+// filter, compr and omit, don't, since that would usually mean allocating
+// for nothing. Instead it doubles its capacity whenever it runs out of room,
+// like a std::vector. Moving a SmallVector whose items are stored inline
+// moves each item, so unlike a std::vector, that invalidates iterators to it.
+
+namespace FuncHelpUtils {
+    template <class T, size_t InlineCapacity>
+    class SmallVectorBase {
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T &;
+        using const_reference = const T &;
+        using pointer = T *;
+        using const_pointer = const T *;
+        using iterator = T *;
+        using const_iterator = const T *;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+        
+        enum { inlineCapacity = InlineCapacity };
+        
+        SmallVectorBase() : items(inlineItems()), count(0), allocated(inlineCapacity) {}
+        
+        SmallVectorBase(size_t size, const T &val) : SmallVectorBase()
+        {
+            resize(size, val);
+        }
+        
+        SmallVectorBase(std::initializer_list<T> values) : SmallVectorBase()
+        {
+            insert(end(), values.begin(), values.end());
+        }
+        
+        template <class Iterator,
+                  class = typename std::iterator_traits<Iterator>::iterator_category>
+        SmallVectorBase(Iterator first, Iterator last) : SmallVectorBase()
+        {
+            insert(end(), first, last);
+        }
+        
+        SmallVectorBase(const SmallVectorBase &other) : SmallVectorBase()
+        {
+            insert(end(), other.begin(), other.end());
+        }
+        
+        template <size_t OtherCapacity>
+        SmallVectorBase(const SmallVectorBase<T, OtherCapacity> &other) : SmallVectorBase()
+        {
+            insert(end(), other.begin(), other.end());
+        }
+        
+        // Moving between SmallVectors with the same inline capacity never
+        // allocates, so it can only throw if moving an item can.
+        SmallVectorBase(SmallVectorBase &&other) noexcept(std::is_nothrow_move_constructible<T>::value)
+         : SmallVectorBase()
+        {
+            take(other);
+        }
+        
+        template <size_t OtherCapacity>
+        SmallVectorBase(SmallVectorBase<T, OtherCapacity> &&other) : SmallVectorBase()
+        {
+            take(other);
+        }
+        
+        ~SmallVectorBase()
+        {
+            clear();
+            release();
+        }
+        
+        SmallVectorBase &operator=(const SmallVectorBase &other)
+        {
+            if (this != &other) {
+                clear();
+                insert(end(), other.begin(), other.end());
+            }
+            
+            return *this;
+        }
+        
+        SmallVectorBase &operator=(SmallVectorBase &&other) noexcept(std::is_nothrow_move_constructible<T>::value)
+        {
+            if (this != &other) {
+                clear();
+                take(other);
+            }
+            
+            return *this;
+        }
+        
+        iterator begin() { return items; }
+        iterator end() { return items + count; }
+        const_iterator begin() const { return items; }
+        const_iterator end() const { return items + count; }
+        const_iterator cbegin() const { return items; }
+        const_iterator cend() const { return items + count; }
+        reverse_iterator rbegin() { return reverse_iterator(end()); }
+        reverse_iterator rend() { return reverse_iterator(begin()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+        const_reverse_iterator crbegin() const { return rbegin(); }
+        const_reverse_iterator crend() const { return rend(); }
+        
+        T *data() { return items; }
+        const T *data() const { return items; }
+        size_t size() const { return count; }
+        size_t capacity() const { return allocated; }
+        bool empty() const { return count == 0; }
+        
+        // Whether the items are stored inline rather than in allocated memory.
+        bool isInline() const { return items == inlineItems(); }
+        
+        T &operator[](size_t index) { return items[index]; }
+        const T &operator[](size_t index) const { return items[index]; }
+        T &front() { return items[0]; }
+        const T &front() const { return items[0]; }
+        T &back() { return items[count - 1]; }
+        const T &back() const { return items[count - 1]; }
+        
+        void reserve(size_t size)
+        {
+            if (size > allocated) {
+                reallocate(size);
+            }
+        }
+        
+        // val is copied before growing, in case it's one of the items.
+        void push_back(const T &val)
+        {
+            if (count == allocated) {
+                T copy(val);
+                reallocate(grownCapacity(count + 1));
+                new (items + count) T(std::move(copy));
+            } else {
+                new (items + count) T(val);
+            }
+            
+            ++count;
+        }
+        
+        void push_back(T &&val)
+        {
+            emplace_back(std::move(val));
+        }
+        
+        template <class... Args>
+        void emplace_back(Args &&...args)
+        {
+            if (count == allocated) {
+                T made(std::forward<Args>(args)...);
+                reallocate(grownCapacity(count + 1));
+                new (items + count) T(std::move(made));
+            } else {
+                new (items + count) T(std::forward<Args>(args)...);
+            }
+            
+            ++count;
+        }
+        
+        void pop_back()
+        {
+            items[--count].~T();
+        }
+        
+        iterator insert(const_iterator pos, const T &val)
+        {
+            const size_t index = size_t(pos - items);
+            push_back(val);
+            std::rotate(items + index, items + count - 1, items + count);
+            return items + index;
+        }
+        
+        // Items are appended and then rotated into place.
+        template <class Iterator,
+                  class = typename std::iterator_traits<Iterator>::iterator_category>
+        iterator insert(const_iterator pos, Iterator first, Iterator last)
+        {
+            const size_t index = size_t(pos - items);
+            const size_t oldCount = count;
+            append(first, last, typename std::iterator_traits<Iterator>::iterator_category());
+            std::rotate(items + index, items + oldCount, items + count);
+            return items + index;
+        }
+        
+        iterator erase(const_iterator pos)
+        {
+            return erase(pos, pos + 1);
+        }
+        
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            iterator start = items + (first - items);
+            iterator newEnd = std::move(items + (last - items), end(), start);
+            destroy(newEnd, end());
+            count = size_t(newEnd - items);
+            return start;
+        }
+        
+        void resize(size_t size)
+        {
+            resizeWith(size, [] (T *item) { new (item) T(); });
+        }
+        
+        void resize(size_t size, const T &val)
+        {
+            if (size > allocated) {
+                T copy(val);
+                reallocate(size);
+                resizeWith(size, [&copy] (T *item) { new (item) T(copy); });
+            } else {
+                resizeWith(size, [&val] (T *item) { new (item) T(val); });
+            }
+        }
+        
+        void clear()
+        {
+            destroy(begin(), end());
+            count = 0;
+        }
+        
+        template <size_t OtherCapacity>
+        bool operator==(const SmallVectorBase<T, OtherCapacity> &other) const
+        {
+            return count == other.size() && std::equal(begin(), end(), other.begin());
+        }
+        
+        template <size_t OtherCapacity>
+        bool operator!=(const SmallVectorBase<T, OtherCapacity> &other) const
+        {
+            return !(*this == other);
+        }
+        
+        template <size_t OtherCapacity>
+        bool operator<(const SmallVectorBase<T, OtherCapacity> &other) const
+        {
+            return std::lexicographical_compare(begin(), end(), other.begin(), other.end());
+        }
+        
+    private:
+        template <class, size_t>
+        friend class SmallVectorBase;
+        
+        // There's always room for at least one item inline, so that items never
+        // points to an empty array.
+        enum { inlineSlots = inlineCapacity > 0 ? int(inlineCapacity) : 1 };
+        
+        T *inlineItems() const
+        {
+            return reinterpret_cast<T *>(const_cast<unsigned char *>(storage));
+        }
+        
+        size_t grownCapacity(size_t size) const
+        {
+            return std::max(size, allocated * 2);
+        }
+        
+        void reallocate(size_t newCapacity)
+        {
+            T *newItems = static_cast<T *>(::operator new(newCapacity * sizeof(T)));
+            
+            for(size_t i = 0; i < count; ++i) {
+                new (newItems + i) T(std::move(items[i]));
+                items[i].~T();
+            }
+            
+            release();
+            items = newItems;
+            allocated = newCapacity;
+        }
+        
+        void release()
+        {
+            if (!isInline()) {
+                ::operator delete(items);
+            }
+        }
+        
+        static void destroy(T *first, T *last)
+        {
+            for(; first != last; ++first) {
+                first->~T();
+            }
+        }
+        
+        template <class F>
+        void resizeWith(size_t size, const F &construct)
+        {
+            if (size < count) {
+                destroy(items + size, end());
+            } else {
+                reserve(size);
+                
+                for(size_t i = count; i < size; ++i) {
+                    construct(items + i);
+                }
+            }
+            
+            count = size;
+        }
+        
+        template <class Iterator>
+        void append(Iterator first, Iterator last, std::input_iterator_tag)
+        {
+            for(; first != last; ++first) {
+                emplace_back(*first);
+            }
+        }
+        
+        template <class Iterator>
+        void append(Iterator first, Iterator last, std::forward_iterator_tag)
+        {
+            reserve(count + size_t(std::distance(first, last)));
+            
+            for(; first != last; ++first, ++count) {
+                new (items + count) T(*first);
+            }
+        }
+        
+        // Allocated items are taken over from other, and inline ones are moved
+        // one at a time.
+        template <size_t OtherCapacity>
+        void take(SmallVectorBase<T, OtherCapacity> &other)
+        {
+            if (other.isInline()) {
+                reserve(other.count);
+                
+                for(size_t i = 0; i < other.count; ++i) {
+                    new (items + count) T(std::move(other.items[i]));
+                    ++count;
+                }
+                
+                other.clear();
+            } else {
+                release();
+                items = other.items;
+                count = other.count;
+                allocated = other.allocated;
+                other.items = other.inlineItems();
+                other.count = 0;
+                other.allocated = other.inlineCapacity;
+            }
+        }
+        
+        T *items;
+        size_t count;
+        size_t allocated;
+        alignas(T) unsigned char storage[sizeof(T) * inlineSlots];
+    };
+}
+
+template <class T>
+class SmallVector : public FuncHelpUtils::SmallVectorBase<T, 8> {
+public:
+    using FuncHelpUtils::SmallVectorBase<T, 8>::SmallVectorBase;
+};
+
+template <size_t N>
+struct SmallVectorOf {
+    template <class T>
+    class type : public FuncHelpUtils::SmallVectorBase<T, N> {
+    public:
+        using FuncHelpUtils::SmallVectorBase<T, N>::SmallVectorBase;
+    };
+};
+
+namespace FuncHelpUtils {
+    template<typename T>
+    struct is_small_vector {
+    private:
+        template<typename U, size_t N> static char test(const SmallVectorBase<U, N> *);
+        static int test(...);
+    public:
+        enum { value = sizeof(test(static_cast<const T *>(0))) == sizeof(char) };
+    };
+    
+    // Whether result should be grown by size items so that values can be
+    // compacted into it, rather than added one at a time. A SmallVector isn't
+    // grown past its inline capacity for that, since filtering a large
+    // container into one is expected to keep only a few values.
+    template <class Container>
+    inline bool shouldGrowBy(const Container &result, size_t size, std::false_type)
+    {
+        (void)result;
+        (void)size;
+        return true;
+    }
+    
+    template <class Container>
+    inline bool shouldGrowBy(const Container &result, size_t size, std::true_type)
+    {
+        return result.size() + size <= result.capacity();
+    }
+    
+    template <class Container>
+    inline bool shouldGrowBy(const Container &result, size_t size)
+    {
+        return shouldGrowBy(result, size, std::integral_constant<bool, is_small_vector<Container>::value>());
+    }
+}
+
+// map
+
+namespace FuncHelpUtils {
+    // The append* functions do the work of the functions of the same name,
+    // adding their results to an existing container. This lets results be
+    // built in containers that weren't default constructed, e.g. ones that
+    // use a particular allocator.
+    template <class OutType, class InType, class F>
+    void appendMapped(OutType &result, const InType &container, const F &func)
+    {
+        FuncHelpUtils::reserveSize(result, FuncHelpUtils::sizeHint(container));
+        FUNC_HELPERS_PROFILE_WATCH(result);
+        
+        for(auto const &val : container) {
+            FuncHelpUtils::addItem(result, std::ref(func)(decltype(val)(val)));
+            FUNC_HELPERS_PROFILE_VISIT(1);
+            FUNC_HELPERS_PROFILE_CALL(1);
+            FUNC_HELPERS_PROFILE_ADD(result, 1);
+        }
+        
+        FUNC_HELPERS_PROFILE_OUTPUT(result);
+    }
+}
+
+template <class OutType,
+          class InType,
+          class F>
+OutType map(const InType &container, const F &func)
+{
+    OutType result;
+    FUNC_HELPERS_PROFILE_SCOPE("map");
+    FuncHelpUtils::appendMapped(result, container, func);
+    return result;
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class InType,
+          class F>
+auto map(const InContainer<InType> &container, const F &func)
+ -> OutContainer<FuncHelpUtils::func_container_result<InContainer<InType>, F> >
+{
+    using OutType = FuncHelpUtils::func_container_result<InContainer<InType>, F>;
+    return map<OutContainer<OutType>, InContainer<InType> >(container, func);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class InType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto map(const InContainer<InType> &container, const F &func)
+ -> OutContainer<FuncHelpUtils::func_container_result<InContainer<InType>, F> >
+{
+    return map<InContainer, OutContainer>(container, func);
+}
+
+// When passed a temporary container and func returns the container's own
+// value type, the results are written back into the temporary's storage
+// rather than into a new container.
+template <template <class...> class InContainer,
+          class InType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<std::is_same<FuncHelpUtils::func_container_result<InContainer<InType>, F>, InType>::value &&
+                                             FuncHelpUtils::has_mutable_items<InContainer<InType> >::value> >
+auto map(InContainer<InType> &&container, const F &func)
+ -> InContainer<InType>
+{
+    FUNC_HELPERS_PROFILE_SCOPE("map");
+    
+    for(auto it = container.begin(); it != container.end(); ++it) {
+        *it = std::ref(func)(static_cast<const InType &>(*it));
+        FUNC_HELPERS_PROFILE_VISIT(1);
+        FUNC_HELPERS_PROFILE_CALL(1);
+    }
+    
+    FUNC_HELPERS_PROFILE_OUTPUT(container);
+    return std::move(container);
+}
+
+// compr
+
+namespace FuncHelpUtils {
+    template <class OutType, class InType, class F1, class F2>
+    void appendCompr(OutType &result, const InType &container, const F1 &func, const F2 &predicate)
+    {
+        FuncHelpUtils::reserveUpTo(result, FuncHelpUtils::sizeHint(container));
+        FUNC_HELPERS_PROFILE_WATCH(result);
+        
+        for(auto const &val : container) {
+            FUNC_HELPERS_PROFILE_VISIT(1);
+            FUNC_HELPERS_PROFILE_CALL(1);
+            
+            if (std::ref(predicate)(decltype(val)(val))) {
+                FuncHelpUtils::addItem(result, std::ref(func)(decltype(val)(val)));
+                FUNC_HELPERS_PROFILE_CALL(1);
+                FUNC_HELPERS_PROFILE_ADD(result, 1);
+            }
+        }
+        
+        FUNC_HELPERS_PROFILE_OUTPUT(result);
+    }
+}
+
+template <class OutType,
+          class InType,
+          class F1,
+          class F2>
+OutType compr(const InType &container, const F1 &func, const F2 &predicate)
+{
+    OutType result;
+    FUNC_HELPERS_PROFILE_SCOPE("compr");
+    FuncHelpUtils::appendCompr(result, container, func, predicate);
+    return result;
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class InType,
+          class F1,
+          class F2>
+auto compr(const InContainer<InType> &container, const F1 &func, const F2 &predicate)
+ -> OutContainer<FuncHelpUtils::func_container_result<InContainer<InType>, F1> >
+{
+    using OutType = FuncHelpUtils::func_container_result<InContainer<InType>, F1>;
+    return compr<OutContainer<OutType>, InContainer<InType> >(container, func, predicate);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class InType,
+          class F1,
+          class F2,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto compr(const InContainer<InType> &container, const F1 &func, const F2 &predicate)
+ -> OutContainer<FuncHelpUtils::func_container_result<InContainer<InType>, F1> >
+{
+    return compr<InContainer, OutContainer>(container, func, predicate);
+}
+
+// filter
+
+namespace FuncHelpUtils {
+    // Helper to determine whether a container stores small trivially copyable
+    // values contiguously, which filter and reject can copy without
+    // branching on each one. The result is resized before the values are
+    // assigned into it, so they must also be default constructible and copy
+    // assignable, which e.g. std::reference_wrapper isn't.
+    template<typename T>
+    struct is_contiguous_compactable {
+    private:
+        template<typename C> static auto test(C *c)
+         -> enable_if_t<std::is_same<decltype(static_cast<const C *>(c)->data()), const iterator_deref_decay<C> *>::value &&
+                        std::is_trivially_copyable<iterator_deref_decay<C> >::value &&
+                        std::is_default_constructible<iterator_deref_decay<C> >::value &&
+                        std::is_copy_assignable<iterator_deref_decay<C> >::value &&
+                        sizeof(iterator_deref_decay<C>) <= 16, char>;
+        template<typename C> static int  test(...);
+    public:
+        enum { value = sizeof(test<T>(0)) == sizeof(char) };
+    };
+    
+    // Helper to determine whether a container of ValType can be resized and
+    // have its values written to through data().
+    template<typename T, typename ValType>
+    struct is_resizable_contiguous {
+    private:
+        template<typename C> static auto test(C *c)
+         -> enable_if_t<std::is_same<decltype(c->data()), ValType *>::value &&
+                        std::is_same<decltype(c->resize(0)), void>::value, char>;
+        template<typename C> static int  test(...);
+    public:
+        enum { value = sizeof(test<T>(0)) == sizeof(char) };
+    };
+    
+    // Whether the values of InContainer that pass a filter can be compacted
+    // straight into OutContainer's storage.
+    template <class OutContainer, class InContainer>
+    struct can_compact_into {
+        enum { value = is_contiguous_compactable<InContainer>::value &&
+                       is_resizable_contiguous<OutContainer, iterator_deref_decay<InContainer> >::value };
+    };
+    
+    // Defined with the SIMD kernels below.
+    template <bool Keep, class T, class F>
+    size_t compact(const T *data, size_t size, const F &predicate, T *out);
+    
+    // keepIf removes each item in container for which predicate returns
+    // false, reusing container's storage. std::list and std::forward_list
+    // have their own remove_if, containers whose items can't be assigned to
+    // (i.e. sets) have to erase them one at a time, and everything else uses
+    // the erase-remove idiom.
+    template <class Container, class F>
+    auto keepIf(Container &container, const F &predicate)
+     -> enable_if_t<std::is_base_of<std::list<typename Container::value_type>, Container>::value ||
+                    std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value>
+    {
+        using ValType = typename Container::value_type;
+        container.remove_if([&predicate] (const ValType &val) { return !std::ref(predicate)(val); });
+    }
+    
+    template <class Container, class F>
+    auto keepIf(Container &container, const F &predicate)
+     -> enable_if_t<!std::is_base_of<std::list<typename Container::value_type>, Container>::value &&
+                    !std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value &&
+                    has_mutable_items<Container>::value &&
+                    !can_compact_into<Container, Container>::value>
+    {
+        using ValType = iterator_deref_decay<Container>;
+        container.erase(std::remove_if(container.begin(), container.end(),
+                                       [&predicate] (const ValType &val) { return !std::ref(predicate)(val); }),
+                        container.end());
+        FuncHelpUtils::shrinkSize(container);
+    }
+    
+    // Small trivially copyable values stored contiguously are compacted in
+    // place by CompactKernel.
+    template <class Container, class F>
+    auto keepIf(Container &container, const F &predicate)
+     -> enable_if_t<can_compact_into<Container, Container>::value>
+    {
+        using ValType = iterator_deref_decay<Container>;
+        size_t count = compact<true>(static_cast<const ValType *>(container.data()), size_t(container.size()),
+                                     predicate, container.data());
+        container.resize(typename Container::size_type(count));
+        FuncHelpUtils::shrinkSize(container);
+    }
+    
+    template <class Container, class F>
+    auto keepIf(Container &container, const F &predicate)
+     -> enable_if_t<!has_mutable_items<Container>::value>
+    {
+        for(auto it = container.begin(); it != container.end();) {
+            if (std::ref(predicate)(*it)) {
+                ++it;
+            } else {
+                it = container.erase(it);
+            }
+        }
+    }
+    
+    // moveIf moves each item in container for which predicate returns true
+    // into a new container of type OutContainer.
+    template <class OutContainer, class InContainer, class F>
+    OutContainer moveIf(InContainer &container, const F &predicate)
+    {
+        using ValType = iterator_deref_decay<InContainer>;
+        OutContainer result;
+        FuncHelpUtils::reserveUpTo(result, sizeHint(container));
+        FUNC_HELPERS_PROFILE_WATCH(result);
+        
+        for(auto it = container.begin(); it != container.end(); ++it) {
+            FUNC_HELPERS_PROFILE_VISIT(1);
+            FUNC_HELPERS_PROFILE_CALL(1);
+            
+            if (std::ref(predicate)(static_cast<const ValType &>(*it))) {
+                FuncHelpUtils::moveItem(result, std::move(*it));
+                FUNC_HELPERS_PROFILE_ADD(result, 1);
+            }
+        }
+        
+        FUNC_HELPERS_PROFILE_OUTPUT(result);
+        return result;
+    }
+    
+    // Keep is true for filter and false for reject.
+    template <bool Keep, class OutContainer, class InContainer, class F>
+    void appendFilteredBase(OutContainer &result, const InContainer &container, const F &predicate, std::false_type)
+    {
+        FuncHelpUtils::reserveUpTo(result, FuncHelpUtils::sizeHint(container));
+        FUNC_HELPERS_PROFILE_WATCH(result);
+        
+        for(auto const &val : container) {
+            FUNC_HELPERS_PROFILE_VISIT(1);
+            FUNC_HELPERS_PROFILE_CALL(1);
+            
+            if (bool(std::ref(predicate)(decltype(val)(val))) == Keep) {
+                FuncHelpUtils::addItem(result, val);
+                FUNC_HELPERS_PROFILE_ADD(result, 1);
+            }
+        }
+        
+        FUNC_HELPERS_PROFILE_OUTPUT(result);
+    }
+    
+    // result is grown to fit every value, the values that pass are compacted
+    // into it, and then it's shrunk down to the number that passed. If result
+    // had to grow for this, the storage it doesn't use is released too.
+    template <bool Keep, class OutContainer, class InContainer, class F>
+    void appendFilteredBase(OutContainer &result, const InContainer &container, const F &predicate, std::true_type)
+    {
+        using ValType = iterator_deref_decay<InContainer>;
+        using SizeType = typename OutContainer::size_type;
+        const size_t size = size_t(container.size());
+        const size_t start = size_t(result.size());
+        
+        if (!shouldGrowBy(result, size)) {
+            appendFilteredBase<Keep>(result, container, predicate, std::false_type());
+            return;
+        }
+        
+        const size_t capacity = size_t(result.capacity());
+        FUNC_HELPERS_PROFILE_WATCH(result);
+        result.resize(SizeType(start + size));
+        size_t count = compact<Keep>(static_cast<const ValType *>(container.data()), size, predicate, result.data() + start);
+        result.resize(SizeType(start + count));
+        FUNC_HELPERS_PROFILE_VISIT(size);
+        FUNC_HELPERS_PROFILE_CALL(size);
+        FUNC_HELPERS_PROFILE_ADD(result, count);
+        FUNC_HELPERS_PROFILE_OUTPUT(result);
+        
+        if (start + size > capacity) {
+            FuncHelpUtils::shrinkSize(result);
+        }
+    }
+    
+    template <bool Keep, class OutContainer, class InContainer, class F>
+    void appendFiltered(OutContainer &result, const InContainer &container, const F &predicate)
+    {
+        appendFilteredBase<Keep>(result, container, predicate,
+                                 std::integral_constant<bool, can_compact_into<OutContainer, InContainer>::value>());
+    }
+}
+
+template <class InContainer,
+          class OutContainer,
+          class F>
+OutContainer filter(const InContainer &container, const F &predicate)
+{
+    OutContainer result;
+    FUNC_HELPERS_PROFILE_SCOPE("filter");
+    FuncHelpUtils::appendFiltered<true>(result, container, predicate);
+    return result;
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class F>
+auto filter(const InContainer<ValType> &container, const F &predicate)
+ -> OutContainer<ValType>
+{
+    return filter<InContainer<ValType>, OutContainer<ValType>, F>(container, predicate);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto filter(const InContainer<ValType> &container, const F &predicate)
+ -> OutContainer<ValType>
+{
+    return filter<InContainer, OutContainer>(container, predicate);
+}
+
+// Temporary containers are filtered in place, or have their items moved into
+// the result when it's a different type of container.
+
+template <template <class...> class InContainer,
+          class ValType,
+          class F>
+auto filter(InContainer<ValType> &&container, const F &predicate)
+ -> InContainer<ValType>
+{
+    FUNC_HELPERS_PROFILE_SCOPE("filter");
+    FUNC_HELPERS_PROFILE_VISIT(std::distance(container.begin(), container.end()));
+    FUNC_HELPERS_PROFILE_CALL(std::distance(container.begin(), container.end()));
+    FuncHelpUtils::keepIf(container, predicate);
+    FUNC_HELPERS_PROFILE_OUTPUT(container);
+    return std::move(container);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto filter(InContainer<ValType> &&container, const F &predicate)
+ -> OutContainer<ValType>
+{
+    FUNC_HELPERS_PROFILE_SCOPE("filter");
+    return FuncHelpUtils::moveIf<OutContainer<ValType> >(container, predicate);
+}
+
+// reject
+
+template <class InContainer,
+          class OutContainer,
+          class F>
+OutContainer reject(const InContainer &container, const F &predicate)
+{
+    OutContainer result;
+    FUNC_HELPERS_PROFILE_SCOPE("reject");
+    FuncHelpUtils::appendFiltered<false>(result, container, predicate);
+    return result;
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class F>
+auto reject(const InContainer<ValType> &container, const F &predicate)
+ -> OutContainer<ValType>
+{
+    return reject<InContainer<ValType>, OutContainer<ValType>, F>(container, predicate);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto reject(const InContainer<ValType> &container, const F &predicate)
+ -> OutContainer<ValType>
+{
+    return reject<InContainer, OutContainer>(container, predicate);
+}
+
+template <template <class...> class InContainer,
+          class ValType,
+          class F>
+auto reject(InContainer<ValType> &&container, const F &predicate)
+ -> InContainer<ValType>
+{
+    FUNC_HELPERS_PROFILE_SCOPE("reject");
+    FUNC_HELPERS_PROFILE_VISIT(std::distance(container.begin(), container.end()));
+    FUNC_HELPERS_PROFILE_CALL(std::distance(container.begin(), container.end()));
+    FuncHelpUtils::keepIf(container, [&predicate] (const ValType &val) { return !std::ref(predicate)(val); });
+    FUNC_HELPERS_PROFILE_OUTPUT(container);
+    return std::move(container);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto reject(InContainer<ValType> &&container, const F &predicate)
+ -> OutContainer<ValType>
+{
+    FUNC_HELPERS_PROFILE_SCOPE("reject");
+    return FuncHelpUtils::moveIf<OutContainer<ValType> >(container, [&predicate] (const ValType &val) {
+        return !std::ref(predicate)(val);
+    });
+}
+
+// SIMD kernels
+
+// Containers that store arithmetic values contiguously (std::vector<int>,
+// QVector<double>, etc.) get specialized versions of sum, min, max, aggregate,
+// contains, allOf and anyOf. Each kernel is written as a loop over a fixed
+// number of independent lanes that compilers can vectorize. With GCC and Clang
+// on x86, each kernel is compiled for SSE2, AVX2 and AVX-512, and the best one
+// for the CPU is picked at runtime. Since the number of lanes doesn't depend on
+// the instruction set, every version gives bit-identical results.
+//
+// Define FUNC_HELPERS_NO_SIMD to turn off the runtime dispatch, leaving only
+// the portable version of each kernel.
+
+#if defined(_MSC_VER)
+#define FUNC_HELPERS_ALWAYS_INLINE __forceinline
+#else
+#define FUNC_HELPERS_ALWAYS_INLINE inline __attribute__((always_inline))
+#endif
+
+#if !defined(FUNC_HELPERS_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define FUNC_HELPERS_X86_DISPATCH 1
+#include <immintrin.h>
+#if defined(__clang__)
+#define FUNC_HELPERS_TARGET_AVX2 __attribute__((target("avx2")))
+#define FUNC_HELPERS_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl")))
+#else
+#define FUNC_HELPERS_TARGET_AVX2 __attribute__((target("avx2")))
+#define FUNC_HELPERS_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl,prefer-vector-width=512")))
+#endif
+#endif
+
+namespace FuncHelpUtils {
+    // Helper to determine whether a container stores arithmetic values
+    // (other than bool) contiguously, i.e. it has a data() method returning a
+    // pointer to its values.
+    template<typename T>
+    struct is_contiguous_arithmetic {
+    private:
+        template<typename C> static auto test(C *c)
+         -> enable_if_t<std::is_same<decltype(static_cast<const C *>(c)->data()), const iterator_deref_decay<C> *>::value &&
+                        std::is_arithmetic<iterator_deref_decay<C> >::value &&
+                        !std::is_same<iterator_deref_decay<C>, bool>::value, char>;
+        template<typename C> static int  test(...);
+    public:
+        enum { value = sizeof(test<T>(0)) == sizeof(char) };
+    };
+    
+    template <class Container>
+    using contiguous_arithmetic_tag = std::integral_constant<bool, is_contiguous_arithmetic<Container>::value>;
+    
+    // The type that wideSum accumulates values of type T in.
+    template <class T, class = void>
+    struct wide_type { using type = T; };
+    
+    template <class T>
+    struct wide_type<T, enable_if_t<std::is_integral<T>::value && std::is_signed<T>::value> > { using type = long long; };
+    
+    template <class T>
+    struct wide_type<T, enable_if_t<std::is_integral<T>::value && std::is_unsigned<T>::value> > { using type = unsigned long long; };
+    
+    template <>
+    struct wide_type<float> { using type = double; };
+    
+    template <class Acc>
+    struct kernel_lanes { enum { value = (sizeof(Acc) >= 64) ? 1 : int(64 / sizeof(Acc)) }; };
+    
+    // Sums values in Acc. Value i goes into lane i % Lanes, and the lanes are
+    // then added together pairwise.
+    template <class T, class Acc>
+    struct SumKernel {
+        static FUNC_HELPERS_ALWAYS_INLINE Acc run(const T *data, size_t size)
+        {
+            const int Lanes = kernel_lanes<Acc>::value;
+            Acc acc[Lanes] = {};
+            size_t i = 0;
+            
+            for(; i + Lanes <= size; i += Lanes) {
+                for(int j = 0; j < Lanes; ++j) {
+                    acc[j] += Acc(data[i + j]);
+                }
+            }
+            
+            for(; i < size; ++i) {
+                acc[i % Lanes] += Acc(data[i]);
+            }
+            
+            for(int width = Lanes / 2; width > 0; width /= 2) {
+                for(int j = 0; j < width; ++j) {
+                    acc[j] += acc[j + width];
+                }
+            }
+            
+            return acc[0];
+        }
+    };
+    
+    // Like SumKernel, but each lane uses Kahan summation to keep track of the
+    // error lost to rounding.
+    template <class T>
+    struct CompensatedSumKernel {
+        static FUNC_HELPERS_ALWAYS_INLINE T run(const T *data, size_t size)
+        {
+            const int Lanes = kernel_lanes<T>::value;
+            T acc[Lanes] = {};
+            T error[Lanes] = {};
+            size_t i = 0;
+            
+            for(; i + Lanes <= size; i += Lanes) {
+                for(int j = 0; j < Lanes; ++j) {
+                    T y = data[i + j] - error[j];
+                    T t = acc[j] + y;
+                    error[j] = (t - acc[j]) - y;
+                    acc[j] = t;
+                }
+            }
+            
+            for(; i < size; ++i) {
+                int j = int(i % Lanes);
+                T y = data[i] - error[j];
+                T t = acc[j] + y;
+                error[j] = (t - acc[j]) - y;
+                acc[j] = t;
+            }
+            
+            T result = T();
+            T resultError = T();
+            
+            for(int j = 0; j < Lanes; ++j) {
+                T y = (acc[j] - error[j]) - resultError;
+                T t = result + y;
+                resultError = (t - result) - y;
+                result = t;
+            }
+            
+            return result;
+        }
+    };
+    
+    // Finds the value for which comp(value, other) is true for every other
+    // value, keeping the earliest one per lane, like extremumBase. size must
+    // not be 0.
+    template <class T, class Comp>
+    struct ExtremumKernel {
+        static FUNC_HELPERS_ALWAYS_INLINE T run(const T *data, size_t size)
+        {
+            const int Lanes = kernel_lanes<T>::value;
+            const Comp comp = Comp();
+            T best[Lanes];
+            size_t i = 0;
+            
+            for(int j = 0; j < Lanes; ++j) {
+                best[j] = data[0];
+            }
+            
+            for(; i + Lanes <= size; i += Lanes) {
+                for(int j = 0; j < Lanes; ++j) {
+                    best[j] = comp(data[i + j], best[j]) ? data[i + j] : best[j];
+                }
+            }
+            
+            for(; i < size; ++i) {
+                best[i % Lanes] = comp(data[i], best[i % Lanes]) ? data[i] : best[i % Lanes];
+            }
+            
+            for(int width = Lanes / 2; width > 0; width /= 2) {
+                for(int j = 0; j < width; ++j) {
+                    best[j] = comp(best[j + width], best[j]) ? best[j + width] : best[j];
+                }
+            }
+            
+            return best[0];
+        }
+    };
+    
+    template <class T>
+    struct Less {
+        bool operator()(const T &a, const T &b) const { return a < b; }
+    };
+    
+    template <class T>
+    struct Greater {
+        bool operator()(const T &a, const T &b) const { return a > b; }
+    };
+    
+    // allOf, anyOf and contains test values in blocks so that the tests
+    // within a block can be vectorized, and only check whether they're done
+    // at the end of each block. That means predicate may be called on up to
+    // KernelBlockSize - 1 values after the one that determines the result, so
+    // allOf and anyOf only do this for predicates wrapped in purePredicate.
+    enum { KernelBlockSize = 32 };
+    
+    // Returns true if bool(predicate(value)) == Expected for every value.
+    template <class T, class F, bool Expected>
+    struct AllMatchKernel {
+        static FUNC_HELPERS_ALWAYS_INLINE bool run(const T *data, size_t size, const F *predicate)
+        {
+            size_t i = 0;
+            
+            for(; i + KernelBlockSize <= size; i += KernelBlockSize) {
+                bool match = true;
+                
+                for(int j = 0; j < KernelBlockSize; ++j) {
+                    match &= (bool(std::ref(*predicate)(data[i + j])) == Expected);
+                }
+                
+                if (!match) {
+                    return false;
+                }
+            }
+            
+            for(; i < size; ++i) {
+                if (bool(std::ref(*predicate)(data[i])) != Expected) {
+                    return false;
+                }
+            }
+            
+            return true;
+        }
+    };
+    
+    template <class T>
+    struct ContainsKernel {
+        static FUNC_HELPERS_ALWAYS_INLINE bool run(const T *data, size_t size, T target)
+        {
+            size_t i = 0;
+            
+            for(; i + KernelBlockSize <= size; i += KernelBlockSize) {
+                int found = 0;
+                
+                for(int j = 0; j < KernelBlockSize; ++j) {
+                    found |= (data[i + j] == target);
+                }
+                
+                if (found) {
+                    return true;
+                }
+            }
+            
+            for(; i < size; ++i) {
+                if (data[i] == target) {
+                    return true;
+                }
+            }
+            
+            return false;
+        }
+    };
+    
+    // Copies each value for which bool(predicate(value)) == Keep to out, and
+    // returns how many were copied. Every value is stored at out[count], and
+    // count only advances past the ones being kept, which avoids a hard to
+    // predict branch per value when about half of them pass. out must have
+    // room for size values, and may be the same as data.
+    template <class T, class F, bool Keep>
+    struct CompactKernel {
+        static FUNC_HELPERS_ALWAYS_INLINE size_t run(const T *data, size_t size, const F *predicate, T *out)
+        {
+            size_t count = 0;
+            
+            for(const T *it = data; it != data + size; ++it) {
+                const bool keep = (bool(std::ref(*predicate)(*it)) == Keep);
+                out[count] = *it;
+                count += keep;
+            }
+            
+            return count;
+        }
+    };
+    
+    // What StatsKernel computes for aggregate. mean and variance are only
+    // filled in when asked for.
+    template <class T>
+    struct ArithmeticStats {
+        size_t count;
+        T min;
+        T max;
+        T sum;
+        double mean;
+        double variance;
+    };
+    
+    // Computes the statistics that aggregate's reducers need in one pass.
+    // The minimum, maximum and sum are found with the same lanes as
+    // ExtremumKernel and SumKernel, so they're identical to what min, max and
+    // sum return. The mean and variance are computed from sums of each
+    // value's difference from the first value, which keeps the variance
+    // accurate when the values are large compared to how much they vary.
+    // Sum, Extrema and Moments say which of these a reducer needs; the rest
+    // are left out of the loop and come back as the first value or 0. size
+    // must not be 0.
+    template <class T, bool Sum, bool Extrema, bool Moments>
+    struct StatsKernel {
+        static FUNC_HELPERS_ALWAYS_INLINE ArithmeticStats<T> run(const T *data, size_t size)
+        {
+            const int Lanes = kernel_lanes<T>::value;
+            const double shift = double(data[0]);
+            T sum[Lanes] = {};
+            T lowest[Lanes];
+            T highest[Lanes];
+            double sum1[Lanes] = {};
+            double sum2[Lanes] = {};
+            size_t i = 0;
+            
+            for(int j = 0; j < Lanes; ++j) {
+                lowest[j] = data[0];
+                highest[j] = data[0];
+            }
+            
+            for(; i + Lanes <= size; i += Lanes) {
+                for(int j = 0; j < Lanes; ++j) {
+                    const T val = data[i + j];
+                    
+                    if (Sum) {
+                        sum[j] += val;
+                    }
+                    
+                    if (Extrema) {
+                        lowest[j] = (val < lowest[j]) ? val : lowest[j];
+                        highest[j] = (val > highest[j]) ? val : highest[j];
+                    }
+                    
+                    if (Moments) {
+                        const double d = double(val) - shift;
+                        sum1[j] += d;
+                        sum2[j] += d*d;
+                    }
+                }
+            }
+            
+            for(; i < size; ++i) {
+                const int j = int(i % Lanes);
+                const T val = data[i];
+                
+                if (Sum) {
+                    sum[j] += val;
+                }
+                
+                if (Extrema) {
+                    lowest[j] = (val < lowest[j]) ? val : lowest[j];
+                    highest[j] = (val > highest[j]) ? val : highest[j];
+                }
+                
+                if (Moments) {
+                    const double d = double(val) - shift;
+                    sum1[j] += d;
+                    sum2[j] += d*d;
+                }
+            }
+            
+            for(int width = Lanes / 2; width > 0; width /= 2) {
+                for(int j = 0; j < width; ++j) {
+                    if (Sum) {
+                        sum[j] += sum[j + width];
+                    }
+                    
+                    if (Extrema) {
+                        lowest[j] = (lowest[j + width] < lowest[j]) ? lowest[j + width] : lowest[j];
+                        highest[j] = (highest[j + width] > highest[j]) ? highest[j + width] : highest[j];
+                    }
+                    
+                    if (Moments) {
+                        sum1[j] += sum1[j + width];
+                        sum2[j] += sum2[j + width];
+                    }
+                }
+            }
+            
+            const double n = double(size);
+            const double variance = (sum2[0] - sum1[0]*sum1[0]/n)/n;
+            ArithmeticStats<T> result = {size, lowest[0], highest[0], sum[0], shift + sum1[0]/n,
+                                         (variance > 0) ? variance : 0.0};
+            return result;
+        }
+    };
+    
+#ifdef FUNC_HELPERS_X86_DISPATCH
+    // 0 for SSE2, 1 for AVX2, 2 for AVX-512
+    inline int simdLevel()
+    {
+        static const int level = [] {
+            __builtin_cpu_init();
+            
+            if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+                __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl")) {
+                return 2;
+            } else if (__builtin_cpu_supports("avx2")) {
+                return 1;
+            } else {
+                return 0;
+            }
+        }();
+        
+        return level;
+    }
+    
+    template <class Kernel, class... Args>
+    FUNC_HELPERS_TARGET_AVX2 auto runKernelAvx2(Args... args) -> decltype(Kernel::run(args...))
+    {
+        return Kernel::run(args...);
+    }
+    
+    template <class Kernel, class... Args>
+    FUNC_HELPERS_TARGET_AVX512 auto runKernelAvx512(Args... args) -> decltype(Kernel::run(args...))
+    {
+        return Kernel::run(args...);
+    }
+#endif
+    
+    // Runs Kernel using the best instruction set available.
+    template <class Kernel, class... Args>
+    auto runKernel(Args... args) -> decltype(Kernel::run(args...))
+    {
+#ifdef FUNC_HELPERS_X86_DISPATCH
+        switch (simdLevel()) {
+            case 2:
+                return runKernelAvx512<Kernel>(args...);
+            case 1:
+                return runKernelAvx2<Kernel>(args...);
+        }
+#endif
+        return Kernel::run(args...);
+    }
+    
+#ifdef FUNC_HELPERS_X86_DISPATCH
+    // With AVX-512, 4 and 8 byte values are compacted a vector at a time: the
+    // predicate is evaluated for each value into a mask, and vpcompressd or
+    // vpcompressq stores the values whose bits are set next to each other.
+    FUNC_HELPERS_TARGET_AVX512 inline void compressStore(void *out, unsigned mask, const void *data,
+                                                         std::integral_constant<size_t, 4>)
+    {
+        _mm512_mask_compressstoreu_epi32(out, __mmask16(mask), _mm512_loadu_si512(data));
+    }
+    
+    FUNC_HELPERS_TARGET_AVX512 inline void compressStore(void *out, unsigned mask, const void *data,
+                                                         std::integral_constant<size_t, 8>)
+    {
+        _mm512_mask_compressstoreu_epi64(out, __mmask8(mask), _mm512_loadu_si512(data));
+    }
+    
+    template <class T, class F, bool Keep>
+    FUNC_HELPERS_TARGET_AVX512 size_t compactAvx512(const T *data, size_t size, const F *predicate, T *out)
+    {
+        const int Lanes = int(64 / sizeof(T));
+        size_t count = 0;
+        size_t i = 0;
+        
+        for(; i + Lanes <= size; i += Lanes) {
+            unsigned mask = 0;
+            
+            for(int j = 0; j < Lanes; ++j) {
+                mask |= unsigned(bool(std::ref(*predicate)(data[i + j])) == Keep) << j;
+            }
+            
+            compressStore(out + count, mask, data + i, std::integral_constant<size_t, sizeof(T)>());
+            count += size_t(__builtin_popcount(mask));
+        }
+        
+        return count + CompactKernel<T, F, Keep>::run(data + i, size - i, predicate, out + count);
+    }
+#endif
+    
+    template <class T, class F, bool Keep>
+    size_t compact(const T *data, size_t size, const F *predicate, T *out, std::false_type)
+    {
+        return runKernel<CompactKernel<T, F, Keep> >(data, size, predicate, out);
+    }
+    
+    template <class T, class F, bool Keep>
+    size_t compact(const T *data, size_t size, const F *predicate, T *out, std::true_type)
+    {
+#ifdef FUNC_HELPERS_X86_DISPATCH
+        if (simdLevel() == 2) {
+            return compactAvx512<T, F, Keep>(data, size, predicate, out);
+        }
+#endif
+        return runKernel<CompactKernel<T, F, Keep> >(data, size, predicate, out);
+    }
+    
+    // Runs CompactKernel, or compactAvx512 where it applies.
+    template <bool Keep, class T, class F>
+    size_t compact(const T *data, size_t size, const F &predicate, T *out)
+    {
+        return compact<T, F, Keep>(data, size, &predicate, out,
+                                   std::integral_constant<bool, sizeof(T) == 4 || sizeof(T) == 8>());
+    }
+}
+
+// partition
+
+namespace FuncHelpUtils {
+    // Like CompactKernel, but values that fail are compacted into failed
+    // rather than being dropped. Returns how many values passed.
+    template <class T, class F>
+    struct PartitionKernel {
+        static FUNC_HELPERS_ALWAYS_INLINE size_t run(const T *data, size_t size, const F *predicate, T *passed, T *failed)
+        {
+            size_t passedCount = 0;
+            size_t failedCount = 0;
+            
+            for(const T *it = data; it != data + size; ++it) {
+                const bool pass = bool(std::ref(*predicate)(*it));
+                passed[passedCount] = *it;
+                failed[failedCount] = *it;
+                passedCount += pass;
+                failedCount += !pass;
+            }
+            
+            return passedCount;
+        }
+    };
+    
+    template <class OutContainer, class InContainer, class F>
+    void appendPartitioned(OutContainer &passed, OutContainer &failed, const InContainer &container, const F &predicate,
+                           std::false_type)
+    {
+        FuncHelpUtils::reserveUpTo(passed, FuncHelpUtils::sizeHint(container));
+        FuncHelpUtils::reserveUpTo(failed, FuncHelpUtils::sizeHint(container));
+        
+        for(auto const &val : container) {
+            FuncHelpUtils::addItem(std::ref(predicate)(decltype(val)(val)) ? passed : failed, val);
+        }
+    }
+    
+    // Both outputs are grown to fit every value, and then shrunk down to the
+    // values they got, releasing the storage they don't use.
+    template <class OutContainer, class InContainer, class F>
+    void appendPartitioned(OutContainer &passed, OutContainer &failed, const InContainer &container, const F &predicate,
+                           std::true_type)
+    {
+        using ValType = iterator_deref_decay<InContainer>;
+        using SizeType = typename OutContainer::size_type;
+        const size_t size = size_t(container.size());
+        
+        passed.resize(SizeType(size));
+        failed.resize(SizeType(size));
+        size_t count = runKernel<PartitionKernel<ValType, F> >(static_cast<const ValType *>(container.data()), size,
+                                                               &predicate, passed.data(), failed.data());
+        passed.resize(SizeType(count));
+        failed.resize(SizeType(size - count));
+        FuncHelpUtils::shrinkSize(passed);
+        FuncHelpUtils::shrinkSize(failed);
+    }
+    
+    template <class OutContainer, class InContainer, class F>
+    std::pair<OutContainer, OutContainer> partitionBase(const InContainer &container, const F &predicate)
+    {
+        std::pair<OutContainer, OutContainer> result;
+        appendPartitioned(result.first, result.second, container, predicate,
+                          std::integral_constant<bool, can_compact_into<OutContainer, InContainer>::value>());
+        return result;
+    }
+    
+    // Items are moved out of temporary containers, unless they're cheap
+    // enough to copy that they can be partitioned by PartitionKernel.
+    template <class OutContainer, class InContainer, class F>
+    std::pair<OutContainer, OutContainer> movePartitioned(InContainer &container, const F &predicate, std::false_type)
+    {
+        using ValType = iterator_deref_decay<InContainer>;
+        std::pair<OutContainer, OutContainer> result;
+        FuncHelpUtils::reserveUpTo(result.first, sizeHint(container));
+        FuncHelpUtils::reserveUpTo(result.second, sizeHint(container));
+        
+        for(auto it = container.begin(); it != container.end(); ++it) {
+            OutContainer &output = std::ref(predicate)(static_cast<const ValType &>(*it)) ? result.first : result.second;
+            FuncHelpUtils::moveItem(output, std::move(*it));
+        }
+        
+        return result;
+    }
+    
+    template <class OutContainer, class InContainer, class F>
+    std::pair<OutContainer, OutContainer> movePartitioned(InContainer &container, const F &predicate, std::true_type)
+    {
+        return partitionBase<OutContainer>(container, predicate);
+    }
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class F>
+auto partition(const InContainer<ValType> &container, const F &predicate)
+ -> std::pair<OutContainer<ValType>, OutContainer<ValType> >
+{
+    return FuncHelpUtils::partitionBase<OutContainer<ValType> >(container, predicate);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto partition(const InContainer<ValType> &container, const F &predicate)
+ -> std::pair<OutContainer<ValType>, OutContainer<ValType> >
+{
+    return partition<InContainer, OutContainer>(container, predicate);
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_mutable_items<InContainer<ValType> >::value> >
+auto partition(InContainer<ValType> &&container, const F &predicate)
+ -> std::pair<OutContainer<ValType>, OutContainer<ValType> >
+{
+    using OutType = OutContainer<ValType>;
+    return FuncHelpUtils::movePartitioned<OutType>(container, predicate,
+        std::integral_constant<bool, FuncHelpUtils::can_compact_into<OutType, InContainer<ValType> >::value>());
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value &&
+                                             FuncHelpUtils::has_mutable_items<InContainer<ValType> >::value> >
+auto partition(InContainer<ValType> &&container, const F &predicate)
+ -> std::pair<OutContainer<ValType>, OutContainer<ValType> >
+{
+    return partition<InContainer, OutContainer>(std::move(container), predicate);
+}
+
+// partitionBy
+
+// classifier returns the index of the bucket each value goes into. Values
+// whose index isn't in [0, bucketCount) aren't put in any bucket.
+
+namespace FuncHelpUtils {
+    template <class OutContainer, class InContainer, class F>
+    std::vector<OutContainer> partitionByBase(const InContainer &container, const F &classifier, int bucketCount)
+    {
+        std::vector<OutContainer> result(size_t(std::max(bucketCount, 0)));
+        
+        for(auto const &val : container) {
+            const size_t index = size_t(std::ref(classifier)(decltype(val)(val)));
+            
+            if (index < result.size()) {
+                FuncHelpUtils::addItem(result[index], val);
+            }
+        }
+        
+        return result;
+    }
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class F>
+auto partitionBy(const InContainer<ValType> &container, const F &classifier, int bucketCount)
+ -> std::vector<OutContainer<ValType> >
+{
+    return FuncHelpUtils::partitionByBase<OutContainer<ValType> >(container, classifier, bucketCount);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto partitionBy(const InContainer<ValType> &container, const F &classifier, int bucketCount)
+ -> std::vector<OutContainer<ValType> >
+{
+    return partitionBy<InContainer, OutContainer>(container, classifier, bucketCount);
+}
+
+// groupBy, countBy and keyBy
+
+// key(value) gives the key that each value is filed under. groupBy returns a
+// hash map from each key to a container of the values with that key, in the
+// order they appear in container; countBy maps each key to how many values
+// have it; and keyBy maps each key to the last value that has it. Each is
+// built in one pass, with buckets reserved for as many keys as there are
+// values.
+//
+// The hash map is a std::unordered_map, or a QHash when container is a Qt
+// container, qtFunctionalHelpers.h is included and qHash supports the key.
+
+namespace FuncHelpUtils {
+    // Picks the type of hash map that groupBy, countBy and keyBy return for
+    // InContainer. Specialized in qtFunctionalHelpers.h.
+    template <class InContainer, class Key, class Value, class = void>
+    struct hash_map_for {
+        using type = std::unordered_map<Key, Value>;
+    };
+    
+    template <class InContainer, class F, class Value>
+    using grouped_map = typename hash_map_for<InContainer, func_container_result<InContainer, F>, Value>::type;
+    
+    template <class Map, class Key, class Value>
+    void setItem(Map &map, const Key &key, Value &&value)
+    {
+        map[key] = std::forward<Value>(value);
+    }
+    
+    // Doesn't need Value to be default constructible.
+    template <class K, class U, class H, class E, class A, class Value>
+    void setItem(std::unordered_map<K, U, H, E, A> &map, const K &key, Value &&value)
+    {
+        auto found = map.find(key);
+        
+        if (found == map.end()) {
+            map.emplace(key, std::forward<Value>(value));
+        } else {
+            found->second = std::forward<Value>(value);
+        }
+    }
+    
+    template <class Map, class Iterator, class F>
+    void appendGroups(Map &result, Iterator begin, Iterator end, const F &key)
+    {
+        for(auto it = begin; it != end; ++it) {
+            auto const &val = *it;
+            FuncHelpUtils::addItem(result[std::ref(key)(decltype(val)(val))], val);
+        }
+    }
+    
+    template <class Map, class Iterator, class F>
+    void moveGroups(Map &result, Iterator begin, Iterator end, const F &key)
+    {
+        for(auto it = begin; it != end; ++it) {
+            auto const &val = *it;
+            FuncHelpUtils::moveItem(result[std::ref(key)(val)], std::move(*it));
+        }
+    }
+    
+    template <class Map, class Iterator, class F>
+    void appendCounts(Map &result, Iterator begin, Iterator end, const F &key)
+    {
+        for(auto it = begin; it != end; ++it) {
+            auto const &val = *it;
+            ++result[std::ref(key)(decltype(val)(val))];
+        }
+    }
+    
+    template <class Map, class Iterator, class F>
+    void appendKeyed(Map &result, Iterator begin, Iterator end, const F &key)
+    {
+        for(auto it = begin; it != end; ++it) {
+            auto const &val = *it;
+            FuncHelpUtils::setItem(result, std::ref(key)(decltype(val)(val)), val);
+        }
+    }
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class F>
+auto groupBy(const InContainer<ValType> &container, const F &key)
+ -> FuncHelpUtils::grouped_map<InContainer<ValType>, F, OutContainer<ValType> >
+{
+    FuncHelpUtils::grouped_map<InContainer<ValType>, F, OutContainer<ValType> > result;
+    FuncHelpUtils::reserveSize(result, FuncHelpUtils::sizeHint(container));
+    FuncHelpUtils::appendGroups(result, container.begin(), container.end(), key);
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto groupBy(const InContainer<ValType> &container, const F &key)
+ -> FuncHelpUtils::grouped_map<InContainer<ValType>, F, OutContainer<ValType> >
+{
+    return groupBy<InContainer, OutContainer>(container, key);
+}
+
+// Values are moved out of temporary containers into their groups.
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_mutable_items<InContainer<ValType> >::value> >
+auto groupBy(InContainer<ValType> &&container, const F &key)
+ -> FuncHelpUtils::grouped_map<InContainer<ValType>, F, OutContainer<ValType> >
+{
+    FuncHelpUtils::grouped_map<InContainer<ValType>, F, OutContainer<ValType> > result;
+    FuncHelpUtils::reserveSize(result, FuncHelpUtils::sizeHint(container));
+    FuncHelpUtils::moveGroups(result, container.begin(), container.end(), key);
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value &&
+                                             FuncHelpUtils::has_mutable_items<InContainer<ValType> >::value> >
+auto groupBy(InContainer<ValType> &&container, const F &key)
+ -> FuncHelpUtils::grouped_map<InContainer<ValType>, F, OutContainer<ValType> >
+{
+    return groupBy<InContainer, OutContainer>(std::move(container), key);
+}
+
+template <class Container, class F>
+auto countBy(const Container &container, const F &key)
+ -> FuncHelpUtils::grouped_map<Container, F, size_t>
+{
+    FuncHelpUtils::grouped_map<Container, F, size_t> result;
+    FuncHelpUtils::reserveSize(result, FuncHelpUtils::sizeHint(container));
+    FuncHelpUtils::appendCounts(result, container.begin(), container.end(), key);
+    return result;
+}
+
+template <class Container, class F>
+auto keyBy(const Container &container, const F &key)
+ -> FuncHelpUtils::grouped_map<Container, F, FuncHelpUtils::iterator_deref_decay<Container> >
+{
+    FuncHelpUtils::grouped_map<Container, F, FuncHelpUtils::iterator_deref_decay<Container> > result;
+    FuncHelpUtils::reserveSize(result, FuncHelpUtils::sizeHint(container));
+    FuncHelpUtils::appendKeyed(result, container.begin(), container.end(), key);
+    return result;
+}
+
+// all of
+
+namespace FuncHelpUtils {
+    template <class F>
+    struct PurePredicate {
+        template <class T>
+        auto operator()(const T &val) const -> decltype(std::ref(std::declval<const F &>())(val))
+        {
+            return std::ref(predicate)(val);
+        }
+        
+        F predicate;
+    };
+    
+    template <class F>
+    struct is_pure_predicate : std::false_type {};
+    
+    template <class F>
+    struct is_pure_predicate<PurePredicate<F> > : std::true_type {};
+    
+    template <class Container, class F>
+    using block_match_tag = std::integral_constant<bool, is_contiguous_arithmetic<Container>::value &&
+                                                         is_pure_predicate<F>::value>;
+    
+    template <bool Expected, class Container, class F>
+    bool allMatch(Container const &container, const F &f, std::false_type)
+    {
+        for(auto const &val : container) {
+            if (bool(std::ref(f)(decltype(val)(val))) != Expected) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    template <bool Expected, class Container, class F>
+    bool allMatch(Container const &container, const F &f, std::true_type)
+    {
+        using ValType = iterator_deref_decay<Container>;
+        return runKernel<AllMatchKernel<ValType, F, Expected> >(container.data(), size_t(container.size()), &f);
+    }
+}
+
+// purePredicate(predicate) promises that predicate is cheap and has no side
+// effects, so that allOf and anyOf may test contiguous arithmetic values in
+// vectorized blocks, calling it on values past the one that decides the
+// result. Other predicates are only called until the result is known.
+template <class F>
+FuncHelpUtils::PurePredicate<F> purePredicate(const F &predicate)
+{
+    return FuncHelpUtils::PurePredicate<F>{predicate};
+}
+
+template <class Container, class F>
+bool allOf(Container const &container, const F &f)
+{
+    return FuncHelpUtils::allMatch<true>(container, f, FuncHelpUtils::block_match_tag<Container, F>());
+}
+
+// any of
+
+template <class Container, class F>
+bool anyOf(Container const &container, const F &f)
+{
+    return !FuncHelpUtils::allMatch<false>(container, f, FuncHelpUtils::block_match_tag<Container, F>());
+}
+
+// extremum
+
+namespace FuncHelpUtils {
+    // Returns an iterator rather than a pointer to the value, so that this
+    // also works for containers like LazyRange whose iterators return values
+    // rather than references. Returns container.end() if container is empty.
+    template <class Container, class F>
+    auto extremumBase(const Container &container, const F &comp)
+     -> decltype(container.begin())
+    {
+        auto extremumValue = container.begin();
+        const auto end = container.end();
+        
+        if (extremumValue == end) {
+            return extremumValue;
+        }
+        
+        for(auto it = std::next(extremumValue); it != end; ++it) {
+            if (std::ref(comp)(iterator_deref<Container>(*it), iterator_deref<Container>(*extremumValue))) {
+                extremumValue = it;
+            }
+        }
+    
+        return extremumValue;
+    }
+}
+
+template <class Container, class F>
+auto extremum(const Container &container, const F &comp)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
+    auto extremumValue = FuncHelpUtils::extremumBase(container, comp);
+    
+    if (extremumValue != container.end()) {
+        return *extremumValue;
+    } else {
+        return ValType();
+    }
+}
+
+template <class Container, class F, class ValType>
+auto extremum(const Container &container, const F &comp, const ValType &defaultVal)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    auto extremumValue = FuncHelpUtils::extremumBase(container, comp);
+    
+    if (extremumValue != container.end()) {
+        return *extremumValue;
+    } else {
+        return defaultVal;
+    }
+}
+
+namespace FuncHelpUtils {
+    template <class Comp, class Container, class ValType>
+    ValType extremumOr(const Container &container, const ValType &defaultVal, std::false_type)
+    {
+        return ::extremum(container, Comp(), defaultVal);
+    }
+    
+    template <class Comp, class Container, class ValType>
+    ValType extremumOr(const Container &container, const ValType &defaultVal, std::true_type)
+    {
+        if (container.size() == 0) {
+            return defaultVal;
+        }
+        
+        return runKernel<ExtremumKernel<ValType, Comp> >(container.data(), size_t(container.size()));
+    }
+    
+    template <class Container, class ValType>
+    using contiguous_arithmetic_of_tag = std::integral_constant<bool, is_contiguous_arithmetic<Container>::value &&
+                                                                      std::is_same<iterator_deref_decay<Container>, ValType>::value>;
+}
+
+// min(container)
+
+template <class Container>
+auto min(const Container &container)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
+    return FuncHelpUtils::extremumOr<FuncHelpUtils::Less<ValType> >(container, ValType(), FuncHelpUtils::contiguous_arithmetic_tag<Container>());
+}
+
+template <class Container,
+          class ValType,
+          class = FuncHelpUtils::enable_if_t<!FuncHelpUtils::is_callable<ValType, FuncHelpUtils::iterator_deref<Container> >::value> >
+auto min(const Container &container, const ValType &defaultVal)
+ -> ValType
+{
+    return FuncHelpUtils::extremumOr<FuncHelpUtils::Less<ValType> >(container, defaultVal, FuncHelpUtils::contiguous_arithmetic_of_tag<Container, ValType>());
+}
+
+// min(container, func)
+
+namespace FuncHelpUtils {
+    template <class Container, class F>
+    auto minBase(const Container &container, const F &func)
+     -> decltype(container.begin())
+    {
+        using W = func_container_result<Container, F>;
+        auto extremumValue = container.begin();
+        const auto end = container.end();
+        
+        if (extremumValue == end) {
+            return extremumValue;
+        }
+        
+        W extremumComparator = std::ref(func)(iterator_deref<Container>(*extremumValue));
+        
+        for(auto it = std::next(extremumValue); it != end; ++it) {
+            W currentComparator = std::ref(func)(iterator_deref<Container>(*it));
+            
+            if (currentComparator < extremumComparator) {
+                extremumValue = it;
+                extremumComparator = currentComparator;
+            }
+        }
+    
+        return extremumValue;
+    }
+}
+
+template <class Container,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_callable<F, FuncHelpUtils::iterator_deref<Container> >::value> >
+auto min(const Container &container, const F &func)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
+    auto extremumValue = FuncHelpUtils::minBase(container, func);
+
+    if (extremumValue != container.end()) {
+        return *extremumValue;
+    } else {
+        return ValType();
+    }
+}
+
+template <class Container, class F, class ValType>
+ValType min(const Container &container, const F &func, const ValType &defaultVal)
+{
+    auto extremumValue = FuncHelpUtils::minBase(container, func);
+
+    if (extremumValue != container.end()) {
+        return *extremumValue;
+    } else {
+        return defaultVal;
+    }
+}
+
+// max(container)
+
+template <class Container>
+auto max(const Container &container)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
+    return FuncHelpUtils::extremumOr<FuncHelpUtils::Greater<ValType> >(container, ValType(), FuncHelpUtils::contiguous_arithmetic_tag<Container>());
+}
+
+template <class Container,
+          class ValType,
+          class = FuncHelpUtils::enable_if_t<!FuncHelpUtils::is_callable<ValType, FuncHelpUtils::iterator_deref<Container> >::value> >
+auto max(const Container &container, const ValType &defaultVal)
+ -> ValType
+{
+    return FuncHelpUtils::extremumOr<FuncHelpUtils::Greater<ValType> >(container, defaultVal, FuncHelpUtils::contiguous_arithmetic_of_tag<Container, ValType>());
+}
+
+// max(container, func)
+
+namespace FuncHelpUtils {
+    template <class Container, class F>
+    auto maxBase(const Container &container, const F &func)
+     -> decltype(container.begin())
+    {
+        using W = func_container_result<Container, F>;
+        auto extremumValue = container.begin();
+        const auto end = container.end();
+        
+        if (extremumValue == end) {
+            return extremumValue;
+        }
+        
+        W extremumComparator = std::ref(func)(iterator_deref<Container>(*extremumValue));
+        
+        for(auto it = std::next(extremumValue); it != end; ++it) {
+            W currentComparator = std::ref(func)(iterator_deref<Container>(*it));
+            
+            if (currentComparator > extremumComparator) {
+                extremumValue = it;
+                extremumComparator = currentComparator;
+            }
+        }
+    
+        return extremumValue;
+    }
+}
+
+template <class Container,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_callable<F, FuncHelpUtils::iterator_deref<Container> >::value> >
+auto max(const Container &container, const F &func)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
+    auto extremumValue = FuncHelpUtils::maxBase(container, func);
+
+    if (extremumValue != container.end()) {
+        return *extremumValue;
+    } else {
+        return ValType();
+    }
+}
+
+template <class Container, class F, class ValType>
+ValType max(const Container &container, const F &func, const ValType &defaultVal)
+{
+    auto extremumValue = FuncHelpUtils::maxBase(container, func);
+
+    if (extremumValue != container.end()) {
+        return *extremumValue;
+    } else {
+        return defaultVal;
+    }
+}
+
+// minN, maxN and topK
+
+// These select the best count values without sorting the whole container.
+// Values are streamed through a heap holding at most count values, except that
+// random access containers selecting a large share of their values are
+// partitioned with std::nth_element and only the selected values are sorted.
+// Either way the cost is O(size log count) rather than O(size log size).
+// Values that compare equal are returned in no particular order.
+
+namespace FuncHelpUtils {
+    enum { HeapSelectRatio = 16 };
+    
+    template <class ValType, class Comp>
+    struct PointeeOrder {
+        const Comp *comp;
+        bool operator()(const ValType *a, const ValType *b) const { return std::ref(*comp)(*a, *b); }
+    };
+    
+    template <class Entry, class Comp>
+    struct KeyOrder {
+        bool operator()(const Entry &a, const Entry &b) const { return Comp()(a.first, b.first); }
+    };
+    
+    // Makes the entries that are ordered when selecting values: either a
+    // pointer to each value, or a pointer to each value paired with its key
+    // so that func is only called once per value.
+    template <class ValType>
+    struct PointerEntry {
+        typedef const ValType *type;
+        type operator()(const ValType &val) const { return &val; }
+    };
+    
+    template <class ValType, class F, class W>
+    struct KeyEntry {
+        typedef std::pair<W, const ValType *> type;
+        const F *func;
+        type operator()(const ValType &val) const { return type(std::ref(*func)(val), &val); }
+    };
+    
+    template <class ValType>
+    const ValType &entryValue(const ValType *entry)
+    {
+        return *entry;
+    }
+    
+    template <class W, class ValType>
+    const ValType &entryValue(const std::pair<W, const ValType *> &entry)
+    {
+        return *entry.second;
+    }
+    
+    template <class Entry, class Container, class Maker, class Order>
+    void collectBest(std::vector<Entry> &entries, const Container &container, size_t count, const Maker &maker,
+                     const Order &order, std::false_type);
+    
+    template <class Entry, class Container, class Maker, class Order>
+    void collectBest(std::vector<Entry> &entries, const Container &container, size_t count, const Maker &maker,
+                     const Order &order, std::true_type)
+    {
+        // Most values are rejected by a single comparison against the heap's
+        // front when count is small, which beats building entries for every
+        // value first.
+        if (count < size_t(container.size()) / HeapSelectRatio) {
+            collectBest(entries, container, count, maker, order, std::false_type());
+            return;
+        }
+        
+        entries.reserve(size_t(container.size()));
+        
+        for(auto const &val : container) {
+            entries.push_back(maker(val));
+        }
+        
+        if (count < entries.size()) {
+            std::nth_element(entries.begin(), entries.begin() + count, entries.end(), order);
+            entries.resize(count);
+        }
+        
+        std::sort(entries.begin(), entries.end(), order);
+    }
+    
+    template <class Entry, class Container, class Maker, class Order>
+    void collectBest(std::vector<Entry> &entries, const Container &container, size_t count, const Maker &maker,
+                     const Order &order, std::false_type)
+    {
+        // Nothing is reserved when container's size isn't known, since count
+        // can be far more than the number of values.
+        entries.reserve(std::min(size_t(sizeHint(container)), count));
+        
+        // entries is a heap whose front is the worst value selected so far
+        for(auto const &val : container) {
+            if (entries.size() < count) {
+                entries.push_back(maker(val));
+                std::push_heap(entries.begin(), entries.end(), order);
+            } else {
+                Entry entry = maker(val);
+                
+                if (order(entry, entries.front())) {
+                    std::pop_heap(entries.begin(), entries.end(), order);
+                    entries.back() = std::move(entry);
+                    std::push_heap(entries.begin(), entries.end(), order);
+                }
+            }
+        }
+        
+        std::sort_heap(entries.begin(), entries.end(), order);
+    }
+    
+    template <class OutContainer, class Container, class Maker, class Order>
+    OutContainer bestNBase(const Container &container, int count, const Maker &maker, const Order &order)
+    {
+        std::vector<typename Maker::type> entries;
+        
+        if (count > 0) {
+            collectBest(entries, container, size_t(count), maker, order,
+                        std::integral_constant<bool, is_random_access<Container>::value>());
+        }
+        
+        OutContainer result;
+        FuncHelpUtils::reserveSize(result, entries.size());
+        
+        for(auto const &entry : entries) {
+            FuncHelpUtils::addItem(result, entryValue(entry));
+        }
+        
+        return result;
+    }
+    
+    template <class OutContainer, class Container, class Comp>
+    OutContainer bestNByValue(const Container &container, int count, const Comp &comp)
+    {
+        using ValType = iterator_deref_decay<Container>;
+        PointeeOrder<ValType, Comp> order = {&comp};
+        return bestNBase<OutContainer>(container, count, PointerEntry<ValType>(), order);
+    }
+    
+    template <class OutContainer, template <class> class Comp, class Container, class F>
+    OutContainer bestNByKey(const Container &container, int count, const F &func)
+    {
+        using ValType = iterator_deref_decay<Container>;
+        using Maker = KeyEntry<ValType, F, func_container_result<Container, F> >;
+        Maker maker = {&func};
+        return bestNBase<OutContainer>(container, count, maker,
+                                       KeyOrder<typename Maker::type, Comp<func_container_result<Container, F> > >());
+    }
+}
+
+// minN(container, count) and minN(container, count, func)
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType>
+OutContainer<ValType> minN(const InContainer<ValType> &container, int count)
+{
+    return FuncHelpUtils::bestNByValue<OutContainer<ValType> >(container, count, FuncHelpUtils::Less<ValType>());
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+OutContainer<ValType> minN(const InContainer<ValType> &container, int count)
+{
+    return minN<InContainer, OutContainer>(container, count);
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class F>
+OutContainer<ValType> minN(const InContainer<ValType> &container, int count, const F &func)
+{
+    return FuncHelpUtils::bestNByKey<OutContainer<ValType>, FuncHelpUtils::Less>(container, count, func);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+OutContainer<ValType> minN(const InContainer<ValType> &container, int count, const F &func)
+{
+    return minN<InContainer, OutContainer>(container, count, func);
+}
+
+// maxN(container, count) and maxN(container, count, func)
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType>
+OutContainer<ValType> maxN(const InContainer<ValType> &container, int count)
+{
+    return FuncHelpUtils::bestNByValue<OutContainer<ValType> >(container, count, FuncHelpUtils::Greater<ValType>());
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+OutContainer<ValType> maxN(const InContainer<ValType> &container, int count)
+{
+    return maxN<InContainer, OutContainer>(container, count);
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class F>
+OutContainer<ValType> maxN(const InContainer<ValType> &container, int count, const F &func)
+{
+    return FuncHelpUtils::bestNByKey<OutContainer<ValType>, FuncHelpUtils::Greater>(container, count, func);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+OutContainer<ValType> maxN(const InContainer<ValType> &container, int count, const F &func)
+{
+    return maxN<InContainer, OutContainer>(container, count, func);
+}
+
+// topK(container, count, comp)
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class F>
+OutContainer<ValType> topK(const InContainer<ValType> &container, int count, const F &comp)
+{
+    return FuncHelpUtils::bestNByValue<OutContainer<ValType> >(container, count, comp);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+OutContainer<ValType> topK(const InContainer<ValType> &container, int count, const F &comp)
+{
+    return topK<InContainer, OutContainer>(container, count, comp);
+}
+
+// reduce
+
+template <class Container, class F>
+auto reduce(const Container &container, const F &func)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
+    using V = decltype(container.cbegin());
+    V it = container.cbegin();
+    
+    if (it == container.cend()) {
+        return ValType();
+    }
+    
+    ValType memo = *it;
+    ++it;
+    
+    while(it != container.cend()) {
+        memo = std::ref(func)(ValType(memo), decltype(*it)(*it));
+        ++it;
+    }
+
+    return memo;
+}
+
+template <class Container, class F, class ValType>
+ValType reduce(const Container &container, const F &func, ValType memo)
+{
+    for(auto const &val : container) {
+        memo = std::ref(func)(ValType(memo), decltype(val)(val));
+    }
+
+    return memo;
+}
+
+// sum
+
+// For contiguous arithmetic containers, values are added in several lanes that
+// are then added together, so floating point results may differ slightly from
+// adding the values strictly in order. They don't differ between CPUs.
+
+namespace FuncHelpUtils {
+    template <class Container, class ValType>
+    ValType sumBase(const Container &container, ValType memo, std::false_type)
+    {
+        return ::reduce(container, [] (const ValType &a, const ValType &b) { return a+b; }, memo);
+    }
+    
+    template <class Container, class ValType>
+    ValType sumBase(const Container &container, ValType memo, std::true_type)
+    {
+        return memo + runKernel<SumKernel<ValType, ValType> >(container.data(), size_t(container.size()));
+    }
+    
+    template <class Container>
+    auto sumBase(const Container &container, std::false_type)
+     -> iterator_deref_decay<Container>
+    {
+        using ValType = iterator_deref_decay<Container>;
+        return ::reduce(container, [] (const ValType &a, const ValType &b) { return a+b; });
+    }
+    
+    template <class Container>
+    auto sumBase(const Container &container, std::true_type)
+     -> iterator_deref_decay<Container>
+    {
+        using ValType = iterator_deref_decay<Container>;
+        return runKernel<SumKernel<ValType, ValType> >(container.data(), size_t(container.size()));
+    }
+}
+
+template <class Container, class ValType>
+auto sum(const Container &container, ValType memo)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    return FuncHelpUtils::sumBase(container, memo, FuncHelpUtils::contiguous_arithmetic_of_tag<Container, ValType>());
+}
+
+template <class Container>
+auto sum(const Container &container)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    return FuncHelpUtils::sumBase(container, FuncHelpUtils::contiguous_arithmetic_tag<Container>());
+}
+
+// wideSum
+
+namespace FuncHelpUtils {
+    template <class Container, class WideType>
+    WideType wideSumBase(const Container &container, std::false_type)
+    {
+        WideType result = WideType();
+        
+        for(auto const &val : container) {
+            result = result + WideType(val);
+        }
+        
+        return result;
+    }
+    
+    template <class Container, class WideType>
+    WideType wideSumBase(const Container &container, std::true_type)
+    {
+        using ValType = iterator_deref_decay<Container>;
+        return runKernel<SumKernel<ValType, WideType> >(container.data(), size_t(container.size()));
+    }
+}
+
+template <class Container>
+auto wideSum(const Container &container)
+ -> typename FuncHelpUtils::wide_type<FuncHelpUtils::iterator_deref_decay<Container> >::type
+{
+    using WideType = typename FuncHelpUtils::wide_type<FuncHelpUtils::iterator_deref_decay<Container> >::type;
+    return FuncHelpUtils::wideSumBase<Container, WideType>(container, FuncHelpUtils::contiguous_arithmetic_tag<Container>());
+}
+
+// compensatedSum
+
+namespace FuncHelpUtils {
+    template <class Container, class Contiguous>
+    auto compensatedSumBase(const Container &container, std::false_type, Contiguous)
+     -> iterator_deref_decay<Container>
+    {
+        return ::sum(container);
+    }
+    
+    template <class Container>
+    auto compensatedSumBase(const Container &container, std::true_type, std::false_type)
+     -> iterator_deref_decay<Container>
+    {
+        using ValType = iterator_deref_decay<Container>;
+        ValType result = ValType();
+        ValType error = ValType();
+        
+        for(auto const &val : container) {
+            ValType y = val - error;
+            ValType t = result + y;
+            error = (t - result) - y;
+            result = t;
+        }
+        
+        return result;
+    }
+    
+    template <class Container>
+    auto compensatedSumBase(const Container &container, std::true_type, std::true_type)
+     -> iterator_deref_decay<Container>
+    {
+        using ValType = iterator_deref_decay<Container>;
+        return runKernel<CompensatedSumKernel<ValType> >(container.data(), size_t(container.size()));
+    }
+}
+
+template <class Container>
+auto compensatedSum(const Container &container)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
+    return FuncHelpUtils::compensatedSumBase(container,
+                                             std::integral_constant<bool, std::is_floating_point<ValType>::value>(),
+                                             FuncHelpUtils::contiguous_arithmetic_tag<Container>());
+}
+
+// aggregate
+
+// aggregate(container, reducers...) computes several results in a single
+// traversal, returning them in a std::tuple in the same order as reducers.
+// Each of these makes a reducer:
+//
+// countOf()            the number of values
+// sumOf([func])        same as sum(container), or the sum of func(value)
+// minOf([func])        same as min(container) or min(container, func)
+// maxOf([func])        same as max(container) or max(container, func)
+// meanOf([func])       the mean of the values or of func(value) as a double
+// varianceOf([func])   the population variance of the same, as a double
+//
+// When none of the reducers are given a func and the container stores
+// arithmetic values contiguously, every result is computed by one vectorized
+// kernel.
+
+namespace FuncHelpUtils {
+    // Marks a reducer that works on the values themselves
+    struct NoKey {};
+    
+    template <class F, class ValType>
+    auto applyKey(const F &func, const ValType &val) -> decltype(std::ref(func)(val))
+    {
+        return std::ref(func)(val);
+    }
+    
+    template <class ValType>
+    const ValType &applyKey(const NoKey &, const ValType &val)
+    {
+        return val;
+    }
+    
+    template <class F, class ValType>
+    using key_result = decay_t<decltype(applyKey(std::declval<const F &>(), std::declval<const ValType &>()))>;
+    
+    // Each reducer has an Accumulator for a given value type, which takes the
+    // values one at a time through add(). fromStats() instead picks the
+    // result out of what StatsKernel found.
+    struct CountReducer {
+        enum { keyless = true, needsSum = false, needsExtrema = false, needsMoments = false };
+        
+        template <class ValType>
+        struct Accumulator {
+            typedef size_t result_type;
+            
+            explicit Accumulator(const CountReducer &) : count(0) {}
+            void add(const ValType &) { ++count; }
+            result_type result() const { return count; }
+            static result_type fromStats(const ArithmeticStats<ValType> &stats) { return stats.count; }
+            
+            size_t count;
+        };
+    };
+    
+    template <class F>
+    struct SumReducer {
+        enum { keyless = std::is_same<F, NoKey>::value, needsSum = true, needsExtrema = false, needsMoments = false };
+        F func;
+        
+        template <class ValType>
+        struct Accumulator {
+            typedef key_result<F, ValType> result_type;
+            
+            explicit Accumulator(const SumReducer &reducer) : func(&reducer.func), total() {}
+            void add(const ValType &val) { total = total + applyKey(*func, val); }
+            result_type result() const { return total; }
+            static result_type fromStats(const ArithmeticStats<ValType> &stats) { return stats.sum; }
+            
+            const F *func;
+            result_type total;
+        };
+    };
+    
+    // Keeps the first value whose key is less than (or greater than, if Min
+    // is false) every other value's, like minBase and maxBase.
+    template <class F, bool Min>
+    struct ExtremumReducer {
+        enum { keyless = std::is_same<F, NoKey>::value, needsSum = false, needsExtrema = true, needsMoments = false };
+        F func;
+        
+        template <class ValType>
+        struct Accumulator {
+            typedef ValType result_type;
+            typedef key_result<F, ValType> W;
+            typedef typename std::conditional<Min, Less<W>, Greater<W> >::type Comp;
+            
+            explicit Accumulator(const ExtremumReducer &reducer) : func(&reducer.func), best(nullptr), bestKey() {}
+            
+            void add(const ValType &val)
+            {
+                W key = applyKey(*func, val);
+                
+                if (!best || Comp()(key, bestKey)) {
+                    best = &val;
+                    bestKey = key;
+                }
+            }
+            
+            result_type result() const { return best ? *best : ValType(); }
+            static result_type fromStats(const ArithmeticStats<ValType> &stats) { return Min ? stats.min : stats.max; }
+            
+            const F *func;
+            const ValType *best;
+            W bestKey;
+        };
+    };
+    
+    // Accumulates the same differences from the first key as StatsKernel.
+    template <class F, bool Variance>
+    struct MomentReducer {
+        enum { keyless = std::is_same<F, NoKey>::value, needsSum = false, needsExtrema = false, needsMoments = true };
+        F func;
+        
+        template <class ValType>
+        struct Accumulator {
+            typedef double result_type;
+            
+            explicit Accumulator(const MomentReducer &reducer)
+                : func(&reducer.func), count(0), shift(0), sum1(0), sum2(0) {}
+            
+            void add(const ValType &val)
+            {
+                const double key = double(applyKey(*func, val));
+                
+                if (count == 0) {
+                    shift = key;
+                }
+                
+                const double d = key - shift;
+                sum1 += d;
+                sum2 += d*d;
+                ++count;
+            }
+            
+            result_type result() const
+            {
+                if (count == 0) {
+                    return 0.0;
+                }
+                
+                const double n = double(count);
+                const double variance = (sum2 - sum1*sum1/n)/n;
+                return Variance ? ((variance > 0) ? variance : 0.0) : shift + sum1/n;
+            }
+            
+            static result_type fromStats(const ArithmeticStats<ValType> &stats)
+            {
+                return Variance ? stats.variance : stats.mean;
+            }
+            
+            const F *func;
+            size_t count;
+            double shift;
+            double sum1;
+            double sum2;
+        };
+    };
+    
+    template <class... Reducers>
+    struct all_keyless;
+    
+    template <>
+    struct all_keyless<> {
+        enum { value = true, needsSum = false, needsExtrema = false, needsMoments = false };
+    };
+    
+    template <class Reducer, class... Reducers>
+    struct all_keyless<Reducer, Reducers...> {
+        enum { value = Reducer::keyless && all_keyless<Reducers...>::value,
+               needsSum = Reducer::needsSum || all_keyless<Reducers...>::needsSum,
+               needsExtrema = Reducer::needsExtrema || all_keyless<Reducers...>::needsExtrema,
+               needsMoments = Reducer::needsMoments || all_keyless<Reducers...>::needsMoments };
+    };
+    
+    // Passes a value to every accumulator in a tuple, or collects their
+    // results. C++11 has no std::index_sequence, so this recurses over the
+    // tuple's indexes instead.
+    template <size_t Index, size_t Count>
+    struct AccumulatorLoop {
+        template <class Tuple, class ValType>
+        static void add(Tuple &accumulators, const ValType &val)
+        {
+            std::get<Index>(accumulators).add(val);
+            AccumulatorLoop<Index + 1, Count>::add(accumulators, val);
+        }
+        
+        template <class Results, class Tuple>
+        static void results(Results &results, const Tuple &accumulators)
+        {
+            std::get<Index>(results) = std::get<Index>(accumulators).result();
+            AccumulatorLoop<Index + 1, Count>::results(results, accumulators);
+        }
+        
+        template <class Results, class Tuple, class Stats>
+        static void fromStats(Results &results, const Tuple &accumulators, const Stats &stats)
+        {
+            std::get<Index>(results) = std::tuple_element<Index, Tuple>::type::fromStats(stats);
+            AccumulatorLoop<Index + 1, Count>::fromStats(results, accumulators, stats);
+        }
+    };
+    
+    template <size_t Count>
+    struct AccumulatorLoop<Count, Count> {
+        template <class Tuple, class ValType>
+        static void add(Tuple &, const ValType &) {}
+        
+        template <class Results, class Tuple>
+        static void results(Results &, const Tuple &) {}
+        
+        template <class Results, class Tuple, class Stats>
+        static void fromStats(Results &, const Tuple &, const Stats &) {}
+    };
+    
+    template <class Container, class... Reducers>
+    using aggregate_result = std::tuple<typename Reducers::template Accumulator<iterator_deref_decay<Container> >::result_type...>;
+    
+    template <class Container, class... Reducers>
+    aggregate_result<Container, Reducers...> aggregateBase(const Container &container, std::false_type,
+                                                           const Reducers &...reducers)
+    {
+        using ValType = iterator_deref_decay<Container>;
+        std::tuple<typename Reducers::template Accumulator<ValType>...> accumulators{
+            typename Reducers::template Accumulator<ValType>(reducers)...};
+        
+        for(auto const &val : container) {
+            AccumulatorLoop<0, sizeof...(Reducers)>::add(accumulators, val);
+        }
+        
+        aggregate_result<Container, Reducers...> results;
+        AccumulatorLoop<0, sizeof...(Reducers)>::results(results, accumulators);
+        return results;
+    }
+    
+    template <class Container, class... Reducers>
+    aggregate_result<Container, Reducers...> aggregateBase(const Container &container, std::true_type,
+                                                           const Reducers &...reducers)
+    {
+        using ValType = iterator_deref_decay<Container>;
+        using Flags = all_keyless<Reducers...>;
+        
+        if (container.size() == 0) {
+            return aggregateBase(container, std::false_type(), reducers...);
+        }
+        
+        const ArithmeticStats<ValType> stats = runKernel<StatsKernel<ValType, bool(Flags::needsSum), bool(Flags::needsExtrema),
+                                                                     bool(Flags::needsMoments)> >(
+            container.data(), size_t(container.size()));
+        std::tuple<typename Reducers::template Accumulator<ValType>...> accumulators{
+            typename Reducers::template Accumulator<ValType>(reducers)...};
+        aggregate_result<Container, Reducers...> results;
+        AccumulatorLoop<0, sizeof...(Reducers)>::fromStats(results, accumulators, stats);
+        return results;
+    }
+}
+
+inline FuncHelpUtils::CountReducer countOf()
+{
+    return FuncHelpUtils::CountReducer();
+}
+
+inline FuncHelpUtils::SumReducer<FuncHelpUtils::NoKey> sumOf()
+{
+    return FuncHelpUtils::SumReducer<FuncHelpUtils::NoKey>();
+}
+
+template <class F>
+FuncHelpUtils::SumReducer<F> sumOf(const F &func)
+{
+    return FuncHelpUtils::SumReducer<F>{func};
+}
+
+inline FuncHelpUtils::ExtremumReducer<FuncHelpUtils::NoKey, true> minOf()
+{
+    return FuncHelpUtils::ExtremumReducer<FuncHelpUtils::NoKey, true>();
+}
+
+template <class F>
+FuncHelpUtils::ExtremumReducer<F, true> minOf(const F &func)
+{
+    return FuncHelpUtils::ExtremumReducer<F, true>{func};
+}
+
+inline FuncHelpUtils::ExtremumReducer<FuncHelpUtils::NoKey, false> maxOf()
+{
+    return FuncHelpUtils::ExtremumReducer<FuncHelpUtils::NoKey, false>();
+}
+
+template <class F>
+FuncHelpUtils::ExtremumReducer<F, false> maxOf(const F &func)
+{
+    return FuncHelpUtils::ExtremumReducer<F, false>{func};
+}
+
+inline FuncHelpUtils::MomentReducer<FuncHelpUtils::NoKey, false> meanOf()
+{
+    return FuncHelpUtils::MomentReducer<FuncHelpUtils::NoKey, false>();
+}
+
+template <class F>
+FuncHelpUtils::MomentReducer<F, false> meanOf(const F &func)
+{
+    return FuncHelpUtils::MomentReducer<F, false>{func};
+}
+
+inline FuncHelpUtils::MomentReducer<FuncHelpUtils::NoKey, true> varianceOf()
+{
+    return FuncHelpUtils::MomentReducer<FuncHelpUtils::NoKey, true>();
+}
+
+template <class F>
+FuncHelpUtils::MomentReducer<F, true> varianceOf(const F &func)
+{
+    return FuncHelpUtils::MomentReducer<F, true>{func};
+}
+
+template <class Container, class... Reducers>
+auto aggregate(const Container &container, const Reducers &...reducers)
+ -> FuncHelpUtils::aggregate_result<Container, Reducers...>
+{
+    return FuncHelpUtils::aggregateBase(container,
+        std::integral_constant<bool, FuncHelpUtils::is_contiguous_arithmetic<Container>::value &&
+                                     FuncHelpUtils::all_keyless<Reducers...>::value>(),
+        reducers...);
+}
+
+// sorted
+
+// Since std::sort requires a random access iterator, we have to define
+// different versions of sortInPlace for both std::list and std::forward_list,
+// and any classes derived from them. This is accomplished by using
+// std::enable_if when determining the return type.
+
+// NB: we're using enable_if in the return type since using it as a
+// template argument will cause some of these definitions of sortInPlace to
+// be duplicates.
+
+namespace FuncHelpUtils {
+    template <class Container>
+    auto sortInPlace(Container &container)
+     -> enable_if_t<!std::is_base_of<std::list<typename Container::value_type>, Container>::value &&
+                    !std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value>
+    {
+        std::sort(container.begin(), container.end());
+    }
+    
+    template <class Container, class F>
+    auto sortInPlace(Container &container, const F &comp)
+     -> enable_if_t<!std::is_base_of<std::list<typename Container::value_type>, Container>::value &&
+                    !std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value>
+    {
+        std::sort(container.begin(), container.end(), std::ref(comp));
+    }
+    
+    template <class Container>
+    auto sortInPlace(Container &container)
+     -> enable_if_t<std::is_base_of<std::list<typename Container::value_type>, Container>::value ||
+                    std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value>
+    {
+        container.sort();
+    }
+    
+    template <class Container, class F>
+    auto sortInPlace(Container &container, const F &comp)
+     -> enable_if_t<std::is_base_of<std::list<typename Container::value_type>, Container>::value ||
+                    std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value>
+    {
+        container.sort(std::ref(comp));
+    }
+}
+
+template <class Container>
+Container sorted(const Container &container)
+{
+    Container result(container);
+    FuncHelpUtils::sortInPlace(result);
+    return result;
+}
+
+template <class Container, class F>
+Container sorted(const Container &container, const F &comp)
+{
+    Container result(container);
+    FuncHelpUtils::sortInPlace(result, comp);
+    return result;
+}
+
+// Temporary containers are sorted in place rather than copied.
+
+template <class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_reusable_rvalue<Container>::value> >
+Container sorted(Container &&container)
+{
+    FuncHelpUtils::sortInPlace(container);
+    return std::move(container);
+}
+
+template <class Container,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_reusable_rvalue<Container>::value> >
+Container sorted(Container &&container, const F &comp)
+{
+    FuncHelpUtils::sortInPlace(container, comp);
+    return std::move(container);
+}
+
+// stableSorted
+
+// Like sorted, but values that compare equal keep their original order.
+// std::list::sort and std::forward_list::sort are already stable.
+
+namespace FuncHelpUtils {
+    template <class Container>
+    auto stableSortInPlace(Container &container)
+     -> enable_if_t<!std::is_base_of<std::list<typename Container::value_type>, Container>::value &&
+                    !std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value>
+    {
+        std::stable_sort(container.begin(), container.end());
+    }
+    
+    template <class Container, class F>
+    auto stableSortInPlace(Container &container, const F &comp)
+     -> enable_if_t<!std::is_base_of<std::list<typename Container::value_type>, Container>::value &&
+                    !std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value>
+    {
+        std::stable_sort(container.begin(), container.end(), std::ref(comp));
+    }
+    
+    template <class Container>
+    auto stableSortInPlace(Container &container)
+     -> enable_if_t<std::is_base_of<std::list<typename Container::value_type>, Container>::value ||
+                    std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value>
+    {
+        container.sort();
+    }
+    
+    template <class Container, class F>
+    auto stableSortInPlace(Container &container, const F &comp)
+     -> enable_if_t<std::is_base_of<std::list<typename Container::value_type>, Container>::value ||
+                    std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value>
+    {
+        container.sort(std::ref(comp));
+    }
+}
+
+template <class Container>
+Container stableSorted(const Container &container)
+{
+    Container result(container);
+    FuncHelpUtils::stableSortInPlace(result);
+    return result;
+}
+
+template <class Container, class F>
+Container stableSorted(const Container &container, const F &comp)
+{
+    Container result(container);
+    FuncHelpUtils::stableSortInPlace(result, comp);
+    return result;
+}
+
+template <class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_reusable_rvalue<Container>::value> >
+Container stableSorted(Container &&container)
+{
+    FuncHelpUtils::stableSortInPlace(container);
+    return std::move(container);
+}
+
+template <class Container,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_reusable_rvalue<Container>::value> >
+Container stableSorted(Container &&container, const F &comp)
+{
+    FuncHelpUtils::stableSortInPlace(container, comp);
+    return std::move(container);
+}
+
+// sortedBy
+
+// sortedBy calls key once per value and sorts the keys along with each value's
+// position, then moves the values into that order. Integer and floating point
+// keys are radix sorted, and any other keys are compared with operator<. The
+// sort is stable either way.
+
+namespace FuncHelpUtils {
+    // Maps keys to unsigned integers that sort in the same order, for the
+    // types of keys that can be radix sorted.
+    template <class W, class = void>
+    struct RadixKey {
+        enum { value = false };
+    };
+    
+    template <class W>
+    struct RadixKey<W, enable_if_t<std::is_integral<W>::value && !std::is_same<W, bool>::value> > {
+        enum { value = true };
+        typedef typename std::make_unsigned<W>::type type;
+        
+        static type bits(W key)
+        {
+            const type signBit = std::is_signed<W>::value ? type(type(1) << (sizeof(W)*8 - 1)) : type(0);
+            return type(type(key) ^ signBit);
+        }
+    };
+    
+    template <class W>
+    struct RadixKey<W, enable_if_t<std::is_floating_point<W>::value && (sizeof(W) == 4 || sizeof(W) == 8)> > {
+        enum { value = true };
+        typedef typename std::conditional<sizeof(W) == 4, uint32_t, uint64_t>::type type;
+        
+        static type bits(W key)
+        {
+            // -0.0 and 0.0 compare equal, so they need to keep their order
+            key = (key == W(0)) ? W(0) : key;
+            type result;
+            std::memcpy(&result, &key, sizeof(result));
+            const type signBit = type(1) << (sizeof(type)*8 - 1);
+            return (result & signBit) ? type(~result) : type(result | signBit);
+        }
+    };
+    
+    // Indexes are stored as 32 bits whenever possible, since the radix sort
+    // spends most of its time moving entries around.
+    template <class U, class Index>
+    struct RadixEntry {
+        U bits;
+        Index index;
+    };
+    
+    // LSD radix sort, RadixDigitBits bits per pass. All of the histograms are
+    // counted in a single pass first, and passes over digits that every key
+    // shares are skipped.
+    enum { RadixDigitBits = 11, RadixBuckets = 1 << RadixDigitBits };
+    
+    template <class U, class Index>
+    void radixSort(std::vector<RadixEntry<U, Index> > &entries)
+    {
+        enum { Passes = (sizeof(U)*8 + RadixDigitBits - 1) / RadixDigitBits };
+        std::vector<size_t> counts(Passes*RadixBuckets, 0);
+        
+        for(auto const &entry : entries) {
+            for(size_t pass = 0; pass < Passes; ++pass) {
+                ++counts[pass*RadixBuckets + ((entry.bits >> (pass*RadixDigitBits)) & (RadixBuckets - 1))];
+            }
+        }
+        
+        std::vector<RadixEntry<U, Index> > buffer(entries.size());
+        
+        for(size_t pass = 0; pass < Passes; ++pass) {
+            const size_t shift = pass*RadixDigitBits;
+            size_t *passCounts = &counts[pass*RadixBuckets];
+            
+            if (passCounts[(entries[0].bits >> shift) & (RadixBuckets - 1)] == entries.size()) {
+                continue;
+            }
+            
+            size_t offset = 0;
+            
+            for(size_t i = 0; i < RadixBuckets; ++i) {
+                const size_t count = passCounts[i];
+                passCounts[i] = offset;
+                offset += count;
+            }
+            
+            for(auto const &entry : entries) {
+                buffer[passCounts[(entry.bits >> shift) & (RadixBuckets - 1)]++] = entry;
+            }
+            
+            entries.swap(buffer);
+        }
+    }
+    
+    // Radix sorting only pays off once there are enough values to amortize
+    // clearing and scanning the histograms.
+    enum { RadixSortMinSize = 1024 };
+    
+    template <class Index, class Container, class F>
+    std::vector<size_t> radixSortedOrder(Container &container, const F &key, size_t size)
+    {
+        using W = func_container_result<Container, F>;
+        using U = typename RadixKey<W>::type;
+        std::vector<RadixEntry<U, Index> > entries;
+        entries.reserve(size);
+        
+        for(auto const &val : container) {
+            RadixEntry<U, Index> entry = {RadixKey<W>::bits(std::ref(key)(decltype(val)(val))), Index(entries.size())};
+            entries.push_back(entry);
+        }
+        
+        if (size >= size_t(RadixSortMinSize)) {
+            radixSort(entries);
+        } else {
+            std::sort(entries.begin(), entries.end(), [] (const RadixEntry<U, Index> &a, const RadixEntry<U, Index> &b) {
+                return a.bits < b.bits || (a.bits == b.bits && a.index < b.index);
+            });
+        }
+        
+        std::vector<size_t> order;
+        order.reserve(size);
+        
+        for(auto const &entry : entries) {
+            order.push_back(size_t(entry.index));
+        }
+        
+        return order;
+    }
+    
+    // Returns the positions of the values in container in the order they
+    // should be sorted into.
+    template <class Container, class F>
+    std::vector<size_t> sortedOrder(Container &container, const F &key, std::true_type)
+    {
+        const size_t size = size_t(std::distance(container.begin(), container.end()));
+        
+        if (size <= size_t(UINT32_MAX)) {
+            return radixSortedOrder<uint32_t>(container, key, size);
+        } else {
+            return radixSortedOrder<size_t>(container, key, size);
+        }
+    }
+    
+    template <class Container, class F>
+    std::vector<size_t> sortedOrder(Container &container, const F &key, std::false_type)
+    {
+        using W = func_container_result<Container, F>;
+        std::vector<std::pair<W, size_t> > entries;
+        FuncHelpUtils::reserveSize(entries, sizeHint(container));
+        
+        for(auto const &val : container) {
+            entries.push_back(std::pair<W, size_t>(std::ref(key)(decltype(val)(val)), entries.size()));
+        }
+        
+        std::sort(entries.begin(), entries.end(), [] (const std::pair<W, size_t> &a, const std::pair<W, size_t> &b) {
+            return a.first < b.first || (!(b.first < a.first) && a.second < b.second);
+        });
+        
+        std::vector<size_t> order;
+        order.reserve(entries.size());
+        
+        for(auto const &entry : entries) {
+            order.push_back(entry.second);
+        }
+        
+        return order;
+    }
+    
+    // Moves the values of container so that the value at order[i] ends up at
+    // position i. This works the same way for every kind of container, lists
+    // included, since splicing list nodes into place or following each cycle
+    // of the permutation both chase pointers or indexes whose next step waits
+    // on a cache miss, which measured several times slower than moving the
+    // values out into a vector and back.
+    template <class Container>
+    void permuteInPlace(Container &container, const std::vector<size_t> &order)
+    {
+        std::vector<iterator_deref_decay<Container> > values;
+        values.reserve(order.size());
+        
+        for(auto it = container.begin(); it != container.end(); ++it) {
+            values.push_back(std::move(*it));
+        }
+        
+        auto it = container.begin();
+        
+        for(size_t index : order) {
+            *it = std::move(values[index]);
+            ++it;
+        }
+    }
+    
+    template <class Container, class F>
+    void sortByInPlace(Container &container, const F &key)
+    {
+        std::vector<size_t> order = sortedOrder(container, key,
+            std::integral_constant<bool, RadixKey<func_container_result<Container, F> >::value>());
+        permuteInPlace(container, order);
+    }
+}
+
+template <class Container, class F>
+Container sortedBy(const Container &container, const F &key)
+{
+    Container result(container);
+    FuncHelpUtils::sortByInPlace(result, key);
+    return result;
+}
+
+template <class Container,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_reusable_rvalue<Container>::value> >
+Container sortedBy(Container &&container, const F &key)
+{
+    FuncHelpUtils::sortByInPlace(container, key);
+    return std::move(container);
+}
+
+// contains
+
+// Containers with their own find, like std::unordered_set, std::multiset,
+// std::map and LookupIndex, are searched with it. For std maps that means
+// contains tests whether targetVal is one of the keys. QHash and QMap iterate
+// over their values rather than their keys, so those are still searched one
+// at a time; containsKey searches the keys of any of them.
+
+namespace FuncHelpUtils {
+    // Helper to determine whether Container has a find method that can search
+    // for a ValType.
+    template<typename Container, typename ValType>
+    struct has_find {
+    private:
+        template<typename C> static auto test(C *c)
+         -> decltype(c->find(std::declval<const ValType &>()) != c->end(), char());
+        template<typename C> static int  test(...);
+    public:
+        enum { value = sizeof(test<Container>(0)) == sizeof(char) };
+    };
+    
+    template <class Container, class = void>
+    struct key_type_of {
+        using type = void;
+    };
+    
+    template <class Container>
+    struct key_type_of<Container, decltype(void(std::declval<typename Container::key_type *>()))> {
+        using type = typename Container::key_type;
+    };
+    
+    // Whether iterating over Container gives its mapped values, as with QHash
+    // and QMap, in which case its find searches something else.
+    template <class Container, class = void>
+    struct iterates_mapped_values : std::false_type {};
+    
+    template <class Container>
+    struct iterates_mapped_values<Container, decltype(void(std::declval<typename Container::mapped_type *>()))>
+     : std::is_same<iterator_deref_decay<const Container>, typename Container::mapped_type> {};
+    
+    // Whether Container's find searches the values it iterates over.
+    template <class Container, class ValType>
+    struct finds_values {
+        enum { value = has_find<Container, ValType>::value && !iterates_mapped_values<Container>::value };
+    };
+    
+    // Whether contains can use container's find. Arithmetic values must be
+    // of the key type exactly, so that e.g. 4.5 isn't converted to 4 when
+    // searching a std::set<int>.
+    template <class Container, class ValType>
+    struct can_find {
+        enum { value = finds_values<Container, ValType>::value &&
+                       (!std::is_arithmetic<ValType>::value || std::is_same<ValType, typename key_type_of<Container>::type>::value) };
+    };
+    
+    template <class Container, class ValType>
+    bool containsBase(const Container &container, const ValType &targetVal, std::false_type)
+    {
+        for(auto const &val : container) {
+            if (val == targetVal) {
+                return true;
+            }
+        }
+        
+        return false;
+    }
+    
+    template <class Container, class ValType>
+    bool containsBase(const Container &container, const ValType &targetVal, std::true_type)
+    {
+        return runKernel<ContainsKernel<ValType> >(container.data(), size_t(container.size()), targetVal);
+    }
+    
+    template <class Container, class ValType>
+    bool containsOrFind(const Container &container, const ValType &targetVal, std::false_type)
+    {
+        return containsBase(container, targetVal, contiguous_arithmetic_of_tag<Container, ValType>());
+    }
+    
+    template <class Container, class ValType>
+    bool containsOrFind(const Container &container, const ValType &targetVal, std::true_type)
+    {
+        return container.find(targetVal) != container.end();
+    }
+}
+
+template <class Container, class ValType>
+bool contains(const Container &container, const ValType &targetVal)
+{
+    return FuncHelpUtils::containsOrFind(container, targetVal,
+                                         std::integral_constant<bool, FuncHelpUtils::can_find<Container, ValType>::value>());
+}
+
+template <class Container, class Alloc>
+bool contains(const std::set<Container, Alloc> &container, const Container &val)
+{
+    return container.find(val) != container.end();
+}
+
+// containsKey
+
+template <class Container, class KeyType>
+bool containsKey(const Container &container, const KeyType &key)
+{
+    return container.find(key) != container.end();
+}
+
+// set algebra
+
+// omit(container, container), intersect, unionOf and difference all need to
+// test whether each value of one container is in another. Membership picks
+// how to do that based on what's available for the types involved:
+// 1. Containers with their own find (std::set, std::unordered_set, QSet, etc.)
+//    are searched directly.
+// 2. When only a few values need to be searched for, or there are only a few
+//    values to search, the values are compared one at a time using contains.
+// 3. When both containers are already sorted, they're walked through together
+//    like in a merge. This relies on values being tested in order, which is
+//    the case for all of the functions here.
+// 4. Otherwise pointers to the searched values are put in a hash set if
+//    std::hash supports the value type, or sorted and binary searched if it
+//    has operator<.
+
+namespace FuncHelpUtils {
+    // Helper to determine whether std::hash can hash T.
+    template<typename T>
+    struct is_hashable {
+    private:
+        template<typename C> static auto test(C *c)
+         -> enable_if_t<std::is_default_constructible<std::hash<C> >::value &&
+                        std::is_convertible<decltype(std::hash<C>()(*c)), size_t>::value, char>;
+        template<typename C> static int  test(...);
+    public:
+        enum { value = sizeof(test<T>(0)) == sizeof(char) };
+    };
+    
+    // Helper to determine whether T can be compared with operator<.
+    template<typename T>
+    struct is_less_comparable {
+    private:
+        template<typename C> static auto test(C *c)
+         -> enable_if_t<std::is_convertible<decltype(*c < *c), bool>::value, char>;
+        template<typename C> static int  test(...);
+    public:
+        enum { value = sizeof(test<T>(0)) == sizeof(char) };
+    };
+    
+    template <class T>
+    struct PointerHash {
+        size_t operator()(const T *a) const { return std::hash<T>()(*a); }
+    };
+    
+    template <class T>
+    struct PointerEqual {
+        bool operator()(const T *a, const T *b) const { return *a == *b; }
+    };
+    
+    template <class T>
+    struct PointerLess {
+        bool operator()(const T *a, const T *b) const { return *a < *b; }
+    };
+    
+    // Below this many values to search, or values to search for, comparing
+    // values one at a time is faster than building an index.
+    enum { LinearSearchLimit = 16 };
+    
+    template <class Container>
+    bool isSorted(const Container &container, std::true_type)
+    {
+        auto it = container.cbegin();
+        
+        if (it == container.cend()) {
+            return true;
+        }
+        
+        for(auto prev = it++; it != container.cend(); prev = it++) {
+            if (*it < *prev) {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+    
+    template <class Container>
+    bool isSorted(const Container &, std::false_type)
+    {
+        return false;
+    }
+    
+    // Whether the iterators of Container return references to values stored
+    // in it, rather than values made on the fly like those of LazyRange or
+    // std::vector<bool>.
+    template <class Container>
+    using has_stored_items = std::is_lvalue_reference<decltype(*std::declval<const Container &>().begin())>;
+    
+    // The values for an index to point to. Values that aren't stored in
+    // container are copied into owned, which is shared by copies of the index
+    // so that what they point to stays alive.
+    template <class T, class Container>
+    auto indexedValues(const Container &container, std::shared_ptr<const std::deque<T> > &owned)
+     -> enable_if_t<has_stored_items<Container>::value, const Container &>
+    {
+        (void)owned;
+        return container;
+    }
+    
+    template <class T, class Container>
+    auto indexedValues(const Container &container, std::shared_ptr<const std::deque<T> > &owned)
+     -> enable_if_t<!has_stored_items<Container>::value, const std::deque<T> &>
+    {
+        auto copies = std::make_shared<const std::deque<T> >(container.begin(), container.end());
+        owned = copies;
+        return *copies;
+    }
+    
+    // The index used when the values searched can't be found by merging.
+    template <class T, class = void>
+    struct MembershipIndex {
+        template <class Container>
+        void build(const Container &) {}
+        bool contains(const T &) const { return false; }
+        bool isUsable() const { return false; }
+    };
+    
+    template <class T>
+    struct MembershipIndex<T, enable_if_t<is_hashable<T>::value> > {
+        std::unordered_set<const T *, PointerHash<T>, PointerEqual<T> > values;
+        std::shared_ptr<const std::deque<T> > owned;
+        
+        template <class Container>
+        void build(const Container &container)
+        {
+            auto const &stored = indexedValues<T>(container, owned);
+            values.reserve(size_t(sizeHint(stored)));
+            
+            for(auto const &val : stored) {
+                values.insert(&val);
+            }
+        }
+        
+        auto find(const T &val) const -> decltype(values.find(&val)) { return values.find(&val); }
+        bool contains(const T &val) const { return values.count(&val) > 0; }
+        bool isUsable() const { return true; }
+    };
+    
+    template <class T>
+    struct MembershipIndex<T, enable_if_t<!is_hashable<T>::value && is_less_comparable<T>::value> > {
+        std::vector<const T *> values;
+        std::shared_ptr<const std::deque<T> > owned;
+        
+        template <class Container>
+        void build(const Container &container)
+        {
+            auto const &stored = indexedValues<T>(container, owned);
+            values.reserve(size_t(sizeHint(stored)));
+            
+            for(auto const &val : stored) {
+                values.push_back(&val);
+            }
+            
+            std::sort(values.begin(), values.end(), PointerLess<T>());
+        }
+        
+        auto find(const T &val) const -> decltype(values.begin())
+        {
+            auto it = std::lower_bound(values.begin(), values.end(), &val, PointerLess<T>());
+            return (it != values.end() && !(val < **it)) ? it : values.end();
+        }
+        
+        bool contains(const T &val) const
+        {
+            return std::binary_search(values.begin(), values.end(), &val, PointerLess<T>());
+        }
+        
+        bool isUsable() const { return true; }
+    };
+    
+    // Tests whether values are in a container that doesn't have its own find.
+    template <class Container, class ValType, class = void>
+    class Membership {
+    public:
+        template <class Searched>
+        Membership(const Container &values, const Searched &searched)
+         : values(values), mode(Linear), cursor(values.cbegin())
+        {
+            using Ordered = std::integral_constant<bool, std::is_same<iterator_deref_decay<Container>, ValType>::value &&
+                                                         is_less_comparable<ValType>::value>;
+            using SearchedOrdered = std::integral_constant<bool, Ordered::value &&
+                                                                 std::is_same<iterator_deref_decay<Searched>, ValType>::value>;
+            using Indexable = std::integral_constant<bool, std::is_same<iterator_deref_decay<Container>, ValType>::value>;
+            size_t valuesSize = size_t(sizeHint(values));
+            size_t searchedSize = size_t(sizeHint(searched));
+            
+            if ((has_size<Container>::value && valuesSize <= LinearSearchLimit) ||
+                (has_size<Searched>::value && searchedSize <= LinearSearchLimit)) {
+                return;
+            }
+            
+            if (isSorted(values, Ordered()) && isSorted(searched, SearchedOrdered())) {
+                mode = Merge;
+            } else if (Indexable::value) {
+                index.build(values);
+                
+                if (index.isUsable()) {
+                    mode = Indexed;
+                }
+            }
+        }
+        
+        bool operator()(const ValType &val) const
+        {
+            switch (mode) {
+                case Merge:
+                    return merge(val, std::integral_constant<bool, is_less_comparable<ValType>::value>());
+                case Indexed:
+                    return index.contains(val);
+                default:
+                    return ::contains(values, val);
+            }
+        }
+        
+    private:
+        bool merge(const ValType &val, std::true_type) const
+        {
+            while(cursor != values.cend() && *cursor < val) {
+                ++cursor;
+            }
+            
+            return cursor != values.cend() && !(val < *cursor);
+        }
+        
+        bool merge(const ValType &, std::false_type) const
+        {
+            return false;
+        }
+        
+        enum Mode { Linear, Merge, Indexed };
+        
+        const Container &values;
+        Mode mode;
+        mutable typename Container::const_iterator cursor;
+        MembershipIndex<ValType> index;
+    };
+    
+    template <class Container, class ValType>
+    class Membership<Container, ValType, enable_if_t<finds_values<Container, ValType>::value> > {
+    public:
+        template <class Searched>
+        Membership(const Container &values, const Searched &)
+         : values(values) {}
+        
+        bool operator()(const ValType &val) const
+        {
+            return values.find(val) != values.end();
+        }
+        
+    private:
+        const Container &values;
+    };
+    
+    template <class ValType, class Container, class Searched>
+    Membership<Container, ValType> membership(const Container &values, const Searched &searched)
+    {
+        return Membership<Container, ValType>(values, searched);
+    }
+}
+
+// index
+
+// index(container) builds a LookupIndex of the values in container once, so
+// that testing whether a value is one of them takes constant time (or
+// logarithmic time for values that can't be hashed but can be compared with
+// operator<) rather than scanning container each time. A LookupIndex can be
+// passed to contains, or used directly as a predicate, e.g.
+// filter(names, index(allowedNames)), and can take the place of the second
+// container in omit, intersect, unionOf and difference. Iterating over it
+// visits the values in no particular order, and a hashed index keeps only one
+// of several equal values.
+//
+// Like a view, it refers to the values in container rather than copying them,
+// so container must outlive it, unless container is a temporary in which
+// case the index takes ownership of it. Containers that make their values as
+// they're iterated over, like a LazyRange, have them copied instead.
+
+namespace FuncHelpUtils {
+    // Iterates over pointers, but dereferences to what they point to.
+    template <class BaseIterator, class T>
+    class PointeeIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+        
+        PointeeIterator() {}
+        explicit PointeeIterator(BaseIterator it) : it(it) {}
+        
+        const T &operator*() const { return **it; }
+        const T *operator->() const { return *it; }
+        PointeeIterator &operator++() { ++it; return *this; }
+        PointeeIterator operator++(int) { PointeeIterator old = *this; ++it; return old; }
+        bool operator==(const PointeeIterator &other) const { return it == other.it; }
+        bool operator!=(const PointeeIterator &other) const { return it != other.it; }
+        
+    private:
+        BaseIterator it;
+    };
+    
+    template <class T>
+    struct is_indexable {
+        enum { value = is_hashable<T>::value || is_less_comparable<T>::value };
+    };
+}
+
+template <class T>
+class LookupIndex {
+    using Index = FuncHelpUtils::MembershipIndex<T>;
+    
+public:
+    using value_type = T;
+    using key_type = T;
+    using const_iterator = FuncHelpUtils::PointeeIterator<decltype(std::declval<const Index &>().values.begin()), T>;
+    using iterator = const_iterator;
+    
+    // owner keeps container alive when the index took ownership of it.
+    template <class Container>
+    LookupIndex(const Container &container, std::shared_ptr<const void> owner)
+     : owner(std::move(owner))
+    {
+        index.build(container);
+    }
+    
+    const_iterator begin() const { return const_iterator(index.values.begin()); }
+    const_iterator end() const { return const_iterator(index.values.end()); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    const_iterator find(const T &val) const { return const_iterator(index.find(val)); }
+    size_t size() const { return index.values.size(); }
+    bool contains(const T &val) const { return index.contains(val); }
+    bool operator()(const T &val) const { return index.contains(val); }
+    
+private:
+    std::shared_ptr<const void> owner;
+    Index index;
+};
+
+// The values are of the type that container's const_iterator returns, so
+// e.g. a std::vector<bool> is indexed as bools rather than bit references.
+
+template <class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_indexable<FuncHelpUtils::iterator_deref_decay<const Container> >::value> >
+auto index(const Container &container)
+ -> LookupIndex<FuncHelpUtils::iterator_deref_decay<const Container> >
+{
+    return LookupIndex<FuncHelpUtils::iterator_deref_decay<const Container> >(container, nullptr);
+}
+
+template <class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_reusable_rvalue<Container>::value &&
+                                             FuncHelpUtils::is_indexable<FuncHelpUtils::iterator_deref_decay<const Container> >::value> >
+auto index(Container &&container)
+ -> LookupIndex<FuncHelpUtils::iterator_deref_decay<const Container> >
+{
+    auto owned = std::make_shared<const Container>(std::move(container));
+    return LookupIndex<FuncHelpUtils::iterator_deref_decay<const Container> >(*owned, owned);
+}
+
+// omit
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class = FuncHelpUtils::enable_if_t<!FuncHelpUtils::has_const_iterator<ValType>::value> >
+auto omit(const InContainer<ValType> &container, const ValType &omitted)
+ -> OutContainer<ValType>
+{
+    OutContainer<ValType> result;
+    FUNC_HELPERS_PROFILE_SCOPE("omit");
+    FuncHelpUtils::reserveUpTo(result, FuncHelpUtils::sizeHint(container));
+    FUNC_HELPERS_PROFILE_WATCH(result);
+    
+    for(const ValType &val : container) {
+        FUNC_HELPERS_PROFILE_VISIT(1);
+        FUNC_HELPERS_PROFILE_CALL(1);
+        
+        if (!(val == omitted)) {
+            FuncHelpUtils::addItem(result, val);
+            FUNC_HELPERS_PROFILE_ADD(result, 1);
+        }
+    }
+    
+    FUNC_HELPERS_PROFILE_OUTPUT(result);
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class = FuncHelpUtils::enable_if_t<!FuncHelpUtils::has_const_iterator<ValType>::value>,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto omit(const InContainer<ValType> &container, const ValType &omitted)
+ -> OutContainer<ValType>
+{
+    return omit<InContainer, OutContainer>(container, omitted);
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_const_iterator<Container>::value> >
+auto omit(const InContainer<ValType> &container, const Container &omitted)
+ -> OutContainer<ValType>
+{
+    OutContainer<ValType> result;
+    FUNC_HELPERS_PROFILE_SCOPE("omit");
+    FuncHelpUtils::reserveUpTo(result, FuncHelpUtils::sizeHint(container));
+    FUNC_HELPERS_PROFILE_WATCH(result);
+    auto isOmitted = FuncHelpUtils::membership<ValType>(omitted, container);
+    
+    for(const ValType &val : container) {
+        FUNC_HELPERS_PROFILE_VISIT(1);
+        FUNC_HELPERS_PROFILE_CALL(1);
+        
+        if (!isOmitted(val)) {
+            FuncHelpUtils::addItem(result, val);
+            FUNC_HELPERS_PROFILE_ADD(result, 1);
+        }
+    }
+    
+    FUNC_HELPERS_PROFILE_OUTPUT(result);
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_const_iterator<Container>::value>,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto omit(const InContainer<ValType> &container, const Container &omitted)
+ -> OutContainer<ValType>
+{
+    return omit<InContainer, OutContainer>(container, omitted);
+}
+
+// Like filter and reject, temporary containers are compacted in place, or have
+// their items moved into the result when it's a different type of container.
+
+template <template <class...> class InContainer,
+          class ValType,
+          class = FuncHelpUtils::enable_if_t<!FuncHelpUtils::has_const_iterator<ValType>::value> >
+auto omit(InContainer<ValType> &&container, const ValType &omitted)
+ -> InContainer<ValType>
+{
+    FUNC_HELPERS_PROFILE_SCOPE("omit");
+    FUNC_HELPERS_PROFILE_VISIT(std::distance(container.begin(), container.end()));
+    FUNC_HELPERS_PROFILE_CALL(std::distance(container.begin(), container.end()));
+    FuncHelpUtils::keepIf(container, [&omitted] (const ValType &val) { return !(val == omitted); });
+    FUNC_HELPERS_PROFILE_OUTPUT(container);
+    return std::move(container);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class = FuncHelpUtils::enable_if_t<!FuncHelpUtils::has_const_iterator<ValType>::value>,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto omit(InContainer<ValType> &&container, const ValType &omitted)
+ -> OutContainer<ValType>
+{
+    FUNC_HELPERS_PROFILE_SCOPE("omit");
+    return FuncHelpUtils::moveIf<OutContainer<ValType> >(container, [&omitted] (const ValType &val) {
+        return !(val == omitted);
+    });
+}
+
+template <template <class...> class InContainer,
+          class ValType,
+          class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_const_iterator<Container>::value> >
+auto omit(InContainer<ValType> &&container, const Container &omitted)
+ -> InContainer<ValType>
+{
+    FUNC_HELPERS_PROFILE_SCOPE("omit");
+    FUNC_HELPERS_PROFILE_VISIT(std::distance(container.begin(), container.end()));
+    FUNC_HELPERS_PROFILE_CALL(std::distance(container.begin(), container.end()));
+    auto isOmitted = FuncHelpUtils::membership<ValType>(omitted, container);
+    FuncHelpUtils::keepIf(container, [&isOmitted] (const ValType &val) { return !isOmitted(val); });
+    FUNC_HELPERS_PROFILE_OUTPUT(container);
+    return std::move(container);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_const_iterator<Container>::value>,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto omit(InContainer<ValType> &&container, const Container &omitted)
+ -> OutContainer<ValType>
+{
+    FUNC_HELPERS_PROFILE_SCOPE("omit");
+    auto isOmitted = FuncHelpUtils::membership<ValType>(omitted, container);
+    return FuncHelpUtils::moveIf<OutContainer<ValType> >(container, [&isOmitted] (const ValType &val) {
+        return !isOmitted(val);
+    });
+}
+
+// intersect
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_const_iterator<Container>::value> >
+auto intersect(const InContainer<ValType> &container, const Container &other)
+ -> OutContainer<ValType>
+{
+    OutContainer<ValType> result;
+    FuncHelpUtils::reserveUpTo(result, FuncHelpUtils::sizeHint(container));
+    auto isInOther = FuncHelpUtils::membership<ValType>(other, container);
+    
+    for(const ValType &val : container) {
+        if (isInOther(val)) {
+            FuncHelpUtils::addItem(result, val);
+        }
+    }
+    
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_const_iterator<Container>::value>,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto intersect(const InContainer<ValType> &container, const Container &other)
+ -> OutContainer<ValType>
+{
+    return intersect<InContainer, OutContainer>(container, other);
+}
+
+// unionOf
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_const_iterator<Container>::value> >
+auto unionOf(const InContainer<ValType> &container, const Container &other)
+ -> OutContainer<ValType>
+{
+    OutContainer<ValType> result;
+    FuncHelpUtils::reserveUpTo(result, FuncHelpUtils::sizeHint(container) + FuncHelpUtils::sizeHint(other));
+    auto isInContainer = FuncHelpUtils::membership<ValType>(container, other);
+    
+    for(const ValType &val : container) {
+        FuncHelpUtils::addItem(result, val);
+    }
+    
+    for(auto const &val : other) {
+        if (!isInContainer(val)) {
+            FuncHelpUtils::addItem(result, ValType(val));
+        }
+    }
+    
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_const_iterator<Container>::value>,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto unionOf(const InContainer<ValType> &container, const Container &other)
+ -> OutContainer<ValType>
+{
+    return unionOf<InContainer, OutContainer>(container, other);
+}
+
+// difference
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_const_iterator<Container>::value> >
+auto difference(const InContainer<ValType> &container, const Container &other)
+ -> OutContainer<ValType>
+{
+    return omit<InContainer, OutContainer>(container, other);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_const_iterator<Container>::value>,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto difference(const InContainer<ValType> &container, const Container &other)
+ -> OutContainer<ValType>
+{
+    return omit<InContainer, OutContainer>(container, other);
+}
+
+// reversed
+
+namespace FuncHelpUtils {
+    template <class Container>
+    auto reverseInPlace(Container &container)
+     -> enable_if_t<std::is_base_of<std::list<typename Container::value_type>, Container>::value ||
+                    std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value>
+    {
+        container.reverse();
+    }
+    
+    template <class Container>
+    auto reverseInPlace(Container &container)
+     -> enable_if_t<!std::is_base_of<std::list<typename Container::value_type>, Container>::value &&
+                    !std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value &&
+                    has_mutable_items<Container>::value>
+    {
+        std::reverse(container.begin(), container.end());
+    }
+    
+    // The order of a set is determined by the set itself, so there is nothing
+    // to do.
+    template <class Container>
+    auto reverseInPlace(Container &container)
+     -> enable_if_t<!has_mutable_items<Container>::value>
+    {
+        (void)container;
+    }
+}
+
+template <class Container>
+Container reversed(const Container &container)
+{
+    Container result;
+    FuncHelpUtils::reserveSize(result, FuncHelpUtils::sizeHint(container));
+    
+    for(auto it = container.rbegin(); it != container.rend(); ++it) {
+        FuncHelpUtils::addItem(result, *it);
+    }
+    
+    return result;
+}
+
+// Temporary containers are reversed in place rather than copied.
+template <class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_reusable_rvalue<Container>::value> >
+Container reversed(Container &&container)
+{
+    FuncHelpUtils::reverseInPlace(container);
+    return std::move(container);
+}
+
+// first
+
+template <class Container>
+auto first(const Container &container)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
+    
+    if (container.size() == 0) {
+        return ValType();
+    } else {
+        return *(container.cbegin());
+    }
+}
+
+template <class Container, class ValType>
+auto first(const Container &container, const ValType &defaultValue)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    if (container.size() == 0) {
+        return defaultValue;
+    } else {
+        return *(container.cbegin());
+    }
+}
+
+// last
+
+template <class Container>
+auto last(const Container &container)
+ -> FuncHelpUtils::reverse_iterator_deref_decay<Container>
+{
+    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
+    
+    if (container.size() == 0) {
+        return ValType();
+    } else {
+        return *(container.crbegin());
+    }
+}
+
+template <class Container, class ValType>
+auto last(const Container &container, const ValType &defaultValue)
+ -> FuncHelpUtils::reverse_iterator_deref_decay<Container>
+{
+    if (container.size() == 0) {
+        return defaultValue;
+    } else {
+        return *(container.crbegin());
+    }
+}
+
+// range
+
+namespace FuncHelpUtils {
+    template <class OutType>
+    void appendRange(OutType &result, int start, int end, int inc)
+    {
+        const int size = FuncHelpUtils::rangeSize(start, end, inc);
+        FuncHelpUtils::reserveSize(result, size);
+        
+        for(int i = 0; i < size; ++i) {
+            FuncHelpUtils::addItem(result, int(start + (long long)i*inc));
+        }
+    }
+}
+
+template <template <class...> class OutContainer>
+auto range(int start, int end, int inc=1)
+ -> OutContainer<int>
+{
+    OutContainer<int> result;
+    FuncHelpUtils::appendRange(result, start, end, inc);
+    return result;
+}
+
+template <template <class...> class OutContainer>
+auto range(int end)
+ -> OutContainer<int>
+{
+    return range<OutContainer>(0, end);
+}
+
+// mapRange
+
+namespace FuncHelpUtils {
+    template <class OutType, class F>
+    void appendMappedRange(OutType &result, int start, int end, int inc, const F &func)
+    {
+        const int size = FuncHelpUtils::rangeSize(start, end, inc);
+        FuncHelpUtils::reserveSize(result, size);
+        
+        for(int i = 0; i < size; ++i) {
+            FuncHelpUtils::addItem(result, std::ref(func)(int(start + (long long)i*inc)));
+        }
+    }
+    
+    template <class OutType, class F1, class F2>
+    void appendMappedRange(OutType &result, int start, int end, int inc, const F1 &func, const F2 &predicate)
+    {
+        const int size = FuncHelpUtils::rangeSize(start, end, inc);
+        FuncHelpUtils::reserveUpTo(result, size);
+        
+        for(int i = 0; i < size; ++i) {
+            const int val = int(start + (long long)i*inc);
+            
+            if (std::ref(predicate)(val)) {
+                FuncHelpUtils::addItem(result, std::ref(func)(val));
+            }
+        }
+    }
+}
+
+template <template <class...> class OutContainer,
+          class F>
+auto mapRange(int start, int end, int inc, F func)
+ -> OutContainer<FuncHelpUtils::func_result<int, F> >
+{
+    OutContainer<FuncHelpUtils::func_result<int, F> > result;
+    FuncHelpUtils::appendMappedRange(result, start, end, inc, func);
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          class F1,
+          class F2>
+auto mapRange(int start, int end, int inc, F1 func, F2 predicate)
+ -> OutContainer<FuncHelpUtils::func_result<int, F1> >
+{
+    OutContainer<FuncHelpUtils::func_result<int, F1> > result;
+    FuncHelpUtils::appendMappedRange(result, start, end, inc, func, predicate);
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          class F>
+auto mapRange(int start, int end, F func)
+-> OutContainer<FuncHelpUtils::func_result<int, F> >
+{
+    return mapRange<OutContainer>(start, end, 1, func);
+}
+
+template <template <class...> class OutContainer,
+          class F1,
+          class F2>
+auto mapRange(int start, int end, F1 func, F2 predicate)
+ -> OutContainer<FuncHelpUtils::func_result<int, F1> >
+{
+    return mapRange<OutContainer>(start, end, 1, func, predicate);
+}
+
+template <template <class...> class OutContainer,
+          class F>
+auto mapRange(int end, F func)
+-> OutContainer<FuncHelpUtils::func_result<int, F> >
+{
+    return mapRange<OutContainer>(0, end, 1, func);
+}
+
+template <template <class...> class OutContainer,
+          class F1,
+          class F2>
+auto mapRange(int end, F1 func, F2 predicate)
+ -> OutContainer<FuncHelpUtils::func_result<int, F1> >
+{
+    return mapRange<OutContainer>(0, end, 1, func, predicate);
+}
+
+// flatten
+
+namespace FuncHelpUtils {
+    template <class OutType, class InType>
+    void appendFlattened(OutType &result, const InType &container)
+    {
+        FuncHelpUtils::reserveSize(result, FuncHelpUtils::nestedSizeHint(container));
+        
+        for(auto const &nested : container) {
+            FuncHelpUtils::addItems(result, nested.begin(), nested.end());
+        }
+    }
+}
+
+template <template <class...> class NestedContainer,
+          template <class...> class InContainer,
+          template <class...> class OutContainer = NestedContainer,
+          class ValType>
+auto flatten(const InContainer< NestedContainer<ValType> > &container)
+ -> OutContainer<ValType>
+{
+    OutContainer<ValType> result;
+    FuncHelpUtils::appendFlattened(result, container);
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          template <class...> class NestedContainer,
+          class ValType,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, NestedContainer<int> >::value> >
+auto flatten(const InContainer<NestedContainer<ValType> > &container)
+ -> OutContainer<ValType>
+{
+    return flatten<NestedContainer, InContainer, OutContainer>(container);
+}
+
+// flatMap
+
+namespace FuncHelpUtils {
+    template <class Container, class F>
+    using flat_map_result = iterator_deref_decay<func_container_result<Container, F> >;
+    
+    // When func returns a temporary container its items are moved into the
+    // result, and when it returns a reference to one they're copied.
+    template <class OutType, class Nested>
+    void appendNested(OutType &result, Nested &&nested, std::false_type)
+    {
+        FuncHelpUtils::addItems(result, std::make_move_iterator(nested.begin()), std::make_move_iterator(nested.end()));
+    }
+    
+    template <class OutType, class Nested>
+    void appendNested(OutType &result, Nested &&nested, std::true_type)
+    {
+        FuncHelpUtils::addItems(result, nested.begin(), nested.end());
+    }
+    
+    template <class OutType, class InType, class F>
+    void appendFlatMapped(OutType &result, const InType &container, const F &func)
+    {
+        using Nested = func_container_result_undecayed<InType, F>;
+        
+        for(auto const &val : container) {
+            FuncHelpUtils::appendNested(result, std::ref(func)(decltype(val)(val)),
+                                        std::integral_constant<bool, std::is_reference<Nested>::value>());
+        }
+    }
 }
 
 template <template <class...> class InContainer,
           template <class...> class OutContainer = InContainer,
-          class ValType,
+          class InType,
           class F>
-auto reject(const InContainer<ValType> &container, const F &predicate)
- -> OutContainer<ValType>
+auto flatMap(const InContainer<InType> &container, const F &func)
+ -> OutContainer<FuncHelpUtils::flat_map_result<InContainer<InType>, F> >
 {
-    return reject<InContainer<ValType>, OutContainer<ValType>, F>(container, predicate);
+    OutContainer<FuncHelpUtils::flat_map_result<InContainer<InType>, F> > result;
+    FuncHelpUtils::appendFlatMapped(result, container, func);
+    return result;
 }
 
 template <template <class...> class OutContainer,
           template <class...> class InContainer,
-          class ValType,
+          class InType,
           class F,
           class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
-auto reject(const InContainer<ValType> &container, const F &predicate)
- -> OutContainer<ValType>
+auto flatMap(const InContainer<InType> &container, const F &func)
+ -> OutContainer<FuncHelpUtils::flat_map_result<InContainer<InType>, F> >
 {
-    return reject<InContainer, OutContainer>(container, predicate);
+    return flatMap<InContainer, OutContainer>(container, func);
 }
 
-// all of
+// mapInto, comprInto, filterInto, rejectInto, flattenInto, rangeInto and
+// mapRangeInto
 
-template <class Container, class F>
-bool allOf(Container const &container, const F &f)
+// These write their results into output rather than into a new container.
+// output is either a container, which is cleared first and then returned, or
+// an output iterator, in which case the iterator just past the last item
+// written is returned. Since clearing a std::vector or std::string keeps its
+// capacity, reusing the same one in a loop only allocates until it's large
+// enough.
+
+namespace FuncHelpUtils {
+    // IntoTarget is what the *Into functions add their results to: output
+    // itself if it's a container, or an OutputSink wrapping it if it's an
+    // output iterator.
+    template <class Output, bool IsContainer = has_const_iterator<Output>::value>
+    class IntoTarget {
+    public:
+        explicit IntoTarget(Output &output) : output(output) { output.clear(); }
+        Output &items() { return output; }
+        Output &result() { return output; }
+        
+    private:
+        Output &output;
+    };
+    
+    template <class Output>
+    class IntoTarget<Output, false> {
+    public:
+        explicit IntoTarget(Output output) : sink{output} {}
+        OutputSink<Output> &items() { return sink; }
+        Output result() { return sink.it; }
+        
+    private:
+        OutputSink<Output> sink;
+    };
+    
+    // The return type of the *Into functions. Temporary containers aren't
+    // accepted as output since the result would be lost.
+    template <class Output>
+    using into_result = enable_if_t<!has_const_iterator<decay_t<Output> >::value || std::is_lvalue_reference<Output>::value,
+                                    decltype(std::declval<IntoTarget<decay_t<Output> > &>().result())>;
+}
+
+template <class Output,
+          class InType,
+          class F>
+auto mapInto(Output &&output, const InType &container, const F &func)
+ -> FuncHelpUtils::into_result<Output>
 {
-    for(auto const &val : container) {
-        if (!std::ref(f)(decltype(val)(val))) {
-            return false;
-        }
-    }
-    return true;
+    FuncHelpUtils::IntoTarget<FuncHelpUtils::decay_t<Output> > target(output);
+    FUNC_HELPERS_PROFILE_SCOPE("mapInto");
+    FuncHelpUtils::appendMapped(target.items(), container, func);
+    return target.result();
 }
 
-// any of
+template <class Output,
+          class InType,
+          class F1,
+          class F2>
+auto comprInto(Output &&output, const InType &container, const F1 &func, const F2 &predicate)
+ -> FuncHelpUtils::into_result<Output>
+{
+    FuncHelpUtils::IntoTarget<FuncHelpUtils::decay_t<Output> > target(output);
+    FUNC_HELPERS_PROFILE_SCOPE("comprInto");
+    FuncHelpUtils::appendCompr(target.items(), container, func, predicate);
+    return target.result();
+}
 
-template <class Container, class F>
-bool anyOf(Container const &container, const F &f)
+template <class Output,
+          class InType,
+          class F>
+auto filterInto(Output &&output, const InType &container, const F &predicate)
+ -> FuncHelpUtils::into_result<Output>
 {
-    for(auto const &val : container) {
-        if (std::ref(f)(decltype(val)(val))) {
+    FuncHelpUtils::IntoTarget<FuncHelpUtils::decay_t<Output> > target(output);
+    FUNC_HELPERS_PROFILE_SCOPE("filterInto");
+    FuncHelpUtils::appendFiltered<true>(target.items(), container, predicate);
+    return target.result();
+}
+
+template <class Output,
+          class InType,
+          class F>
+auto rejectInto(Output &&output, const InType &container, const F &predicate)
+ -> FuncHelpUtils::into_result<Output>
+{
+    FuncHelpUtils::IntoTarget<FuncHelpUtils::decay_t<Output> > target(output);
+    FUNC_HELPERS_PROFILE_SCOPE("rejectInto");
+    FuncHelpUtils::appendFiltered<false>(target.items(), container, predicate);
+    return target.result();
+}
+
+template <class Output,
+          class InType>
+auto flattenInto(Output &&output, const InType &container)
+ -> FuncHelpUtils::into_result<Output>
+{
+    FuncHelpUtils::IntoTarget<FuncHelpUtils::decay_t<Output> > target(output);
+    FuncHelpUtils::appendFlattened(target.items(), container);
+    return target.result();
+}
+
+template <class Output>
+auto rangeInto(Output &&output, int start, int end, int inc=1)
+ -> FuncHelpUtils::into_result<Output>
+{
+    FuncHelpUtils::IntoTarget<FuncHelpUtils::decay_t<Output> > target(output);
+    FuncHelpUtils::appendRange(target.items(), start, end, inc);
+    return target.result();
+}
+
+template <class Output>
+auto rangeInto(Output &&output, int end)
+ -> FuncHelpUtils::into_result<Output>
+{
+    return rangeInto(std::forward<Output>(output), 0, end);
+}
+
+template <class Output,
+          class F>
+auto mapRangeInto(Output &&output, int start, int end, int inc, const F &func)
+ -> FuncHelpUtils::into_result<Output>
+{
+    FuncHelpUtils::IntoTarget<FuncHelpUtils::decay_t<Output> > target(output);
+    FuncHelpUtils::appendMappedRange(target.items(), start, end, inc, func);
+    return target.result();
+}
+
+template <class Output,
+          class F1,
+          class F2>
+auto mapRangeInto(Output &&output, int start, int end, int inc, const F1 &func, const F2 &predicate)
+ -> FuncHelpUtils::into_result<Output>
+{
+    FuncHelpUtils::IntoTarget<FuncHelpUtils::decay_t<Output> > target(output);
+    FuncHelpUtils::appendMappedRange(target.items(), start, end, inc, func, predicate);
+    return target.result();
+}
+
+template <class Output,
+          class F>
+auto mapRangeInto(Output &&output, int start, int end, const F &func)
+ -> FuncHelpUtils::into_result<Output>
+{
+    return mapRangeInto(std::forward<Output>(output), start, end, 1, func);
+}
+
+template <class Output,
+          class F1,
+          class F2>
+auto mapRangeInto(Output &&output, int start, int end, const F1 &func, const F2 &predicate)
+ -> FuncHelpUtils::into_result<Output>
+{
+    return mapRangeInto(std::forward<Output>(output), start, end, 1, func, predicate);
+}
+
+template <class Output,
+          class F>
+auto mapRangeInto(Output &&output, int end, const F &func)
+ -> FuncHelpUtils::into_result<Output>
+{
+    return mapRangeInto(std::forward<Output>(output), 0, end, 1, func);
+}
+
+template <class Output,
+          class F1,
+          class F2>
+auto mapRangeInto(Output &&output, int end, const F1 &func, const F2 &predicate)
+ -> FuncHelpUtils::into_result<Output>
+{
+    return mapRangeInto(std::forward<Output>(output), 0, end, 1, func, predicate);
+}
+
+// view
+
+// Lazy views allow chaining map, filter and reject without constructing a
+// container for each step. Nothing is evaluated until the view is either
+// converted into a container using to(), or consumed by reduce, sum, allOf,
+// anyOf or first. At that point each item is passed through every stage in a
+// single pass.
+//
+// Internally a view is a pipeline of stages, each of which implements
+// forEach(sink). forEach passes every item that comes out of the stage to
+// sink, and stops early if sink returns false. forEach returns false if it
+// was stopped early. Items are passed to sink as the stage's reference type,
+// which is usually its value_type, but for zip and enumerate is a tuple of
+// references that to() converts to value_type.
+
+namespace FuncHelpUtils {
+    // Storage is either a const reference to a container, or a container
+    // itself when the view was created from a temporary.
+    template <class Storage>
+    class ViewSource {
+    public:
+        using Container = decay_t<Storage>;
+        using value_type = iterator_deref_decay<Container>;
+        using reference = value_type;
+        
+        explicit ViewSource(Storage container) : container(std::forward<Storage>(container)) {}
+        
+        template <class Sink>
+        bool forEach(Sink &sink) const
+        {
+            for(auto const &val : container) {
+                if (!sink(val)) {
+                    return false;
+                }
+            }
+            
             return true;
         }
+        
+        int sizeHint() const
+        {
+            return FuncHelpUtils::sizeHint(container);
+        }
+        
+    private:
+        Storage container;
+    };
+    
+    template <class Inner, class F>
+    class ViewMap {
+    public:
+        using value_type = func_result<const typename Inner::reference, F>;
+        using reference = value_type;
+        
+        ViewMap(Inner inner, const F &func) : inner(std::move(inner)), func(func) {}
+        
+        template <class Sink>
+        bool forEach(Sink &sink) const
+        {
+            Stage<Sink> stage = {sink, func};
+            return inner.forEach(stage);
+        }
+        
+        int sizeHint() const
+        {
+            return inner.sizeHint();
+        }
+        
+    private:
+        template <class Sink>
+        struct Stage {
+            Sink &sink;
+            const F &func;
+            
+            template <class T>
+            bool operator()(const T &val) const
+            {
+                return sink(std::ref(func)(val));
+            }
+        };
+        
+        Inner inner;
+        F func;
+    };
+    
+    // Keep is true for filter and false for reject.
+    template <class Inner, class F, bool Keep>
+    class ViewFilter {
+    public:
+        using value_type = typename Inner::value_type;
+        using reference = typename Inner::reference;
+        
+        ViewFilter(Inner inner, const F &predicate) : inner(std::move(inner)), predicate(predicate) {}
+        
+        template <class Sink>
+        bool forEach(Sink &sink) const
+        {
+            Stage<Sink> stage = {sink, predicate};
+            return inner.forEach(stage);
+        }
+        
+        // The number of items that pass isn't known ahead of time, so this is
+        // an upper bound.
+        int sizeHint() const
+        {
+            return inner.sizeHint();
+        }
+        
+    private:
+        template <class Sink>
+        struct Stage {
+            Sink &sink;
+            const F &predicate;
+            
+            template <class T>
+            bool operator()(const T &val) const
+            {
+                if (bool(std::ref(predicate)(val)) != Keep) {
+                    return true;
+                }
+                
+                return sink(val);
+            }
+        };
+        
+        Inner inner;
+        F predicate;
+    };
+    
+    template <class F>
+    struct MappedAdaptor {
+        F func;
+    };
+    
+    template <class F, bool Keep>
+    struct FilteredAdaptor {
+        F predicate;
+    };
+}
+
+template <class Pipeline>
+class LazyView {
+public:
+    using value_type = typename Pipeline::value_type;
+    using reference = typename Pipeline::reference;
+    
+    explicit LazyView(Pipeline pipeline) : pipeline(std::move(pipeline)) {}
+    
+    template <class Sink>
+    bool forEach(Sink &sink) const
+    {
+        return pipeline.forEach(sink);
+    }
+    
+    int sizeHint() const
+    {
+        return pipeline.sizeHint();
+    }
+    
+    // Evaluates the view into a new container, e.g. to<std::vector>() or
+    // to<QStringList>()
+    template <template <class...> class OutContainer>
+    OutContainer<value_type> to() const
+    {
+        return to<OutContainer<value_type> >();
     }
-    return false;
+    
+    template <class OutContainer>
+    OutContainer to() const
+    {
+        OutContainer result;
+        FuncHelpUtils::reserveUpTo(result, sizeHint());
+        auto sink = [&result] (const reference &val) {
+            FuncHelpUtils::addItem(result, static_cast<const value_type &>(val));
+            return true;
+        };
+        pipeline.forEach(sink);
+        return result;
+    }
+    
+private:
+    Pipeline pipeline;
+};
+
+template <class Container>
+auto view(const Container &container)
+ -> LazyView<FuncHelpUtils::ViewSource<const Container &> >
+{
+    return LazyView<FuncHelpUtils::ViewSource<const Container &> >(FuncHelpUtils::ViewSource<const Container &>(container));
 }
 
-// extremum
+// Views of temporary containers take ownership of them.
+template <class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_reusable_rvalue<Container>::value> >
+auto view(Container &&container)
+ -> LazyView<FuncHelpUtils::ViewSource<Container> >
+{
+    return LazyView<FuncHelpUtils::ViewSource<Container> >(FuncHelpUtils::ViewSource<Container>(std::move(container)));
+}
+
+template <class F>
+auto mapped(const F &func)
+ -> FuncHelpUtils::MappedAdaptor<FuncHelpUtils::decay_t<F> >
+{
+    return FuncHelpUtils::MappedAdaptor<FuncHelpUtils::decay_t<F> >{func};
+}
+
+template <class F>
+auto filtered(const F &predicate)
+ -> FuncHelpUtils::FilteredAdaptor<FuncHelpUtils::decay_t<F>, true>
+{
+    return FuncHelpUtils::FilteredAdaptor<FuncHelpUtils::decay_t<F>, true>{predicate};
+}
+
+template <class F>
+auto rejected(const F &predicate)
+ -> FuncHelpUtils::FilteredAdaptor<FuncHelpUtils::decay_t<F>, false>
+{
+    return FuncHelpUtils::FilteredAdaptor<FuncHelpUtils::decay_t<F>, false>{predicate};
+}
+
+template <class Pipeline, class F>
+auto operator|(LazyView<Pipeline> view, const FuncHelpUtils::MappedAdaptor<F> &adaptor)
+ -> LazyView<FuncHelpUtils::ViewMap<LazyView<Pipeline>, F> >
+{
+    using Stage = FuncHelpUtils::ViewMap<LazyView<Pipeline>, F>;
+    return LazyView<Stage>(Stage(std::move(view), adaptor.func));
+}
+
+template <class Pipeline, class F, bool Keep>
+auto operator|(LazyView<Pipeline> view, const FuncHelpUtils::FilteredAdaptor<F, Keep> &adaptor)
+ -> LazyView<FuncHelpUtils::ViewFilter<LazyView<Pipeline>, F, Keep> >
+{
+    using Stage = FuncHelpUtils::ViewFilter<LazyView<Pipeline>, F, Keep>;
+    return LazyView<Stage>(Stage(std::move(view), adaptor.predicate));
+}
+
+// zip, enumerate and mapWith
+
+// zip(a, b, ...) is a view of the containers' items taken in lockstep, and
+// enumerate(container) is a view of each item along with its index. Their
+// items are std::tuples of references into the containers, made one at a time
+// as the containers are walked with their own iterators, so they work with
+// containers like std::list that can't be indexed. zip stops at the end of
+// the shortest container. Evaluating either view with to() copies the values
+// into tuples that don't refer back to the containers.
+//
+// mapWith(a, b, func) calls func(itemOfA, itemOfB) for each pair of items in
+// lockstep and collects the results, without going through a view.
 
 namespace FuncHelpUtils {
-    template <class Container, class F>
-    auto extremumBase(const Container &container, const F &comp)
-     -> const iterator_deref_decay<Container> *
-    {
-        using ValType = iterator_deref_decay<Container>;
-        const ValType *extremumValue = nullptr;
+    template <size_t... Indexes>
+    struct IndexList {};
+    
+    template <size_t Count, size_t... Indexes>
+    struct MakeIndexList : MakeIndexList<Count - 1, Count - 1, Indexes...> {};
+    
+    template <size_t... Indexes>
+    struct MakeIndexList<0, Indexes...> {
+        using type = IndexList<Indexes...>;
+    };
+    
+    template <class... Containers>
+    struct all_have_size {
+        enum { value = true };
+    };
+    
+    template <class Container, class... Containers>
+    struct all_have_size<Container, Containers...> {
+        enum { value = has_size<Container>::value && all_have_size<Containers...>::value };
+    };
+    
+    // Temporary containers are kept by value, like in a ViewSource.
+    template <class Container>
+    using view_storage = typename std::conditional<is_reusable_rvalue<Container>::value,
+                                                   Container, const decay_t<Container> &>::type;
+    
+    template <class... Storage>
+    class ViewZip {
+    public:
+        using value_type = std::tuple<iterator_deref_decay<decay_t<Storage> >...>;
+        using reference = std::tuple<iterator_deref<const decay_t<Storage> >...>;
+        
+        explicit ViewZip(Storage... containers) : containers(std::forward<Storage>(containers)...) {}
+        
+        template <class Sink>
+        bool forEach(Sink &sink) const
+        {
+            return forEachZipped(sink, typename MakeIndexList<sizeof...(Storage)>::type(),
+                                 std::integral_constant<bool, all_have_size<decay_t<Storage>...>::value>());
+        }
+        
+        int sizeHint() const
+        {
+            return sizeHintZipped(typename MakeIndexList<sizeof...(Storage)>::type());
+        }
+        
+    private:
+        // When every container knows its size, the number of items is worked
+        // out up front, so that only one counter is checked for each item.
+        template <class Sink, size_t... Indexes>
+        bool forEachZipped(Sink &sink, IndexList<Indexes...>, std::true_type) const
+        {
+            const size_t sizes[] = {size_t(std::get<Indexes>(containers).size())...};
+            auto its = std::make_tuple(std::get<Indexes>(containers).begin()...);
+            
+            for(size_t count = *std::min_element(std::begin(sizes), std::end(sizes)); count > 0; --count) {
+                if (!sink(reference(*std::get<Indexes>(its)...))) {
+                    return false;
+                }
+                
+                const int advanced[] = {(++std::get<Indexes>(its), 0)...};
+                (void)advanced;
+            }
+            
+            return true;
+        }
+        
+        template <class Sink, size_t... Indexes>
+        bool forEachZipped(Sink &sink, IndexList<Indexes...>, std::false_type) const
+        {
+            auto its = std::make_tuple(std::get<Indexes>(containers).begin()...);
+            
+            while(!anyAtEnd(its, IndexList<Indexes...>())) {
+                if (!sink(reference(*std::get<Indexes>(its)...))) {
+                    return false;
+                }
+                
+                const int advanced[] = {(++std::get<Indexes>(its), 0)...};
+                (void)advanced;
+            }
+            
+            return true;
+        }
+        
+        template <class Iterators>
+        bool anyAtEnd(const Iterators &, IndexList<>) const
+        {
+            return false;
+        }
+        
+        template <class Iterators, size_t Index, size_t... Indexes>
+        bool anyAtEnd(const Iterators &its, IndexList<Index, Indexes...>) const
+        {
+            return std::get<Index>(its) == std::get<Index>(containers).end() || anyAtEnd(its, IndexList<Indexes...>());
+        }
+        
+        template <size_t... Indexes>
+        int sizeHintZipped(IndexList<Indexes...>) const
+        {
+            const int hints[] = {FuncHelpUtils::sizeHint(std::get<Indexes>(containers))...};
+            return *std::min_element(std::begin(hints), std::end(hints));
+        }
+        
+        std::tuple<Storage...> containers;
+    };
+    
+    template <class Storage>
+    class ViewEnumerate {
+    public:
+        using Container = decay_t<Storage>;
+        using value_type = std::tuple<size_t, iterator_deref_decay<Container> >;
+        using reference = std::tuple<size_t, iterator_deref<const Container> >;
+        
+        explicit ViewEnumerate(Storage container) : container(std::forward<Storage>(container)) {}
+        
+        template <class Sink>
+        bool forEach(Sink &sink) const
+        {
+            size_t index = 0;
+            
+            for(auto it = container.begin(); it != container.end(); ++it, ++index) {
+                if (!sink(reference(index, *it))) {
+                    return false;
+                }
+            }
+            
+            return true;
+        }
         
-        for(auto const &val : container) {
-            if (!extremumValue || std::ref(comp)(decltype(val)(val), *extremumValue)) {
-                extremumValue = &(val);
-            }
+        int sizeHint() const
+        {
+            return FuncHelpUtils::sizeHint(container);
         }
+        
+    private:
+        Storage container;
+    };
     
-        return extremumValue;
+    template <class OutContainer, class Container1, class Container2, class F>
+    OutContainer mapWithBase(const Container1 &container1, const Container2 &container2, const F &func)
+    {
+        OutContainer result;
+        FuncHelpUtils::reserveSize(result, std::min(sizeHint(container1), sizeHint(container2)));
+        auto it2 = container2.begin();
+        
+        for(auto it1 = container1.begin(); it1 != container1.end() && it2 != container2.end(); ++it1, ++it2) {
+            FuncHelpUtils::addItem(result, std::ref(func)(*it1, *it2));
+        }
+        
+        return result;
     }
 }
 
-template <class Container, class F>
-auto extremum(const Container &container, const F &comp)
- -> FuncHelpUtils::iterator_deref_decay<Container>
+template <class... Containers>
+auto zip(Containers &&...containers)
+ -> LazyView<FuncHelpUtils::ViewZip<FuncHelpUtils::view_storage<Containers>...> >
 {
-    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
-    const ValType *extremumValue = FuncHelpUtils::extremumBase(container, comp);
-    
-    if (extremumValue) {
-        return *extremumValue;
-    } else {
-        return ValType();
-    }
+    using Stage = FuncHelpUtils::ViewZip<FuncHelpUtils::view_storage<Containers>...>;
+    return LazyView<Stage>(Stage(std::forward<Containers>(containers)...));
 }
 
-template <class Container, class F, class ValType>
-auto extremum(const Container &container, const F &comp, const ValType &defaultVal)
- -> FuncHelpUtils::iterator_deref_decay<Container>
+template <class Container>
+auto enumerate(Container &&container)
+ -> LazyView<FuncHelpUtils::ViewEnumerate<FuncHelpUtils::view_storage<Container> > >
 {
-    const ValType *extremumValue = FuncHelpUtils::extremumBase(container, comp);
-    
-    if (extremumValue) {
-        return *extremumValue;
-    } else {
-        return defaultVal;
-    }
+    using Stage = FuncHelpUtils::ViewEnumerate<FuncHelpUtils::view_storage<Container> >;
+    return LazyView<Stage>(Stage(std::forward<Container>(container)));
 }
 
-// min(container)
-
-template <class Container>
-auto min(const Container &container)
- -> FuncHelpUtils::iterator_deref_decay<Container>
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class Container2,
+          class F>
+auto mapWith(const InContainer<ValType> &container1, const Container2 &container2, const F &func)
+ -> OutContainer<FuncHelpUtils::decay_t<decltype(std::ref(func)(*container1.begin(), *container2.begin()))> >
 {
-    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
-    return extremum(container, [] (const ValType &a, const ValType &b) {return a < b; });
+    using OutType = OutContainer<FuncHelpUtils::decay_t<decltype(std::ref(func)(*container1.begin(), *container2.begin()))> >;
+    return FuncHelpUtils::mapWithBase<OutType>(container1, container2, func);
 }
 
-template <class Container,
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
           class ValType,
-          class = FuncHelpUtils::enable_if_t<!FuncHelpUtils::is_callable<ValType, FuncHelpUtils::iterator_deref<Container> >::value> >
-auto min(const Container &container, const ValType &defaultVal)
- -> ValType
+          class Container2,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto mapWith(const InContainer<ValType> &container1, const Container2 &container2, const F &func)
+ -> OutContainer<FuncHelpUtils::decay_t<decltype(std::ref(func)(*container1.begin(), *container2.begin()))> >
 {
-    return extremum(container, [] (const ValType &a, const ValType &b) {return a < b; }, defaultVal);
+    return mapWith<InContainer, OutContainer>(container1, container2, func);
 }
 
-// min(container, func)
+// chunked and windowed
+
+// chunked(container, n) is a view of consecutive batches of n items, the last
+// of which may be shorter, and windowed(container, n, step) is a view of every
+// run of n consecutive items starting step items apart, leaving out any run
+// that would go past the end. Either lets a function that's expensive to call
+// be called once per batch, e.g. map(chunked(rows, 512), writeRows).
+//
+// The items of these views are Slices, which refer to the batch's items in
+// container rather than copying them. Containers that store their values
+// contiguously are sliced with pointers, so a Slice of a std::vector<int> can
+// be passed to sum and the other vectorized helpers, and other containers are
+// sliced with their own iterators. A Slice only remains valid as long as its
+// container does, or as long as the view when the view owns a temporary
+// container. SliceOf<Container> names the type of a Slice of Container, e.g.
+// for the parameter of a lambda.
+//
+// Views where n or step is 0 are empty.
 
 namespace FuncHelpUtils {
-    template <class Container, class F>
-    auto minBase(const Container &container, const F &func)
-      -> const FuncHelpUtils::iterator_deref_decay<Container> *
+    // Helper to determine whether a container stores its values contiguously,
+    // i.e. it has a data() method returning a pointer to its values.
+    template<typename T>
+    struct has_contiguous_data {
+    private:
+        template<typename C> static auto test(C *c)
+         -> enable_if_t<std::is_same<decltype(static_cast<const C *>(c)->data()), const iterator_deref_decay<C> *>::value &&
+                        has_size<C>::value, char>;
+        template<typename C> static int  test(...);
+    public:
+        enum { value = sizeof(test<T>(0)) == sizeof(char) };
+    };
+    
+    template <class Container>
+    using slice_iterator = typename std::conditional<has_contiguous_data<Container>::value,
+                                                     const iterator_deref_decay<Container> *,
+                                                     decltype(std::declval<const Container &>().begin())>::type;
+    
+    template <class Container>
+    auto sliceBegin(const Container &container)
+     -> enable_if_t<has_contiguous_data<Container>::value, slice_iterator<Container> >
     {
-        using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
-        using W = func_container_result<Container, F>;
-        const ValType *extremumValue = nullptr;
-        W extremumComparator;
+        return container.data();
+    }
+    
+    template <class Container>
+    auto sliceBegin(const Container &container)
+     -> enable_if_t<!has_contiguous_data<Container>::value, slice_iterator<Container> >
+    {
+        return container.begin();
+    }
+    
+    template <class Container>
+    auto sliceEnd(const Container &container)
+     -> enable_if_t<has_contiguous_data<Container>::value, slice_iterator<Container> >
+    {
+        return container.data() + container.size();
+    }
+    
+    template <class Container>
+    auto sliceEnd(const Container &container)
+     -> enable_if_t<!has_contiguous_data<Container>::value, slice_iterator<Container> >
+    {
+        return container.end();
+    }
+    
+    // advanceUpTo moves it forward by count items, or to end if that's
+    // closer, and returns how many items it moved.
+    template <class Iterator>
+    size_t advanceUpTo(Iterator &it, const Iterator &end, size_t count, std::random_access_iterator_tag)
+    {
+        count = std::min(count, size_t(end - it));
+        it += typename std::iterator_traits<Iterator>::difference_type(count);
+        return count;
+    }
+    
+    template <class Iterator>
+    size_t advanceUpTo(Iterator &it, const Iterator &end, size_t count, std::forward_iterator_tag)
+    {
+        size_t moved = 0;
         
-        for(auto const &val : container) {
-            W currentComparator = std::ref(func)(decltype(val)(val));
-            
-            if (!extremumValue || currentComparator < extremumComparator) {
-                extremumValue = &(val);
-                extremumComparator = currentComparator;
-            }
+        for(; moved < count && it != end; ++moved) {
+            ++it;
         }
+        
+        return moved;
+    }
     
-        return extremumValue;
+    template <class Iterator>
+    size_t advanceUpTo(Iterator &it, const Iterator &end, size_t count)
+    {
+        return advanceUpTo(it, end, count, typename std::iterator_traits<Iterator>::iterator_category());
     }
 }
 
-template <class Container,
-          class F,
-          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_callable<F, FuncHelpUtils::iterator_deref<Container> >::value> >
-auto min(const Container &container, const F &func)
- -> FuncHelpUtils::iterator_deref_decay<Container>
-{
-    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
-    const ValType *extremumValue = FuncHelpUtils::minBase(container, func);
-
-    if (extremumValue) {
-        return *extremumValue;
-    } else {
-        return ValType();
+// Contiguous is only there to give Slices of pointers a data() method.
+template <class Iterator, bool Contiguous = std::is_pointer<Iterator>::value>
+class Slice {
+public:
+    using const_iterator = Iterator;
+    using iterator = Iterator;
+    using value_type = typename std::iterator_traits<Iterator>::value_type;
+    using reference = typename std::iterator_traits<Iterator>::reference;
+    using const_reference = reference;
+    using size_type = size_t;
+    
+    Slice() : beginIt(), endIt(), itemCount(0) {}
+    Slice(Iterator begin, Iterator end, size_t size) : beginIt(begin), endIt(end), itemCount(size) {}
+    
+    Iterator begin() const { return beginIt; }
+    Iterator end() const { return endIt; }
+    Iterator cbegin() const { return beginIt; }
+    Iterator cend() const { return endIt; }
+    size_t size() const { return itemCount; }
+    bool empty() const { return itemCount == 0; }
+    reference front() const { return *beginIt; }
+    
+    // Only for Slices of random access containers.
+    reference operator[](size_t index) const
+    {
+        return beginIt[typename std::iterator_traits<Iterator>::difference_type(index)];
     }
-}
-
-template <class Container, class F, class ValType>
-ValType min(const Container &container, const F &func, const ValType &defaultVal)
-{
-    const ValType *extremumValue = FuncHelpUtils::minBase(container, func);
-
-    if (extremumValue) {
-        return *extremumValue;
-    } else {
-        return defaultVal;
+    
+    template <bool IsContiguous = Contiguous>
+    auto data() const
+     -> FuncHelpUtils::enable_if_t<IsContiguous, Iterator>
+    {
+        return beginIt;
     }
-}
-
-// max(container)
+    
+private:
+    Iterator beginIt;
+    Iterator endIt;
+    size_t itemCount;
+};
 
 template <class Container>
-auto max(const Container &container)
- -> FuncHelpUtils::iterator_deref_decay<Container>
-{
-    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
-    return extremum(container, [] (const ValType &a, const ValType &b) {return a > b; });
-}
-
-template <class Container,
-          class ValType,
-          class = FuncHelpUtils::enable_if_t<!FuncHelpUtils::is_callable<ValType, FuncHelpUtils::iterator_deref<Container> >::value> >
-auto max(const Container &container, const ValType &defaultVal)
- -> ValType
-{
-    return extremum(container, [] (const ValType &a, const ValType &b) {return a > b; }, defaultVal);
-}
-
-// max(container, func)
+using SliceOf = Slice<FuncHelpUtils::slice_iterator<FuncHelpUtils::decay_t<Container> > >;
 
 namespace FuncHelpUtils {
-    template <class Container, class F>
-    auto maxBase(const Container &container, const F &func)
-        -> const FuncHelpUtils::iterator_deref_decay<Container> *
-    {
-        using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
-        using W = func_container_result<Container, F>;
-        const ValType *extremumValue = nullptr;
-        W extremumComparator;
+    template <class Storage>
+    class ViewChunks {
+    public:
+        using Container = decay_t<Storage>;
+        using value_type = SliceOf<Container>;
+        using reference = value_type;
         
-        for(auto const &val : container) {
-            W currentComparator = std::ref(func)(decltype(val)(val));
+        ViewChunks(Storage container, size_t count) : container(std::forward<Storage>(container)), count(count) {}
+        
+        template <class Sink>
+        bool forEach(Sink &sink) const
+        {
+            const auto end = sliceEnd(container);
             
-            if (!extremumValue || currentComparator > extremumComparator) {
-                extremumValue = &(val);
-                extremumComparator = currentComparator;
+            if (count == 0) {
+                return true;
+            }
+            
+            for(auto it = sliceBegin(container); it != end;) {
+                auto chunkBegin = it;
+                const size_t size = advanceUpTo(it, end, count);
+                
+                if (!sink(value_type(chunkBegin, it, size))) {
+                    return false;
+                }
             }
+            
+            return true;
+        }
+        
+        int sizeHint() const
+        {
+            return count ? int((size_t(FuncHelpUtils::sizeHint(container)) + count - 1) / count) : 0;
         }
+        
+    private:
+        Storage container;
+        size_t count;
+    };
     
-        return extremumValue;
-    }
+    template <class Storage>
+    class ViewWindows {
+    public:
+        using Container = decay_t<Storage>;
+        using value_type = SliceOf<Container>;
+        using reference = value_type;
+        
+        ViewWindows(Storage container, size_t count, size_t step)
+         : container(std::forward<Storage>(container)), count(count), step(step) {}
+        
+        // The start and end of the window are each moved forward by step, so
+        // every item is passed over at most twice, whatever the window size.
+        template <class Sink>
+        bool forEach(Sink &sink) const
+        {
+            const auto end = sliceEnd(container);
+            auto windowBegin = sliceBegin(container);
+            auto windowEnd = windowBegin;
+            
+            if (count == 0 || step == 0 || advanceUpTo(windowEnd, end, count) < count) {
+                return true;
+            }
+            
+            while(sink(value_type(windowBegin, windowEnd, count))) {
+                if (advanceUpTo(windowEnd, end, step) < step) {
+                    return true;
+                }
+                
+                advanceUpTo(windowBegin, end, step);
+            }
+            
+            return false;
+        }
+        
+        int sizeHint() const
+        {
+            const size_t size = size_t(FuncHelpUtils::sizeHint(container));
+            return (count && step && size >= count) ? int((size - count) / step + 1) : 0;
+        }
+        
+    private:
+        Storage container;
+        size_t count;
+        size_t step;
+    };
 }
 
-template <class Container,
-          class F,
-          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_callable<F, FuncHelpUtils::iterator_deref<Container> >::value> >
-auto max(const Container &container, const F &func)
- -> FuncHelpUtils::iterator_deref_decay<Container>
+template <class Container>
+auto chunked(Container &&container, size_t count)
+ -> LazyView<FuncHelpUtils::ViewChunks<FuncHelpUtils::view_storage<Container> > >
 {
-    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
-    const ValType *extremumValue = FuncHelpUtils::maxBase(container, func);
-
-    if (extremumValue) {
-        return *extremumValue;
-    } else {
-        return ValType();
-    }
+    using Stage = FuncHelpUtils::ViewChunks<FuncHelpUtils::view_storage<Container> >;
+    return LazyView<Stage>(Stage(std::forward<Container>(container), count));
 }
 
-template <class Container, class F, class ValType>
-ValType max(const Container &container, const F &func, const ValType &defaultVal)
+template <class Container>
+auto windowed(Container &&container, size_t count, size_t step = 1)
+ -> LazyView<FuncHelpUtils::ViewWindows<FuncHelpUtils::view_storage<Container> > >
 {
-    const ValType *extremumValue = FuncHelpUtils::maxBase(container, func);
-
-    if (extremumValue) {
-        return *extremumValue;
-    } else {
-        return defaultVal;
-    }
+    using Stage = FuncHelpUtils::ViewWindows<FuncHelpUtils::view_storage<Container> >;
+    return LazyView<Stage>(Stage(std::forward<Container>(container), count, step));
 }
 
-// reduce
+// map, filter and reject of a Slice return a std::vector, or the container
+// type given.
 
-template <class Container, class F>
-auto reduce(const Container &container, const F &func)
- -> FuncHelpUtils::iterator_deref_decay<Container>
+template <template <class...> class OutContainer = std::vector,
+          class Iterator,
+          bool Contiguous,
+          class F>
+auto map(const Slice<Iterator, Contiguous> &slice, const F &func)
+ -> OutContainer<FuncHelpUtils::func_container_result<Slice<Iterator, Contiguous>, F> >
 {
-    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
-    using V = decltype(container.cbegin());
-    V it = container.cbegin();
-    
-    if (it == container.cend()) {
-        return ValType();
-    }
-    
-    ValType memo = *it;
-    ++it;
-    
-    while(it != container.cend()) {
-        memo = std::ref(func)(ValType(memo), decltype(*it)(*it));
-        ++it;
-    }
-
-    return memo;
+    using OutType = OutContainer<FuncHelpUtils::func_container_result<Slice<Iterator, Contiguous>, F> >;
+    return map<OutType, Slice<Iterator, Contiguous>, F>(slice, func);
 }
 
-template <class Container, class F, class ValType>
-ValType reduce(const Container &container, const F &func, ValType memo)
+template <template <class...> class OutContainer = std::vector,
+          class Iterator,
+          bool Contiguous,
+          class F>
+auto filter(const Slice<Iterator, Contiguous> &slice, const F &predicate)
+ -> OutContainer<typename Slice<Iterator, Contiguous>::value_type>
 {
-    for(auto const &val : container) {
-        memo = std::ref(func)(ValType(memo), decltype(val)(val));
-    }
+    using OutType = OutContainer<typename Slice<Iterator, Contiguous>::value_type>;
+    return filter<Slice<Iterator, Contiguous>, OutType, F>(slice, predicate);
+}
 
-    return memo;
+template <template <class...> class OutContainer = std::vector,
+          class Iterator,
+          bool Contiguous,
+          class F>
+auto reject(const Slice<Iterator, Contiguous> &slice, const F &predicate)
+ -> OutContainer<typename Slice<Iterator, Contiguous>::value_type>
+{
+    using OutType = OutContainer<typename Slice<Iterator, Contiguous>::value_type>;
+    return reject<Slice<Iterator, Contiguous>, OutType, F>(slice, predicate);
 }
 
-// sum
+// Consuming a view
 
-template <class Container, class ValType>
-auto sum(const Container &container, ValType memo)
- -> FuncHelpUtils::iterator_deref_decay<Container>
+template <class Pipeline, class F>
+auto reduce(const LazyView<Pipeline> &view, const F &func)
+ -> typename LazyView<Pipeline>::value_type
 {
-    return reduce(container, [] (const ValType &a, const ValType &b) { return a+b; }, memo);
+    using ValType = typename LazyView<Pipeline>::value_type;
+    ValType memo = ValType();
+    bool isFirst = true;
+    auto sink = [&] (const typename LazyView<Pipeline>::reference &val) {
+        if (isFirst) {
+            memo = val;
+            isFirst = false;
+        } else {
+            memo = std::ref(func)(ValType(memo), val);
+        }
+        return true;
+    };
+    view.forEach(sink);
+    return memo;
 }
 
-template <class Container>
-auto sum(const Container &container)
- -> FuncHelpUtils::iterator_deref_decay<Container>
+template <class Pipeline, class F, class ValType>
+ValType reduce(const LazyView<Pipeline> &view, const F &func, ValType memo)
 {
-    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
-    return reduce(container, [] (const ValType &a, const ValType &b) { return a+b; });
+    using Reference = typename LazyView<Pipeline>::reference;
+    auto sink = [&] (const Reference &val) {
+        memo = std::ref(func)(ValType(memo), val);
+        return true;
+    };
+    view.forEach(sink);
+    return memo;
 }
 
-// sorted
-
-// Since std::sort requires a random access iterator, we have to define
-// different versions of sorted for both std::list and std::forward_list, and
-// any classes derived from them. This is accomplished by using std::enable_if
-// when determining the return type.
-
-// NB: we're using enable_if in the return type since using it as a
-// template argument will cause some of these definitions of sorted to
-// be duplicates.
-
-template <class Container>
-auto sorted(const Container &container)
- -> FuncHelpUtils::enable_if_t<!std::is_base_of<std::list<typename Container::value_type>, Container>::value &&
-                               !std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value, Container>
+template <class Pipeline, class ValType>
+auto sum(const LazyView<Pipeline> &view, ValType memo)
+ -> typename LazyView<Pipeline>::value_type
 {
-    Container result(container);
-    std::sort(result.begin(), result.end());
-    return result;
+    return reduce(view, [] (const ValType &a, const ValType &b) { return a+b; }, memo);
 }
 
-template <class Container, class F>
-auto sorted(const Container &container, const F &comp)
- -> FuncHelpUtils::enable_if_t<!std::is_base_of<std::list<typename Container::value_type>, Container>::value &&
-                               !std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value, Container>
+template <class Pipeline>
+auto sum(const LazyView<Pipeline> &view)
+ -> typename LazyView<Pipeline>::value_type
 {
-    Container result(container);
-    std::sort(result.begin(), result.end(), std::ref(comp));
-    return result;
+    using ValType = typename LazyView<Pipeline>::value_type;
+    return reduce(view, [] (const ValType &a, const ValType &b) { return a+b; });
 }
 
-template <class Container>
-auto sorted(const Container &container)
- -> FuncHelpUtils::enable_if_t<std::is_base_of<std::list<typename Container::value_type>, Container>::value, Container>
+template <class Pipeline, class F>
+bool allOf(const LazyView<Pipeline> &view, const F &f)
 {
-    Container result(container);
-    result.sort();
-    return result;
+    using Reference = typename LazyView<Pipeline>::reference;
+    auto sink = [&f] (const Reference &val) { return bool(std::ref(f)(val)); };
+    return view.forEach(sink);
 }
 
-template <class Container, class F>
-auto sorted(const Container &container, const F &comp)
- -> FuncHelpUtils::enable_if_t<std::is_base_of<std::list<typename Container::value_type>, Container>::value, Container>
+template <class Pipeline, class F>
+bool anyOf(const LazyView<Pipeline> &view, const F &f)
 {
-    Container result(container);
-    result.sort(std::ref(comp));
-    return result;
+    using Reference = typename LazyView<Pipeline>::reference;
+    auto sink = [&f] (const Reference &val) { return !std::ref(f)(val); };
+    return !view.forEach(sink);
 }
 
-template <class Container>
-auto sorted(const Container &container)
- -> FuncHelpUtils::enable_if_t<std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value, Container>
+template <class Pipeline, class ValType>
+auto first(const LazyView<Pipeline> &view, const ValType &defaultValue)
+ -> typename LazyView<Pipeline>::value_type
 {
-    Container result(container);
-    result.sort();
+    using ViewValType = typename LazyView<Pipeline>::value_type;
+    ViewValType result = defaultValue;
+    auto sink = [&result] (const typename LazyView<Pipeline>::reference &val) {
+        result = val;
+        return false;
+    };
+    view.forEach(sink);
     return result;
 }
 
-template <class Container, class F>
-auto sorted(const Container &container, const F &comp)
- -> FuncHelpUtils::enable_if_t<std::is_base_of<std::forward_list<typename Container::value_type>, Container>::value, Container>
+template <class Pipeline>
+auto first(const LazyView<Pipeline> &view)
+ -> typename LazyView<Pipeline>::value_type
 {
-    Container result(container);
-    result.sort(std::ref(comp));
-    return result;
+    return first(view, typename LazyView<Pipeline>::value_type());
 }
 
-// contains
+// map, filter and reject evaluate a view into a std::vector, or the container
+// type given.
 
-template <class Container, class ValType>
-bool contains(const Container &container, const ValType &targetVal)
+template <template <class...> class OutContainer = std::vector,
+          class Pipeline,
+          class F>
+auto map(LazyView<Pipeline> view, const F &func)
+ -> OutContainer<FuncHelpUtils::func_result<const typename LazyView<Pipeline>::reference, F> >
 {
-    for(auto const &val : container) {
-        if (val == targetVal) {
-            return true;
-        }
-    }
-    
-    return false;
+    return (std::move(view) | mapped(func)).template to<OutContainer>();
 }
 
-template <class Container, class Alloc>
-bool contains(const std::set<Container, Alloc> &container, const Container &val)
+template <template <class...> class OutContainer = std::vector,
+          class Pipeline,
+          class F>
+auto filter(LazyView<Pipeline> view, const F &predicate)
+ -> OutContainer<typename LazyView<Pipeline>::value_type>
 {
-    return container.find(val) != container.end();
+    return (std::move(view) | filtered(predicate)).template to<OutContainer>();
 }
 
-// omit
-
-template <template <class...> class InContainer,
-          template <class...> class OutContainer = InContainer,
-          class ValType,
-          class = FuncHelpUtils::enable_if_t<!FuncHelpUtils::has_const_iterator<ValType>::value> >
-auto omit(const InContainer<ValType> &container, const ValType &omitted)
- -> OutContainer<ValType>
+template <template <class...> class OutContainer = std::vector,
+          class Pipeline,
+          class F>
+auto reject(LazyView<Pipeline> view, const F &predicate)
+ -> OutContainer<typename LazyView<Pipeline>::value_type>
 {
-    OutContainer<ValType> result;
+    return (std::move(view) | rejected(predicate)).template to<OutContainer>();
+}
+
+// Lazy range and mapRange
+
+// Without a container type, range and mapRange return lazy ranges that
+// compute each value from its index rather than storing them, so they take
+// the same, small amount of memory however many values they cover. A
+// LazyRange is a random access container of any integral or floating point
+// type, and can be passed to anything that accepts a container. map, filter,
+// reject and compr return a std::vector when given one, since a range can't
+// hold arbitrary values.
+
+namespace FuncHelpUtils {
+    // Integral values are computed with unsigned arithmetic, which wraps
+    // rather than overflowing, so ranges can span all of a 64-bit type.
+    template <class T>
+    T lazyRangeValue(T start, T inc, size_t index, std::true_type)
+    {
+        return T((unsigned long long)start + (unsigned long long)index * (unsigned long long)inc);
+    }
     
-    for(const ValType &val : container) {
-        if (!(val == omitted)) {
-            FuncHelpUtils::addItem(result, val);
+    // Floating point values are computed from start rather than by adding inc
+    // over and over, so rounding errors don't build up.
+    template <class T>
+    T lazyRangeValue(T start, T inc, size_t index, std::false_type)
+    {
+        return T(start + T(index) * inc);
+    }
+    
+    template <class T>
+    bool isNegative(T val, std::true_type)
+    {
+        return val < T(0);
+    }
+    
+    template <class T>
+    bool isNegative(T, std::false_type)
+    {
+        return false;
+    }
+    
+    // inc keeps its own type, since the common type of start, end and inc
+    // may be unsigned even when inc is negative.
+    template <class T, class Inc>
+    size_t lazyRangeSize(T start, T end, Inc inc, std::true_type)
+    {
+        const bool descending = isNegative(inc, std::is_signed<Inc>());
+        
+        if (inc == Inc(0) || (descending ? !(end < start) : !(start < end))) {
+            return 0;
         }
+        
+        const unsigned long long span = descending ? (unsigned long long)start - (unsigned long long)end
+                                                   : (unsigned long long)end - (unsigned long long)start;
+        const unsigned long long step = descending ? 0ULL - (unsigned long long)inc : (unsigned long long)inc;
+        return size_t((span - 1) / step + 1);
     }
     
-    return result;
-}
-
-template <template <class...> class OutContainer,
-          template <class...> class InContainer,
-          class ValType,
-          class = FuncHelpUtils::enable_if_t<!FuncHelpUtils::has_const_iterator<ValType>::value>,
-          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
-auto omit(const InContainer<ValType> &container, const ValType &omitted)
- -> OutContainer<ValType>
-{
-    return omit<InContainer, OutContainer>(container, omitted);
+    template <class T, class Inc>
+    size_t lazyRangeSize(T start, T end, Inc inc, std::false_type)
+    {
+        if (!((inc > Inc(0)) ? (start < end) : (inc < Inc(0) && end < start))) {
+            return 0;
+        }
+        
+        return size_t(std::ceil((end - start) / T(inc)));
+    }
+    
+    template <class... Types>
+    struct are_range_types {
+        enum { value = true };
+    };
+    
+    template <class T, class... Types>
+    struct are_range_types<T, Types...> {
+        enum { value = std::is_arithmetic<T>::value && !std::is_same<T, bool>::value && are_range_types<Types...>::value };
+    };
+    
+    // Whether one of start and end is a signed integer and the other unsigned.
+    template <class T1, class T2>
+    struct mixes_signedness {
+        enum { value = std::is_integral<T1>::value && std::is_integral<T2>::value &&
+                       std::is_signed<T1>::value != std::is_signed<T2>::value };
+    };
+    
+    // The type of the values in range(start, end, inc). That's the common type
+    // of the arguments, except that when start and end mix signed and unsigned
+    // integers it's long long rather than an unsigned type, so that e.g.
+    // range(-1, v.size()) isn't empty.
+    template <class T1, class T2 = T1, class... Inc>
+    using range_type = enable_if_t<are_range_types<T1, T2, Inc...>::value,
+                                   typename std::conditional<mixes_signedness<T1, T2>::value,
+                                                             long long,
+                                                             typename std::common_type<T1, T2, Inc...>::type>::type>;
 }
 
-template <template <class...> class InContainer,
-          template <class...> class OutContainer = InContainer,
-          class ValType,
-          class Container,
-          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_const_iterator<Container>::value> >
-auto omit(const InContainer<ValType> &container, const Container &omitted)
- -> OutContainer<ValType>
-{
-    OutContainer<ValType> result;
+template <class T>
+class LazyRange {
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
     
-    for(const ValType &val : container) {
-        if (!contains(omitted, val)) {
-            FuncHelpUtils::addItem(result, val);
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = T;
+        
+        const_iterator() : start(), inc(), index(0) {}
+        const_iterator(T start, T inc, size_t index) : start(start), inc(inc), index(index) {}
+        
+        T operator*() const { return (*this)[0]; }
+        T operator[](difference_type n) const
+        {
+            return FuncHelpUtils::lazyRangeValue(start, inc, size_t(index + n), std::is_integral<T>());
         }
+        
+        const_iterator &operator++() { ++index; return *this; }
+        const_iterator &operator--() { --index; return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++index; return old; }
+        const_iterator operator--(int) { const_iterator old = *this; --index; return old; }
+        const_iterator &operator+=(difference_type n) { index += n; return *this; }
+        const_iterator &operator-=(difference_type n) { index -= n; return *this; }
+        const_iterator operator+(difference_type n) const { return const_iterator(start, inc, index + n); }
+        const_iterator operator-(difference_type n) const { return const_iterator(start, inc, index - n); }
+        friend const_iterator operator+(difference_type n, const const_iterator &it) { return it + n; }
+        difference_type operator-(const const_iterator &other) const { return difference_type(index - other.index); }
+        
+        bool operator==(const const_iterator &other) const { return index == other.index; }
+        bool operator!=(const const_iterator &other) const { return index != other.index; }
+        bool operator<(const const_iterator &other) const { return index < other.index; }
+        bool operator>(const const_iterator &other) const { return index > other.index; }
+        bool operator<=(const const_iterator &other) const { return index <= other.index; }
+        bool operator>=(const const_iterator &other) const { return index >= other.index; }
+        
+    private:
+        T start;
+        T inc;
+        size_t index;
+    };
+    
+    using iterator = const_iterator;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using reverse_iterator = const_reverse_iterator;
+    
+    template <class Inc>
+    LazyRange(T start, T end, Inc inc)
+     : start(start), inc(T(inc)), count(FuncHelpUtils::lazyRangeSize(start, end, inc, std::is_integral<T>())) {}
+    
+    const_iterator begin() const { return const_iterator(start, inc, 0); }
+    const_iterator end() const { return const_iterator(start, inc, count); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+    const_reverse_iterator crbegin() const { return rbegin(); }
+    const_reverse_iterator crend() const { return rend(); }
+    
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T operator[](size_t index) const { return begin()[difference_type(index)]; }
+    
+    bool operator==(const LazyRange &other) const
+    {
+        return count == other.count && (count == 0 || (start == other.start && (count == 1 || inc == other.inc)));
     }
     
-    return result;
-}
+    bool operator!=(const LazyRange &other) const { return !(*this == other); }
+    
+private:
+    T start;
+    T inc;
+    size_t count;
+};
 
-template <template <class...> class OutContainer,
-          template <class...> class InContainer,
-          class ValType,
-          class Container,
-          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::has_const_iterator<Container>::value>,
-          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
-auto omit(const InContainer<ValType> &container, const Container &omitted)
- -> OutContainer<ValType>
+template <class T1, class T2, class T3>
+auto range(T1 start, T2 end, T3 inc)
+ -> LazyRange<FuncHelpUtils::range_type<T1, T2, T3> >
 {
-    return omit<InContainer, OutContainer>(container, omitted);
+    using T = FuncHelpUtils::range_type<T1, T2, T3>;
+    return LazyRange<T>(T(start), T(end), inc);
 }
 
-// reversed
+// The increment is given in the range's own type, since an int would widen
+// the values of e.g. range(short(0), short(5)) to int.
 
-template <class Container>
-Container reversed(const Container &container)
+template <class T1, class T2>
+auto range(T1 start, T2 end)
+ -> LazyRange<FuncHelpUtils::range_type<T1, T2> >
 {
-    Container result;
-    
-    for(auto it = container.rbegin(); it != container.rend(); ++it) {
-        FuncHelpUtils::addItem(result, *it);
-    }
-    
-    return result;
+    return range(start, end, FuncHelpUtils::range_type<T1, T2>(1));
 }
 
-// first
-
-template <class Container>
-auto first(const Container &container)
- -> FuncHelpUtils::iterator_deref_decay<Container>
+template <class T>
+auto range(T end)
+ -> LazyRange<FuncHelpUtils::range_type<T> >
 {
-    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
-    
-    if (container.size() == 0) {
-        return ValType();
-    } else {
-        return *(container.cbegin());
-    }
+    return range(T(0), end, T(1));
 }
 
-template <class Container, class ValType>
-auto first(const Container &container, const ValType &defaultValue)
- -> FuncHelpUtils::iterator_deref_decay<Container>
+// A lazy view of func applied to each value in range(start, end, inc), and
+// only to the ones that predicate returns true for if there is one.
+
+template <class T1, class T2, class T3, class F,
+          class = FuncHelpUtils::range_type<T1, T2, T3> >
+auto mapRange(T1 start, T2 end, T3 inc, F func)
+ -> decltype(view(range(start, end, inc)) | mapped(func))
 {
-    if (container.size() == 0) {
-        return defaultValue;
-    } else {
-        return *(container.cbegin());
-    }
+    return view(range(start, end, inc)) | mapped(func);
 }
 
-// last
-
-template <class Container>
-auto last(const Container &container)
- -> FuncHelpUtils::reverse_iterator_deref_decay<Container>
+template <class T1, class T2, class T3, class F1, class F2,
+          class = FuncHelpUtils::range_type<T1, T2, T3> >
+auto mapRange(T1 start, T2 end, T3 inc, F1 func, F2 predicate)
+ -> decltype(view(range(start, end, inc)) | filtered(predicate) | mapped(func))
 {
-    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
-    
-    if (container.size() == 0) {
-        return ValType();
-    } else {
-        return *(container.crbegin());
-    }
+    return view(range(start, end, inc)) | filtered(predicate) | mapped(func);
 }
 
-template <class Container, class ValType>
-auto last(const Container &container, const ValType &defaultValue)
- -> FuncHelpUtils::reverse_iterator_deref_decay<Container>
+template <class T1, class T2, class F,
+          class = FuncHelpUtils::range_type<T1, T2>,
+          class = FuncHelpUtils::enable_if_t<!std::is_arithmetic<F>::value> >
+auto mapRange(T1 start, T2 end, F func)
+ -> decltype(mapRange(start, end, FuncHelpUtils::range_type<T1, T2>(1), func))
 {
-    if (container.size() == 0) {
-        return defaultValue;
-    } else {
-        return *(container.crbegin());
-    }
+    return mapRange(start, end, FuncHelpUtils::range_type<T1, T2>(1), func);
 }
 
-// range
-
-template <template <class...> class OutContainer>
-auto range(int start, int end, int inc=1)
- -> OutContainer<int>
+template <class T1, class T2, class F1, class F2,
+          class = FuncHelpUtils::range_type<T1, T2>,
+          class = FuncHelpUtils::enable_if_t<!std::is_arithmetic<F1>::value> >
+auto mapRange(T1 start, T2 end, F1 func, F2 predicate)
+ -> decltype(mapRange(start, end, FuncHelpUtils::range_type<T1, T2>(1), func, predicate))
 {
-    OutContainer<int> result;
-    int sign = (inc < 0) ? -1 : 1;
-    
-    for(int i = start; (i*sign) < (end*sign); i += inc) {
-        FuncHelpUtils::addItem(result, i);
-    }
-    
-    return result;
+    return mapRange(start, end, FuncHelpUtils::range_type<T1, T2>(1), func, predicate);
 }
 
-template <template <class...> class OutContainer>
-auto range(int end)
- -> OutContainer<int>
+template <class T, class F,
+          class = FuncHelpUtils::range_type<T>,
+          class = FuncHelpUtils::enable_if_t<!std::is_arithmetic<F>::value> >
+auto mapRange(T end, F func)
+ -> decltype(mapRange(T(0), end, T(1), func))
 {
-    return range<OutContainer>(0, end);
+    return mapRange(T(0), end, T(1), func);
 }
 
-// mapRange
-
-
-template <template <class...> class OutContainer,
-          class F>
-auto mapRange(int start, int end, int inc, F func)
- -> OutContainer<FuncHelpUtils::func_result<int, F> >
+template <class T, class F1, class F2,
+          class = FuncHelpUtils::range_type<T>,
+          class = FuncHelpUtils::enable_if_t<!std::is_arithmetic<F1>::value> >
+auto mapRange(T end, F1 func, F2 predicate)
+ -> decltype(mapRange(T(0), end, T(1), func, predicate))
 {
-    using ValType = FuncHelpUtils::func_result<int, F>;
-    OutContainer<ValType> result;
-    int sign = (inc < 0) ? -1 : 1;
-    
-    for(int i = start; (i*sign) < (end*sign); i += inc) {
-        FuncHelpUtils::addItem(result, std::ref(func)(i));
-    }
-    
-    return result;
+    return mapRange(T(0), end, T(1), func, predicate);
 }
 
-template <template <class...> class OutContainer,
-          class F1,
-          class F2>
-auto mapRange(int start, int end, int inc, F1 func, F2 predicate)
- -> OutContainer<FuncHelpUtils::func_result<int, F1> >
-{
-    using ValType = FuncHelpUtils::func_result<int, F1>;
-    OutContainer<ValType> result;
-    int sign = (inc < 0) ? -1 : 1;
-    
-    for(int i = start; (i*sign) < (end*sign); i += inc) {
-        if (std::ref(predicate)(i)) {
-            FuncHelpUtils::addItem(result, std::ref(func)(i));
+// map, filter, reject and compr of lazy ranges. These take the range by value
+// so that they're picked over the versions for temporary containers, which
+// would try to reuse the range's storage. filter, reject and compr don't
+// reserve space for every value in the range, since that could be far more
+// than are kept.
+
+namespace FuncHelpUtils {
+    template <class OutType, class T, class F1, class F2>
+    void appendLazyRange(OutType &result, const LazyRange<T> &range, const F1 &func, const F2 &predicate)
+    {
+        for(auto it = range.begin(), end = range.end(); it != end; ++it) {
+            const T val = *it;
+            
+            if (std::ref(predicate)(val)) {
+                FuncHelpUtils::addItem(result, std::ref(func)(val));
+            }
         }
     }
     
-    return result;
+    template <class T>
+    struct Identity {
+        const T &operator()(const T &val) const { return val; }
+    };
+    
+    template <class F>
+    struct Not {
+        const F &predicate;
+        
+        template <class T>
+        bool operator()(const T &val) const { return !std::ref(predicate)(val); }
+    };
 }
 
-template <template <class...> class OutContainer,
+template <template <class...> class OutContainer = std::vector,
+          class T,
           class F>
-auto mapRange(int start, int end, F func)
--> OutContainer<FuncHelpUtils::func_result<int, F> >
+auto map(LazyRange<T> range, const F &func)
+ -> OutContainer<FuncHelpUtils::func_result<const T, F> >
 {
-    return mapRange<OutContainer>(start, end, 1, func);
+    return map<OutContainer<FuncHelpUtils::func_result<const T, F> >, LazyRange<T>, F>(range, func);
 }
 
-template <template <class...> class OutContainer,
+template <template <class...> class OutContainer = std::vector,
+          class T,
           class F1,
           class F2>
-auto mapRange(int start, int end, F1 func, F2 predicate)
- -> OutContainer<FuncHelpUtils::func_result<int, F1> >
+auto compr(LazyRange<T> range, const F1 &func, const F2 &predicate)
+ -> OutContainer<FuncHelpUtils::func_result<const T, F1> >
 {
-    return mapRange<OutContainer>(start, end, 1, func, predicate);
+    OutContainer<FuncHelpUtils::func_result<const T, F1> > result;
+    FuncHelpUtils::appendLazyRange(result, range, func, predicate);
+    return result;
 }
 
-template <template <class...> class OutContainer,
+template <template <class...> class OutContainer = std::vector,
+          class T,
           class F>
-auto mapRange(int end, F func)
--> OutContainer<FuncHelpUtils::func_result<int, F> >
-{
-    return mapRange<OutContainer>(0, end, 1, func);
-}
-
-template <template <class...> class OutContainer,
-          class F1,
-          class F2>
-auto mapRange(int end, F1 func, F2 predicate)
- -> OutContainer<FuncHelpUtils::func_result<int, F1> >
+auto filter(LazyRange<T> range, const F &predicate)
+ -> OutContainer<T>
 {
-    return mapRange<OutContainer>(0, end, 1, func, predicate);
+    OutContainer<T> result;
+    FuncHelpUtils::appendLazyRange(result, range, FuncHelpUtils::Identity<T>(), predicate);
+    return result;
 }
 
-// flatten
-
-template <template <class...> class NestedContainer,
-          template <class...> class InContainer,
-          template <class...> class OutContainer = NestedContainer,
-          class ValType>
-auto flatten(const InContainer< NestedContainer<ValType> > &container)
- -> OutContainer<ValType>
+template <template <class...> class OutContainer = std::vector,
+          class T,
+          class F>
+auto reject(LazyRange<T> range, const F &predicate)
+ -> OutContainer<T>
 {
-    OutContainer<ValType> result;
-    
-    for(auto const &nested : container) {
-        for(auto const &val : nested) {
-            FuncHelpUtils::addItem(result, val);
-        }
-    }
-    
+    OutContainer<T> result;
+    FuncHelpUtils::appendLazyRange(result, range, FuncHelpUtils::Identity<T>(), FuncHelpUtils::Not<F>{predicate});
     return result;
 }
 
-template <template <class...> class OutContainer,
-          template <class...> class InContainer,
-          template <class...> class NestedContainer,
-          class ValType,
-          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, NestedContainer<int> >::value> >
-auto flatten(const InContainer<NestedContainer<ValType> > &container)
- -> OutContainer<ValType>
+template <template <class...> class OutContainer = std::vector,
+          class T,
+          class F>
+auto groupBy(LazyRange<T> range, const F &key)
+ -> FuncHelpUtils::grouped_map<LazyRange<T>, F, OutContainer<T> >
 {
-    return flatten<NestedContainer, InContainer, OutContainer>(container);
+    FuncHelpUtils::grouped_map<LazyRange<T>, F, OutContainer<T> > result;
+    FuncHelpUtils::reserveSize(result, FuncHelpUtils::sizeHint(range));
+    FuncHelpUtils::appendGroups(result, range.begin(), range.end(), key);
+    return result;
 }
 
 #endif // FUNCTIONAL_HELPERS_H_GUARD
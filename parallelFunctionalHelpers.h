@@ -0,0 +1,1223 @@
+// parallelFunctionalHelpers.h
+
+// Parallel versions of some of the functions in functionalHelpers.h. Each one
+// takes an execution policy as its first argument, e.g.
+//
+//     map(par, container, callable)
+//
+// and otherwise behaves like the function of the same name, returning the same
+// result. Containers with random access iterators are split into chunks that
+// are processed on a shared thread pool; any other kind of container is
+// processed serially.
+//
+// Callables passed to these functions are called from several threads at
+// once, so they must be safe to call concurrently.
+//
+// If using Qt, include qtFunctionalHelpers.h before this file.
+
+#ifndef PARALLEL_FUNCTIONAL_HELPERS_H_GUARD
+#define PARALLEL_FUNCTIONAL_HELPERS_H_GUARD
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <functionalHelpers.h>
+
+// Execution policies
+
+// ordered: whether results must come out in the same order as the serial
+//          version. Only filter, reject and compr can make use of this being
+//          false.
+// threadCount: maximum number of threads to use, or 0 to use every thread in
+//              the pool.
+// minChunkSize: containers are never split into chunks smaller than this,
+//               so small containers are processed serially.
+struct ParallelPolicy {
+    explicit ParallelPolicy(bool ordered=true, int threadCount=0, int minChunkSize=1024)
+        : ordered(ordered), threadCount(threadCount), minChunkSize(minChunkSize) {}
+    
+    ParallelPolicy withThreads(int count) const
+    {
+        return ParallelPolicy(ordered, count, minChunkSize);
+    }
+    
+    ParallelPolicy withMinChunkSize(int size) const
+    {
+        return ParallelPolicy(ordered, threadCount, size);
+    }
+    
+    bool ordered;
+    int threadCount;
+    int minChunkSize;
+};
+
+const ParallelPolicy par;
+const ParallelPolicy parUnordered(false);
+
+namespace FuncHelpUtils {
+    // A fixed set of worker threads that is shared by all of the parallel
+    // functions. run() blocks until every task is done, and the calling
+    // thread works on tasks too. If run() is called from inside a task, or
+    // while another thread is already using the pool, the tasks are run
+    // serially on the calling thread instead.
+    class ThreadPool {
+    public:
+        static ThreadPool &instance()
+        {
+            static ThreadPool pool(std::thread::hardware_concurrency());
+            return pool;
+        }
+        
+        explicit ThreadPool(unsigned threadCount)
+            : stopping(false), generation(0), activeWorkers(0), currentJob(nullptr)
+        {
+            for(unsigned i = 1; i < threadCount; ++i) {
+                workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+            }
+        }
+        
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            
+            wakeCondition.notify_all();
+            
+            for(auto &worker : workers) {
+                worker.join();
+            }
+        }
+        
+        // The number of threads that run() can make use of, including the
+        // calling thread.
+        int threadCount() const
+        {
+            return int(workers.size()) + 1;
+        }
+        
+        // Calls task(i) for every i in [0, count)
+        template <class F>
+        void run(int count, const F &task)
+        {
+            // A task running on the calling thread already holds runMutex, so
+            // it's only tried by threads that aren't running any tasks.
+            const bool nested = isWorkerThread() || isInsideRun();
+            std::unique_lock<std::mutex> runLock;
+            
+            if (!nested) {
+                runLock = std::unique_lock<std::mutex>(runMutex, std::try_to_lock);
+            }
+            
+            if (!runLock.owns_lock() || workers.empty() || count <= 1) {
+                for(int i = 0; i < count; ++i) {
+                    task(i);
+                }
+                return;
+            }
+            
+            Job job(count, task);
+            
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                currentJob = &job;
+                ++generation;
+            }
+            
+            wakeCondition.notify_all();
+            isInsideRun() = true;
+            job.work();
+            isInsideRun() = false;
+            
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                doneCondition.wait(lock, [&job, this] { return job.completed == job.count && activeWorkers == 0; });
+                currentJob = nullptr;
+            }
+            
+            if (job.error) {
+                std::rethrow_exception(job.error);
+            }
+        }
+    
+    private:
+        struct Job {
+            Job(int count, std::function<void(int)> task)
+                : count(count), task(std::move(task)), next(0), completed(0) {}
+            
+            void work()
+            {
+                for(int i = next++; i < count; i = next++) {
+                    try {
+                        task(i);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(errorMutex);
+                        
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                    
+                    ++completed;
+                }
+            }
+            
+            const int count;
+            std::function<void(int)> task;
+            std::atomic<int> next;
+            std::atomic<int> completed;
+            std::mutex errorMutex;
+            std::exception_ptr error;
+        };
+        
+        static bool &isWorkerThread()
+        {
+            static thread_local bool result = false;
+            return result;
+        }
+        
+        // Whether this thread is working on the tasks of a run() it called.
+        static bool &isInsideRun()
+        {
+            static thread_local bool result = false;
+            return result;
+        }
+        
+        void workerLoop()
+        {
+            isWorkerThread() = true;
+            unsigned seenGeneration = 0;
+            std::unique_lock<std::mutex> lock(mutex);
+            
+            while(true) {
+                wakeCondition.wait(lock, [&seenGeneration, this] { return stopping || generation != seenGeneration; });
+                
+                if (stopping) {
+                    return;
+                }
+                
+                seenGeneration = generation;
+                
+                if (!currentJob) {
+                    continue;
+                }
+                
+                Job *job = currentJob;
+                ++activeWorkers;
+                lock.unlock();
+                job->work();
+                lock.lock();
+                --activeWorkers;
+                doneCondition.notify_all();
+            }
+        }
+        
+        std::vector<std::thread> workers;
+        std::mutex runMutex;
+        std::mutex mutex;
+        std::condition_variable wakeCondition;
+        std::condition_variable doneCondition;
+        bool stopping;
+        unsigned generation;
+        int activeWorkers;
+        Job *currentJob;
+    };
+    
+    // The number of chunks to split size items into under policy. 1 means the
+    // work should be done serially.
+    inline int chunkCount(const ParallelPolicy &policy, size_t size, int chunksPerThread)
+    {
+        int threads = ThreadPool::instance().threadCount();
+        
+        if (policy.threadCount > 0 && policy.threadCount < threads) {
+            threads = policy.threadCount;
+        }
+        
+        size_t maxChunks = size / size_t(std::max(policy.minChunkSize, 1));
+        size_t chunks = size_t(threads) * size_t(chunksPerThread);
+        
+        if (threads <= 1 || maxChunks <= 1) {
+            return 1;
+        }
+        
+        return int(std::min(chunks, maxChunks));
+    }
+    
+    // Moves each item of items onto the end of result
+    template <class OutContainer, class ValType>
+    void moveAllItems(OutContainer &result, std::vector<ValType> &items)
+    {
+        for(auto it = items.begin(); it != items.end(); ++it) {
+            FuncHelpUtils::moveItem(result, std::move(*it));
+        }
+    }
+    
+    // Splits container into chunks and passes each one to
+    // chunkFunc(begin, end, output), where output is a std::vector that
+    // chunkFunc appends its results to. The outputs are then combined into an
+    // OutContainer, in order if policy.ordered is true, otherwise in whatever
+    // order the chunks finish. serialFunc() is called instead when the
+    // container is too small to split up or doesn't have random access
+    // iterators.
+    template <class OutContainer, class InContainer, class ChunkFunc, class SerialFunc>
+    OutContainer parallelCollect(const ParallelPolicy &policy, const InContainer &container,
+                                 const ChunkFunc &chunkFunc, const SerialFunc &serialFunc, std::true_type)
+    {
+        using ValType = typename OutContainer::value_type;
+        const size_t size = container.size();
+        const int chunks = chunkCount(policy, size, policy.ordered ? 4 : 16);
+        
+        if (chunks <= 1) {
+            return serialFunc();
+        }
+        
+        auto begin = container.begin();
+        OutContainer result;
+        
+        if (policy.ordered) {
+            std::vector<std::vector<ValType> > outputs(chunks);
+            
+            ThreadPool::instance().run(chunks, [&] (int i) {
+                size_t first = size * size_t(i) / size_t(chunks);
+                size_t last = size * size_t(i + 1) / size_t(chunks);
+                outputs[i].reserve(last - first);
+                chunkFunc(begin + first, begin + last, outputs[i]);
+            });
+            
+            size_t total = 0;
+            
+            for(auto const &output : outputs) {
+                total += output.size();
+            }
+            
+            FuncHelpUtils::reserveSize(result, int(total));
+            
+            for(auto &output : outputs) {
+                moveAllItems(result, output);
+            }
+        } else {
+            std::mutex resultMutex;
+            FuncHelpUtils::reserveUpTo(result, int(size));
+            
+            ThreadPool::instance().run(chunks, [&] (int i) {
+                size_t first = size * size_t(i) / size_t(chunks);
+                size_t last = size * size_t(i + 1) / size_t(chunks);
+                std::vector<ValType> output;
+                output.reserve(last - first);
+                chunkFunc(begin + first, begin + last, output);
+                
+                std::lock_guard<std::mutex> lock(resultMutex);
+                moveAllItems(result, output);
+            });
+        }
+        
+        return result;
+    }
+    
+    template <class OutContainer, class InContainer, class ChunkFunc, class SerialFunc>
+    OutContainer parallelCollect(const ParallelPolicy &policy, const InContainer &container,
+                                 const ChunkFunc &chunkFunc, const SerialFunc &serialFunc, std::false_type)
+    {
+        (void)policy;
+        (void)container;
+        (void)chunkFunc;
+        return serialFunc();
+    }
+    
+    template <class OutContainer, class InContainer, class ChunkFunc, class SerialFunc>
+    OutContainer parallelCollect(const ParallelPolicy &policy, const InContainer &container,
+                                 const ChunkFunc &chunkFunc, const SerialFunc &serialFunc)
+    {
+        return parallelCollect<OutContainer>(policy, container, chunkFunc, serialFunc,
+                                             std::integral_constant<bool, is_random_access<InContainer>::value>());
+    }
+}
+
+// map
+
+template <class OutType,
+          class InType,
+          class F>
+OutType map(const ParallelPolicy &policy, const InType &container, const F &func)
+{
+    using Iterator = decltype(container.begin());
+    using ValType = typename OutType::value_type;
+    
+    // Every value is kept, so the results always come out in order.
+    const ParallelPolicy ordered(true, policy.threadCount, policy.minChunkSize);
+    
+    return FuncHelpUtils::parallelCollect<OutType>(ordered, container,
+        [&func] (Iterator begin, Iterator end, std::vector<ValType> &output) {
+            for(auto it = begin; it != end; ++it) {
+                auto const &val = *it;
+                output.push_back(std::ref(func)(decltype(val)(val)));
+            }
+        },
+        [&container, &func] { return map<OutType, InType>(container, func); });
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class InType,
+          class F>
+auto map(const ParallelPolicy &policy, const InContainer<InType> &container, const F &func)
+ -> OutContainer<FuncHelpUtils::func_container_result<InContainer<InType>, F> >
+{
+    using OutType = FuncHelpUtils::func_container_result<InContainer<InType>, F>;
+    return map<OutContainer<OutType>, InContainer<InType> >(policy, container, func);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class InType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto map(const ParallelPolicy &policy, const InContainer<InType> &container, const F &func)
+ -> OutContainer<FuncHelpUtils::func_container_result<InContainer<InType>, F> >
+{
+    return map<InContainer, OutContainer>(policy, container, func);
+}
+
+// compr
+
+template <class OutType,
+          class InType,
+          class F1,
+          class F2>
+OutType compr(const ParallelPolicy &policy, const InType &container, const F1 &func, const F2 &predicate)
+{
+    using Iterator = decltype(container.begin());
+    using ValType = typename OutType::value_type;
+    
+    return FuncHelpUtils::parallelCollect<OutType>(policy, container,
+        [&func, &predicate] (Iterator begin, Iterator end, std::vector<ValType> &output) {
+            for(auto it = begin; it != end; ++it) {
+                auto const &val = *it;
+                
+                if (std::ref(predicate)(decltype(val)(val))) {
+                    output.push_back(std::ref(func)(decltype(val)(val)));
+                }
+            }
+        },
+        [&container, &func, &predicate] { return compr<OutType, InType>(container, func, predicate); });
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class InType,
+          class F1,
+          class F2>
+auto compr(const ParallelPolicy &policy, const InContainer<InType> &container, const F1 &func, const F2 &predicate)
+ -> OutContainer<FuncHelpUtils::func_container_result<InContainer<InType>, F1> >
+{
+    using OutType = FuncHelpUtils::func_container_result<InContainer<InType>, F1>;
+    return compr<OutContainer<OutType>, InContainer<InType> >(policy, container, func, predicate);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class InType,
+          class F1,
+          class F2,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto compr(const ParallelPolicy &policy, const InContainer<InType> &container, const F1 &func, const F2 &predicate)
+ -> OutContainer<FuncHelpUtils::func_container_result<InContainer<InType>, F1> >
+{
+    return compr<InContainer, OutContainer>(policy, container, func, predicate);
+}
+
+// filter
+
+namespace FuncHelpUtils {
+    // Keep is true for filter and false for reject.
+    template <bool Keep, class InContainer, class OutContainer, class F>
+    OutContainer parallelFilter(const ParallelPolicy &policy, const InContainer &container, const F &predicate)
+    {
+        using Iterator = decltype(container.begin());
+        using ValType = typename OutContainer::value_type;
+        
+        return parallelCollect<OutContainer>(policy, container,
+            [&predicate] (Iterator begin, Iterator end, std::vector<ValType> &output) {
+                for(auto it = begin; it != end; ++it) {
+                    auto const &val = *it;
+                    
+                    if (bool(std::ref(predicate)(decltype(val)(val))) == Keep) {
+                        output.push_back(val);
+                    }
+                }
+            },
+            [&container, &predicate] {
+                return Keep ? filter<InContainer, OutContainer>(container, predicate)
+                            : reject<InContainer, OutContainer>(container, predicate);
+            });
+    }
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class F>
+auto filter(const ParallelPolicy &policy, const InContainer<ValType> &container, const F &predicate)
+ -> OutContainer<ValType>
+{
+    return FuncHelpUtils::parallelFilter<true, InContainer<ValType>, OutContainer<ValType> >(policy, container, predicate);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto filter(const ParallelPolicy &policy, const InContainer<ValType> &container, const F &predicate)
+ -> OutContainer<ValType>
+{
+    return filter<InContainer, OutContainer>(policy, container, predicate);
+}
+
+// reject
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class F>
+auto reject(const ParallelPolicy &policy, const InContainer<ValType> &container, const F &predicate)
+ -> OutContainer<ValType>
+{
+    return FuncHelpUtils::parallelFilter<false, InContainer<ValType>, OutContainer<ValType> >(policy, container, predicate);
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto reject(const ParallelPolicy &policy, const InContainer<ValType> &container, const F &predicate)
+ -> OutContainer<ValType>
+{
+    return reject<InContainer, OutContainer>(policy, container, predicate);
+}
+
+// groupBy, countBy and keyBy
+
+// Each chunk of the container is grouped into its own shard map, and the
+// shards are then merged into the first one in order, so the result is
+// exactly what the serial version returns.
+
+namespace FuncHelpUtils {
+    // The key and value of a hash map entry, for both std::unordered_map and
+    // QHash iterators.
+    template <class Iterator>
+    auto entryKey(const Iterator &it, int) -> decltype(it.key())
+    {
+        return it.key();
+    }
+    
+    template <class Iterator, class = typename std::iterator_traits<Iterator>::value_type::first_type>
+    auto entryKey(const Iterator &it, long) -> decltype((it->first))
+    {
+        return it->first;
+    }
+    
+    template <class Iterator>
+    auto entryValue(const Iterator &it, int) -> decltype(it.value())
+    {
+        return it.value();
+    }
+    
+    template <class Iterator, class = typename std::iterator_traits<Iterator>::value_type::first_type>
+    auto entryValue(const Iterator &it, long) -> decltype((it->second))
+    {
+        return it->second;
+    }
+    
+    // Calls appendChunk(shard, begin, end) for each chunk of container, then
+    // mergeShard(result, shard) for each shard after the first.
+    template <class Map, class InContainer, class AppendChunk, class MergeShard>
+    Map parallelGroup(const ParallelPolicy &policy, const InContainer &container,
+                      const AppendChunk &appendChunk, const MergeShard &mergeShard, std::true_type)
+    {
+        const size_t size = container.size();
+        const int chunks = chunkCount(policy, size, 1);
+        auto begin = container.begin();
+        std::vector<Map> shards(chunks);
+        
+        ThreadPool::instance().run(chunks, [&] (int i) {
+            size_t first = size * size_t(i) / size_t(chunks);
+            size_t last = size * size_t(i + 1) / size_t(chunks);
+            FuncHelpUtils::reserveSize(shards[i], int(last - first));
+            appendChunk(shards[i], begin + first, begin + last);
+        });
+        
+        Map result = std::move(shards[0]);
+        
+        for(int i = 1; i < chunks; ++i) {
+            mergeShard(result, shards[i]);
+        }
+        
+        return result;
+    }
+    
+    template <class Map, class InContainer, class AppendChunk, class MergeShard>
+    Map parallelGroup(const ParallelPolicy &policy, const InContainer &container,
+                      const AppendChunk &appendChunk, const MergeShard &mergeShard, std::false_type)
+    {
+        (void)policy;
+        (void)mergeShard;
+        Map result;
+        FuncHelpUtils::reserveSize(result, sizeHint(container));
+        appendChunk(result, container.begin(), container.end());
+        return result;
+    }
+    
+    template <class Map, class InContainer, class AppendChunk, class MergeShard>
+    Map parallelGroup(const ParallelPolicy &policy, const InContainer &container,
+                      const AppendChunk &appendChunk, const MergeShard &mergeShard)
+    {
+        return parallelGroup<Map>(policy, container, appendChunk, mergeShard,
+                                  std::integral_constant<bool, is_random_access<InContainer>::value>());
+    }
+}
+
+template <template <class...> class InContainer,
+          template <class...> class OutContainer = InContainer,
+          class ValType,
+          class F>
+auto groupBy(const ParallelPolicy &policy, const InContainer<ValType> &container, const F &key)
+ -> FuncHelpUtils::grouped_map<InContainer<ValType>, F, OutContainer<ValType> >
+{
+    using Map = FuncHelpUtils::grouped_map<InContainer<ValType>, F, OutContainer<ValType> >;
+    using Iterator = decltype(container.begin());
+    
+    return FuncHelpUtils::parallelGroup<Map>(policy, container,
+        [&key] (Map &shard, Iterator begin, Iterator end) {
+            FuncHelpUtils::appendGroups(shard, begin, end, key);
+        },
+        [] (Map &result, Map &shard) {
+            for(auto it = shard.begin(); it != shard.end(); ++it) {
+                auto &group = FuncHelpUtils::entryValue(it, 0);
+                auto &target = result[FuncHelpUtils::entryKey(it, 0)];
+                
+                if (target.empty()) {
+                    target = std::move(group);
+                } else {
+                    FuncHelpUtils::addItems(target, std::make_move_iterator(group.begin()), std::make_move_iterator(group.end()));
+                }
+            }
+        });
+}
+
+template <template <class...> class OutContainer,
+          template <class...> class InContainer,
+          class ValType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<!std::is_same<OutContainer<int>, InContainer<int> >::value> >
+auto groupBy(const ParallelPolicy &policy, const InContainer<ValType> &container, const F &key)
+ -> FuncHelpUtils::grouped_map<InContainer<ValType>, F, OutContainer<ValType> >
+{
+    return groupBy<InContainer, OutContainer>(policy, container, key);
+}
+
+template <class Container, class F>
+auto countBy(const ParallelPolicy &policy, const Container &container, const F &key)
+ -> FuncHelpUtils::grouped_map<Container, F, size_t>
+{
+    using Map = FuncHelpUtils::grouped_map<Container, F, size_t>;
+    using Iterator = decltype(container.begin());
+    
+    return FuncHelpUtils::parallelGroup<Map>(policy, container,
+        [&key] (Map &shard, Iterator begin, Iterator end) {
+            FuncHelpUtils::appendCounts(shard, begin, end, key);
+        },
+        [] (Map &result, Map &shard) {
+            for(auto it = shard.begin(); it != shard.end(); ++it) {
+                result[FuncHelpUtils::entryKey(it, 0)] += FuncHelpUtils::entryValue(it, 0);
+            }
+        });
+}
+
+template <class Container, class F>
+auto keyBy(const ParallelPolicy &policy, const Container &container, const F &key)
+ -> FuncHelpUtils::grouped_map<Container, F, FuncHelpUtils::iterator_deref_decay<Container> >
+{
+    using Map = FuncHelpUtils::grouped_map<Container, F, FuncHelpUtils::iterator_deref_decay<Container> >;
+    using Iterator = decltype(container.begin());
+    
+    return FuncHelpUtils::parallelGroup<Map>(policy, container,
+        [&key] (Map &shard, Iterator begin, Iterator end) {
+            FuncHelpUtils::appendKeyed(shard, begin, end, key);
+        },
+        [] (Map &result, Map &shard) {
+            for(auto it = shard.begin(); it != shard.end(); ++it) {
+                FuncHelpUtils::setItem(result, FuncHelpUtils::entryKey(it, 0), std::move(FuncHelpUtils::entryValue(it, 0)));
+            }
+        });
+}
+
+// reduce, sum, extremum, min and max
+
+// These split the container into blocks of ReduceBlockSize values, reduce
+// each block from left to right, and then combine the blocks' results
+// pairwise in a tree: blocks 0 and 1, 2 and 3, and so on, then the results of
+// those, until one is left. Blocks are handed out to threads in groups, but
+// the blocks themselves and the shape of the tree only depend on how many
+// values there are, so the result is the same no matter how many threads
+// there are. That includes floating point sums, which are bit-identical
+// across machines with different core counts. (Arithmetic values in
+// contiguous containers are summed in vectorized lanes within each block, so
+// a list can still give a different sum than a vector of the same values.)
+//
+// func must be associative, since the values aren't folded strictly in order.
+// Floating point addition isn't quite, so sum(par, container) can differ
+// slightly from sum(container) once there are more than ReduceBlockSize
+// values. extremum, min and max return exactly what the serial versions do.
+
+namespace FuncHelpUtils {
+    enum { ReduceBlockSize = 4096 };
+    
+    template <class Result, class Combine>
+    Result combineTree(std::vector<Result> &results, const Combine &combine)
+    {
+        size_t count = results.size();
+        
+        while(count > 1) {
+            const size_t half = count / 2;
+            
+            for(size_t i = 0; i < half; ++i) {
+                results[i] = combine(results[2*i], results[2*i + 1]);
+            }
+            
+            if (count % 2) {
+                results[half] = results[count - 1];
+            }
+            
+            count = half + count % 2;
+        }
+        
+        return results[0];
+    }
+    
+    // blockFunc(begin, end) reduces one non-empty block. Returns empty if
+    // container is.
+    template <class Result, class Container, class BlockFunc, class Combine>
+    Result blockReduce(const ParallelPolicy &policy, const Container &container, const BlockFunc &blockFunc,
+                       const Combine &combine, const Result &empty, std::true_type)
+    {
+        const size_t size = container.size();
+        const size_t blocks = (size + ReduceBlockSize - 1) / ReduceBlockSize;
+        
+        if (blocks == 0) {
+            return empty;
+        } else if (blocks == 1) {
+            return blockFunc(container.begin(), container.end());
+        }
+        
+        const int chunks = std::min(chunkCount(policy, size, 4), int(blocks));
+        auto begin = container.begin();
+        std::vector<Result> results(blocks, empty);
+        
+        ThreadPool::instance().run(chunks, [&] (int i) {
+            const size_t firstBlock = blocks * size_t(i) / size_t(chunks);
+            const size_t lastBlock = blocks * size_t(i + 1) / size_t(chunks);
+            
+            for(size_t block = firstBlock; block < lastBlock; ++block) {
+                const size_t first = block * ReduceBlockSize;
+                const size_t last = std::min(first + ReduceBlockSize, size);
+                results[block] = blockFunc(begin + first, begin + last);
+            }
+        });
+        
+        return combineTree(results, combine);
+    }
+    
+    template <class Result, class Container, class BlockFunc, class Combine>
+    Result blockReduce(const ParallelPolicy &policy, const Container &container, const BlockFunc &blockFunc,
+                       const Combine &combine, const Result &empty, std::false_type)
+    {
+        (void)policy;
+        std::vector<Result> results;
+        auto it = container.begin();
+        const auto end = container.end();
+        
+        while(it != end) {
+            auto blockEnd = it;
+            
+            for(int i = 0; i < ReduceBlockSize && blockEnd != end; ++i) {
+                ++blockEnd;
+            }
+            
+            results.push_back(blockFunc(it, blockEnd));
+            it = blockEnd;
+        }
+        
+        return results.empty() ? empty : combineTree(results, combine);
+    }
+    
+    template <class Result, class Container, class BlockFunc, class Combine>
+    Result blockReduce(const ParallelPolicy &policy, const Container &container, const BlockFunc &blockFunc,
+                       const Combine &combine, const Result &empty)
+    {
+        return blockReduce(policy, container, blockFunc, combine, empty,
+                           std::integral_constant<bool, is_random_access<Container>::value>());
+    }
+    
+    template <class Container>
+    using iterator_of = decltype(std::declval<const Container &>().begin());
+    
+    template <class Container>
+    auto parallelSumBase(const ParallelPolicy &policy, const Container &container, std::false_type)
+     -> iterator_deref_decay<Container>
+    {
+        using ValType = iterator_deref_decay<Container>;
+        using Iterator = iterator_of<Container>;
+        auto add = [] (const ValType &a, const ValType &b) { return a + b; };
+        
+        return blockReduce(policy, container, [&add] (Iterator begin, Iterator end) {
+            ValType result = *begin;
+            
+            for(++begin; begin != end; ++begin) {
+                result = add(result, *begin);
+            }
+            
+            return result;
+        }, add, ValType());
+    }
+    
+    template <class Container>
+    auto parallelSumBase(const ParallelPolicy &policy, const Container &container, std::true_type)
+     -> iterator_deref_decay<Container>
+    {
+        using ValType = iterator_deref_decay<Container>;
+        using Iterator = iterator_of<Container>;
+        
+        return blockReduce(policy, container, [] (Iterator begin, Iterator end) {
+            return runKernel<SumKernel<ValType, ValType> >(&*begin, size_t(end - begin));
+        }, [] (const ValType &a, const ValType &b) { return a + b; }, ValType());
+    }
+    
+    // Finds a pointer to the first value in each block for which
+    // comp(value, other) is true for every other value, then combines them
+    // keeping the earlier one unless the later one is strictly better.
+    template <class Container, class Comp>
+    auto parallelExtremumBase(const ParallelPolicy &policy, const Container &container, const Comp &comp)
+     -> const iterator_deref_decay<Container> *
+    {
+        using ValType = iterator_deref_decay<Container>;
+        using Iterator = iterator_of<Container>;
+        
+        return blockReduce(policy, container, [&comp] (Iterator begin, Iterator end) {
+            const ValType *best = &*begin;
+            
+            for(++begin; begin != end; ++begin) {
+                if (std::ref(comp)(*begin, *best)) {
+                    best = &*begin;
+                }
+            }
+            
+            return best;
+        }, [&comp] (const ValType *a, const ValType *b) {
+            return std::ref(comp)(*b, *a) ? b : a;
+        }, static_cast<const ValType *>(nullptr));
+    }
+    
+    template <class Comp, class Container>
+    auto parallelExtremumOr(const ParallelPolicy &policy, const Container &container, std::false_type)
+     -> iterator_deref_decay<Container>
+    {
+        using ValType = iterator_deref_decay<Container>;
+        const ValType *result = parallelExtremumBase(policy, container, Comp());
+        return result ? *result : ValType();
+    }
+    
+    template <class Comp, class Container>
+    auto parallelExtremumOr(const ParallelPolicy &policy, const Container &container, std::true_type)
+     -> iterator_deref_decay<Container>
+    {
+        using ValType = iterator_deref_decay<Container>;
+        using Iterator = iterator_of<Container>;
+        
+        return blockReduce(policy, container, [] (Iterator begin, Iterator end) {
+            return runKernel<ExtremumKernel<ValType, Comp> >(&*begin, size_t(end - begin));
+        }, [] (const ValType &a, const ValType &b) {
+            return Comp()(b, a) ? b : a;
+        }, ValType());
+    }
+    
+    // Like parallelExtremumBase, but compares what func returns for each
+    // value, calling it once per value.
+    template <class Comp, class Container, class F>
+    auto parallelKeyExtremumBase(const ParallelPolicy &policy, const Container &container, const F &func)
+     -> iterator_deref_decay<Container>
+    {
+        using ValType = iterator_deref_decay<Container>;
+        using W = func_container_result<Container, F>;
+        using Iterator = iterator_of<Container>;
+        using Best = std::pair<W, const ValType *>;
+        const Comp comp = Comp();
+        
+        const Best result = blockReduce(policy, container, [&func, &comp] (Iterator begin, Iterator end) {
+            Best best(std::ref(func)(*begin), &*begin);
+            
+            for(++begin; begin != end; ++begin) {
+                W key = std::ref(func)(*begin);
+                
+                if (comp(key, best.first)) {
+                    best = Best(key, &*begin);
+                }
+            }
+            
+            return best;
+        }, [&comp] (const Best &a, const Best &b) {
+            return comp(b.first, a.first) ? b : a;
+        }, Best(W(), nullptr));
+        
+        return result.second ? *result.second : ValType();
+    }
+}
+
+template <class Container, class F>
+auto reduce(const ParallelPolicy &policy, const Container &container, const F &func)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
+    using Iterator = FuncHelpUtils::iterator_of<Container>;
+    auto combine = [&func] (const ValType &a, const ValType &b) { return ValType(std::ref(func)(a, b)); };
+    
+    return FuncHelpUtils::blockReduce(policy, container, [&combine] (Iterator begin, Iterator end) {
+        ValType memo = *begin;
+        
+        for(++begin; begin != end; ++begin) {
+            memo = combine(memo, *begin);
+        }
+        
+        return memo;
+    }, combine, ValType());
+}
+
+// memo is folded in once, before the rest of the values, rather than once per
+// block, so it doesn't have to be an identity value for func.
+template <class Container, class F, class ValType>
+ValType reduce(const ParallelPolicy &policy, const Container &container, const F &func, ValType memo)
+{
+    if (container.begin() == container.end()) {
+        return memo;
+    }
+    
+    return std::ref(func)(ValType(memo), reduce(policy, container, func));
+}
+
+// For folding values into a different type: each block starts from identity
+// and folds its values in with func(memo, value), and the blocks' results are
+// combined with combine(a, b). identity is returned if container is empty.
+template <class Container, class F, class ValType, class Combine>
+ValType reduce(const ParallelPolicy &policy, const Container &container, const F &func, const ValType &identity,
+               const Combine &combine)
+{
+    using Iterator = FuncHelpUtils::iterator_of<Container>;
+    
+    return FuncHelpUtils::blockReduce(policy, container, [&func, &identity] (Iterator begin, Iterator end) {
+        ValType memo = identity;
+        
+        for(; begin != end; ++begin) {
+            memo = std::ref(func)(ValType(memo), *begin);
+        }
+        
+        return memo;
+    }, [&combine] (const ValType &a, const ValType &b) { return ValType(std::ref(combine)(a, b)); }, identity);
+}
+
+template <class Container>
+auto sum(const ParallelPolicy &policy, const Container &container)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    return FuncHelpUtils::parallelSumBase(policy, container, FuncHelpUtils::contiguous_arithmetic_tag<Container>());
+}
+
+template <class Container, class ValType>
+auto sum(const ParallelPolicy &policy, const Container &container, ValType memo)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    return memo + sum(policy, container);
+}
+
+template <class Container, class F>
+auto extremum(const ParallelPolicy &policy, const Container &container, const F &comp)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
+    const ValType *result = FuncHelpUtils::parallelExtremumBase(policy, container, comp);
+    return result ? *result : ValType();
+}
+
+template <class Container>
+auto min(const ParallelPolicy &policy, const Container &container)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
+    return FuncHelpUtils::parallelExtremumOr<FuncHelpUtils::Less<ValType> >(policy, container, FuncHelpUtils::contiguous_arithmetic_tag<Container>());
+}
+
+template <class Container,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_callable<F, FuncHelpUtils::iterator_deref<Container> >::value> >
+auto min(const ParallelPolicy &policy, const Container &container, const F &func)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using W = FuncHelpUtils::func_container_result<Container, F>;
+    return FuncHelpUtils::parallelKeyExtremumBase<FuncHelpUtils::Less<W> >(policy, container, func);
+}
+
+template <class Container>
+auto max(const ParallelPolicy &policy, const Container &container)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using ValType = FuncHelpUtils::iterator_deref_decay<Container>;
+    return FuncHelpUtils::parallelExtremumOr<FuncHelpUtils::Greater<ValType> >(policy, container, FuncHelpUtils::contiguous_arithmetic_tag<Container>());
+}
+
+template <class Container,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_callable<F, FuncHelpUtils::iterator_deref<Container> >::value> >
+auto max(const ParallelPolicy &policy, const Container &container, const F &func)
+ -> FuncHelpUtils::iterator_deref_decay<Container>
+{
+    using W = FuncHelpUtils::func_container_result<Container, F>;
+    return FuncHelpUtils::parallelKeyExtremumBase<FuncHelpUtils::Greater<W> >(policy, container, func);
+}
+
+// sorted and stableSorted
+
+// Random access containers are split into one chunk per thread, the chunks
+// are sorted at the same time, and then sorted chunks are merged in pairs
+// until one is left. Each merge is itself split into pieces of about one
+// chunk's length so that every round of merging uses every thread. The merges
+// are stable, so stableSorted returns exactly what the serial version does,
+// and sorted does too apart from the order of values that compare equal,
+// which std::sort doesn't specify either.
+//
+// Merging needs a buffer as large as the container, so containers whose
+// values aren't default constructible are sorted serially.
+
+namespace FuncHelpUtils {
+    template <class Iterator, class Comp>
+    void sortRange(Iterator begin, Iterator end, const Comp &comp, std::false_type)
+    {
+        std::sort(begin, end, comp);
+    }
+    
+    template <class Iterator, class Comp>
+    void sortRange(Iterator begin, Iterator end, const Comp &comp, std::true_type)
+    {
+        std::stable_sort(begin, end, comp);
+    }
+    
+    // Returns how many of the first k values of the stable merge of the
+    // sorted ranges [a, a + aSize) and [b, b + bSize) come from a.
+    template <class Iterator, class Comp>
+    size_t mergeCorank(Iterator a, size_t aSize, Iterator b, size_t bSize, size_t k, const Comp &comp)
+    {
+        size_t low = (k > bSize) ? k - bSize : 0;
+        size_t high = std::min(k, aSize);
+        
+        while(low < high) {
+            const size_t i = low + (high - low)/2;
+            const size_t j = k - i;
+            
+            if (j == 0 || comp(b[j - 1], a[i])) {
+                high = i;
+            } else {
+                low = i + 1;
+            }
+        }
+        
+        return low;
+    }
+    
+    // runs holds the boundaries of the sorted runs in source, starting with 0
+    // and ending with its size. Merges each pair of runs into dest and
+    // returns the boundaries of the merged runs.
+    template <class Source, class Dest, class Comp>
+    std::vector<size_t> mergeRuns(Source source, Dest dest, const std::vector<size_t> &runs, size_t pieceSize,
+                                  const Comp &comp)
+    {
+        struct Piece {
+            size_t first, middle, last, outFirst, outLast;
+        };
+        
+        std::vector<Piece> pieces;
+        std::vector<size_t> merged;
+        
+        for(size_t r = 0; r + 1 < runs.size(); r += 2) {
+            const size_t first = runs[r];
+            const size_t middle = runs[r + 1];
+            const size_t last = (r + 2 < runs.size()) ? runs[r + 2] : middle;
+            merged.push_back(first);
+            
+            for(size_t out = first; out < last; out += pieceSize) {
+                Piece piece = {first, middle, last, out, std::min(out + pieceSize, last)};
+                pieces.push_back(piece);
+            }
+        }
+        
+        merged.push_back(runs.back());
+        
+        ThreadPool::instance().run(int(pieces.size()), [&] (int p) {
+            const Piece &piece = pieces[p];
+            Source a = source + piece.first;
+            Source b = source + piece.middle;
+            const size_t aSize = piece.middle - piece.first;
+            const size_t bSize = piece.last - piece.middle;
+            const size_t k0 = piece.outFirst - piece.first;
+            const size_t k1 = piece.outLast - piece.first;
+            const size_t i0 = mergeCorank(a, aSize, b, bSize, k0, comp);
+            const size_t i1 = mergeCorank(a, aSize, b, bSize, k1, comp);
+            
+            std::merge(std::make_move_iterator(a + i0), std::make_move_iterator(a + i1),
+                       std::make_move_iterator(b + (k0 - i0)), std::make_move_iterator(b + (k1 - i1)),
+                       dest + piece.outFirst, comp);
+        });
+        
+        return merged;
+    }
+    
+    template <bool Stable, class Container, class Comp>
+    void parallelSortInPlace(const ParallelPolicy &policy, Container &container, const Comp &comp, std::true_type)
+    {
+        using ValType = iterator_deref_decay<Container>;
+        using StableTag = std::integral_constant<bool, Stable>;
+        const size_t size = container.size();
+        const int chunks = chunkCount(policy, size, 1);
+        auto begin = container.begin();
+        
+        if (chunks <= 1) {
+            sortRange(begin, container.end(), comp, StableTag());
+            return;
+        }
+        
+        std::vector<size_t> runs;
+        
+        for(int i = 0; i <= chunks; ++i) {
+            runs.push_back(size * size_t(i) / size_t(chunks));
+        }
+        
+        ThreadPool::instance().run(chunks, [&] (int i) {
+            sortRange(begin + runs[i], begin + runs[i + 1], comp, StableTag());
+        });
+        
+        std::vector<ValType> buffer(size);
+        const size_t pieceSize = (size + size_t(chunks) - 1) / size_t(chunks);
+        bool inBuffer = false;
+        
+        while(runs.size() > 2) {
+            if (inBuffer) {
+                runs = mergeRuns(buffer.begin(), begin, runs, pieceSize, comp);
+            } else {
+                runs = mergeRuns(begin, buffer.begin(), runs, pieceSize, comp);
+            }
+            
+            inBuffer = !inBuffer;
+        }
+        
+        if (inBuffer) {
+            ThreadPool::instance().run(chunks, [&] (int i) {
+                const size_t first = size * size_t(i) / size_t(chunks);
+                const size_t last = size * size_t(i + 1) / size_t(chunks);
+                std::move(buffer.begin() + first, buffer.begin() + last, begin + first);
+            });
+        }
+    }
+    
+    template <bool Stable, class Container, class Comp>
+    void parallelSortInPlace(const ParallelPolicy &policy, Container &container, const Comp &comp, std::false_type)
+    {
+        (void)policy;
+        
+        if (Stable) {
+            stableSortInPlace(container, comp);
+        } else {
+            sortInPlace(container, comp);
+        }
+    }
+    
+    template <bool Stable, class Container, class Comp>
+    void parallelSortInPlace(const ParallelPolicy &policy, Container &container, const Comp &comp)
+    {
+        parallelSortInPlace<Stable>(policy, container, comp,
+            std::integral_constant<bool, is_random_access<Container>::value &&
+                                         std::is_default_constructible<iterator_deref_decay<Container> >::value>());
+    }
+}
+
+template <class Container>
+Container sorted(const ParallelPolicy &policy, const Container &container)
+{
+    Container result(container);
+    FuncHelpUtils::parallelSortInPlace<false>(policy, result, FuncHelpUtils::Less<FuncHelpUtils::iterator_deref_decay<Container> >());
+    return result;
+}
+
+template <class Container, class F>
+Container sorted(const ParallelPolicy &policy, const Container &container, const F &comp)
+{
+    Container result(container);
+    FuncHelpUtils::parallelSortInPlace<false>(policy, result, std::ref(comp));
+    return result;
+}
+
+template <class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_reusable_rvalue<Container>::value> >
+Container sorted(const ParallelPolicy &policy, Container &&container)
+{
+    FuncHelpUtils::parallelSortInPlace<false>(policy, container, FuncHelpUtils::Less<FuncHelpUtils::iterator_deref_decay<Container> >());
+    return std::move(container);
+}
+
+template <class Container,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_reusable_rvalue<Container>::value> >
+Container sorted(const ParallelPolicy &policy, Container &&container, const F &comp)
+{
+    FuncHelpUtils::parallelSortInPlace<false>(policy, container, std::ref(comp));
+    return std::move(container);
+}
+
+template <class Container>
+Container stableSorted(const ParallelPolicy &policy, const Container &container)
+{
+    Container result(container);
+    FuncHelpUtils::parallelSortInPlace<true>(policy, result, FuncHelpUtils::Less<FuncHelpUtils::iterator_deref_decay<Container> >());
+    return result;
+}
+
+template <class Container, class F>
+Container stableSorted(const ParallelPolicy &policy, const Container &container, const F &comp)
+{
+    Container result(container);
+    FuncHelpUtils::parallelSortInPlace<true>(policy, result, std::ref(comp));
+    return result;
+}
+
+template <class Container,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_reusable_rvalue<Container>::value> >
+Container stableSorted(const ParallelPolicy &policy, Container &&container)
+{
+    FuncHelpUtils::parallelSortInPlace<true>(policy, container, FuncHelpUtils::Less<FuncHelpUtils::iterator_deref_decay<Container> >());
+    return std::move(container);
+}
+
+template <class Container,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::is_reusable_rvalue<Container>::value> >
+Container stableSorted(const ParallelPolicy &policy, Container &&container, const F &comp)
+{
+    FuncHelpUtils::parallelSortInPlace<true>(policy, container, std::ref(comp));
+    return std::move(container);
+}
+
+#endif // PARALLEL_FUNCTIONAL_HELPERS_H_GUARD
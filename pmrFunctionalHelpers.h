@@ -0,0 +1,375 @@
+// pmrFunctionalHelpers.h
+
+// Versions of some of the functions in functionalHelpers.h that build their
+// results in std::pmr containers. Each one takes a std::pmr::memory_resource
+// as its first argument, e.g.
+//
+//     std::pmr::monotonic_buffer_resource arena;
+//     std::pmr::vector<int> doubled = map(&arena, numbers, timesTwo);
+//
+// and otherwise behaves like the function of the same name. Without a
+// template argument the result is the std::pmr version of the container that
+// was passed in (or std::pmr::vector if there isn't one), and with one it's
+// the container given, constructed with the memory_resource if it uses a
+// polymorphic allocator.
+//
+// map, compr, filter, reject and flatten also accept std::pmr containers
+// without being given a memory_resource, in which case the result is
+// allocated from the same memory_resource as the container passed in.
+//
+// Requires C++17. If using Qt, include qtFunctionalHelpers.h before this file.
+
+#ifndef PMR_FUNCTIONAL_HELPERS_H_GUARD
+#define PMR_FUNCTIONAL_HELPERS_H_GUARD
+
+#include <deque>
+#include <list>
+#include <memory>
+#include <memory_resource>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <functionalHelpers.h>
+
+namespace FuncHelpUtils {
+    // PmrFamily<Container>::type is the std::pmr version of Container, e.g.
+    // PmrFamily<std::list>::type<int> is std::pmr::list<int>. Containers
+    // without a std::pmr version map to std::pmr::vector.
+    template <template <class...> class Container>
+    struct PmrFamily {
+        template <class T> using type = std::pmr::vector<T>;
+    };
+
+    template <>
+    struct PmrFamily<std::list> {
+        template <class T> using type = std::pmr::list<T>;
+    };
+
+    template <>
+    struct PmrFamily<std::deque> {
+        template <class T> using type = std::pmr::deque<T>;
+    };
+
+    template <>
+    struct PmrFamily<std::set> {
+        template <class T> using type = std::pmr::set<T>;
+    };
+
+    template <>
+    struct PmrFamily<std::multiset> {
+        template <class T> using type = std::pmr::multiset<T>;
+    };
+
+    template <>
+    struct PmrFamily<std::unordered_set> {
+        template <class T> using type = std::pmr::unordered_set<T>;
+    };
+
+    template <>
+    struct PmrFamily<std::unordered_multiset> {
+        template <class T> using type = std::pmr::unordered_multiset<T>;
+    };
+
+    template <>
+    struct PmrFamily<std::basic_string> {
+        template <class T> using type = std::pmr::basic_string<T>;
+    };
+
+    template <class Container>
+    struct PmrVersion;
+
+    template <template <class...> class Container, class T, class... Rest>
+    struct PmrVersion<Container<T, Rest...> > {
+        template <class U> using type = typename PmrFamily<Container>::template type<U>;
+    };
+
+    // The std::pmr version of Container's type of container, holding ValType
+    template <class Container, class ValType>
+    using pmr_result = typename PmrVersion<Container>::template type<ValType>;
+
+    template <class Container>
+    using uses_memory_resource = std::uses_allocator<Container, std::pmr::memory_resource *>;
+
+    // Constructs an empty Container that allocates from resource, or a
+    // default constructed one if Container doesn't use a polymorphic
+    // allocator.
+    template <class Container>
+    Container makeWithResource(std::pmr::memory_resource *resource)
+    {
+        if constexpr (uses_memory_resource<Container>::value) {
+            return Container(typename Container::allocator_type(resource));
+        } else {
+            (void)resource;
+            return Container();
+        }
+    }
+
+    template <class Container>
+    std::pmr::memory_resource *resourceOf(const Container &container)
+    {
+        return container.get_allocator().resource();
+    }
+}
+
+// map
+
+template <class InType,
+          class F>
+auto map(std::pmr::memory_resource *resource, const InType &container, const F &func)
+ -> FuncHelpUtils::pmr_result<InType, FuncHelpUtils::func_container_result<InType, F> >
+{
+    using OutType = FuncHelpUtils::pmr_result<InType, FuncHelpUtils::func_container_result<InType, F> >;
+    OutType result = FuncHelpUtils::makeWithResource<OutType>(resource);
+    FUNC_HELPERS_PROFILE_SCOPE("map");
+    FuncHelpUtils::appendMapped(result, container, func);
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          class InType,
+          class F>
+auto map(std::pmr::memory_resource *resource, const InType &container, const F &func)
+ -> OutContainer<FuncHelpUtils::func_container_result<InType, F> >
+{
+    using OutType = OutContainer<FuncHelpUtils::func_container_result<InType, F> >;
+    OutType result = FuncHelpUtils::makeWithResource<OutType>(resource);
+    FUNC_HELPERS_PROFILE_SCOPE("map");
+    FuncHelpUtils::appendMapped(result, container, func);
+    return result;
+}
+
+template <class InType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::uses_memory_resource<InType>::value> >
+auto map(const InType &container, const F &func)
+ -> FuncHelpUtils::pmr_result<InType, FuncHelpUtils::func_container_result<InType, F> >
+{
+    return map(FuncHelpUtils::resourceOf(container), container, func);
+}
+
+template <template <class...> class OutContainer,
+          class InType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::uses_memory_resource<InType>::value> >
+auto map(const InType &container, const F &func)
+ -> OutContainer<FuncHelpUtils::func_container_result<InType, F> >
+{
+    return map<OutContainer>(FuncHelpUtils::resourceOf(container), container, func);
+}
+
+// compr
+
+template <class InType,
+          class F1,
+          class F2>
+auto compr(std::pmr::memory_resource *resource, const InType &container, const F1 &func, const F2 &predicate)
+ -> FuncHelpUtils::pmr_result<InType, FuncHelpUtils::func_container_result<InType, F1> >
+{
+    using OutType = FuncHelpUtils::pmr_result<InType, FuncHelpUtils::func_container_result<InType, F1> >;
+    OutType result = FuncHelpUtils::makeWithResource<OutType>(resource);
+    FUNC_HELPERS_PROFILE_SCOPE("compr");
+    FuncHelpUtils::appendCompr(result, container, func, predicate);
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          class InType,
+          class F1,
+          class F2>
+auto compr(std::pmr::memory_resource *resource, const InType &container, const F1 &func, const F2 &predicate)
+ -> OutContainer<FuncHelpUtils::func_container_result<InType, F1> >
+{
+    using OutType = OutContainer<FuncHelpUtils::func_container_result<InType, F1> >;
+    OutType result = FuncHelpUtils::makeWithResource<OutType>(resource);
+    FUNC_HELPERS_PROFILE_SCOPE("compr");
+    FuncHelpUtils::appendCompr(result, container, func, predicate);
+    return result;
+}
+
+template <class InType,
+          class F1,
+          class F2,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::uses_memory_resource<InType>::value> >
+auto compr(const InType &container, const F1 &func, const F2 &predicate)
+ -> FuncHelpUtils::pmr_result<InType, FuncHelpUtils::func_container_result<InType, F1> >
+{
+    return compr(FuncHelpUtils::resourceOf(container), container, func, predicate);
+}
+
+template <template <class...> class OutContainer,
+          class InType,
+          class F1,
+          class F2,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::uses_memory_resource<InType>::value> >
+auto compr(const InType &container, const F1 &func, const F2 &predicate)
+ -> OutContainer<FuncHelpUtils::func_container_result<InType, F1> >
+{
+    return compr<OutContainer>(FuncHelpUtils::resourceOf(container), container, func, predicate);
+}
+
+// filter
+
+template <class InType,
+          class F>
+auto filter(std::pmr::memory_resource *resource, const InType &container, const F &predicate)
+ -> FuncHelpUtils::pmr_result<InType, FuncHelpUtils::iterator_deref_decay<InType> >
+{
+    using OutType = FuncHelpUtils::pmr_result<InType, FuncHelpUtils::iterator_deref_decay<InType> >;
+    OutType result = FuncHelpUtils::makeWithResource<OutType>(resource);
+    FUNC_HELPERS_PROFILE_SCOPE("filter");
+    FuncHelpUtils::appendFiltered<true>(result, container, predicate);
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          class InType,
+          class F>
+auto filter(std::pmr::memory_resource *resource, const InType &container, const F &predicate)
+ -> OutContainer<FuncHelpUtils::iterator_deref_decay<InType> >
+{
+    using OutType = OutContainer<FuncHelpUtils::iterator_deref_decay<InType> >;
+    OutType result = FuncHelpUtils::makeWithResource<OutType>(resource);
+    FUNC_HELPERS_PROFILE_SCOPE("filter");
+    FuncHelpUtils::appendFiltered<true>(result, container, predicate);
+    return result;
+}
+
+template <class InType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::uses_memory_resource<InType>::value> >
+auto filter(const InType &container, const F &predicate)
+ -> FuncHelpUtils::pmr_result<InType, FuncHelpUtils::iterator_deref_decay<InType> >
+{
+    return filter(FuncHelpUtils::resourceOf(container), container, predicate);
+}
+
+template <template <class...> class OutContainer,
+          class InType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::uses_memory_resource<InType>::value> >
+auto filter(const InType &container, const F &predicate)
+ -> OutContainer<FuncHelpUtils::iterator_deref_decay<InType> >
+{
+    return filter<OutContainer>(FuncHelpUtils::resourceOf(container), container, predicate);
+}
+
+// reject
+
+template <class InType,
+          class F>
+auto reject(std::pmr::memory_resource *resource, const InType &container, const F &predicate)
+ -> FuncHelpUtils::pmr_result<InType, FuncHelpUtils::iterator_deref_decay<InType> >
+{
+    using OutType = FuncHelpUtils::pmr_result<InType, FuncHelpUtils::iterator_deref_decay<InType> >;
+    OutType result = FuncHelpUtils::makeWithResource<OutType>(resource);
+    FUNC_HELPERS_PROFILE_SCOPE("reject");
+    FuncHelpUtils::appendFiltered<false>(result, container, predicate);
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          class InType,
+          class F>
+auto reject(std::pmr::memory_resource *resource, const InType &container, const F &predicate)
+ -> OutContainer<FuncHelpUtils::iterator_deref_decay<InType> >
+{
+    using OutType = OutContainer<FuncHelpUtils::iterator_deref_decay<InType> >;
+    OutType result = FuncHelpUtils::makeWithResource<OutType>(resource);
+    FUNC_HELPERS_PROFILE_SCOPE("reject");
+    FuncHelpUtils::appendFiltered<false>(result, container, predicate);
+    return result;
+}
+
+template <class InType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::uses_memory_resource<InType>::value> >
+auto reject(const InType &container, const F &predicate)
+ -> FuncHelpUtils::pmr_result<InType, FuncHelpUtils::iterator_deref_decay<InType> >
+{
+    return reject(FuncHelpUtils::resourceOf(container), container, predicate);
+}
+
+template <template <class...> class OutContainer,
+          class InType,
+          class F,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::uses_memory_resource<InType>::value> >
+auto reject(const InType &container, const F &predicate)
+ -> OutContainer<FuncHelpUtils::iterator_deref_decay<InType> >
+{
+    return reject<OutContainer>(FuncHelpUtils::resourceOf(container), container, predicate);
+}
+
+// range
+
+template <template <class...> class OutContainer>
+auto range(std::pmr::memory_resource *resource, int start, int end, int inc=1)
+ -> OutContainer<int>
+{
+    OutContainer<int> result = FuncHelpUtils::makeWithResource<OutContainer<int> >(resource);
+    FuncHelpUtils::appendRange(result, start, end, inc);
+    return result;
+}
+
+template <template <class...> class OutContainer>
+auto range(std::pmr::memory_resource *resource, int end)
+ -> OutContainer<int>
+{
+    return range<OutContainer>(resource, 0, end);
+}
+
+// flatten
+
+// The result is the std::pmr version of the nested containers' type, so when
+// flattening a std::pmr container of std::pmr containers without passing a
+// memory_resource, the result ends up in the same memory_resource as the
+// outer container.
+
+namespace FuncHelpUtils {
+    template <class InType>
+    using nested_container = iterator_deref_decay<InType>;
+
+    template <class InType>
+    using nested_value = iterator_deref_decay<nested_container<InType> >;
+}
+
+template <class InType>
+auto flatten(std::pmr::memory_resource *resource, const InType &container)
+ -> FuncHelpUtils::pmr_result<FuncHelpUtils::nested_container<InType>, FuncHelpUtils::nested_value<InType> >
+{
+    using OutType = FuncHelpUtils::pmr_result<FuncHelpUtils::nested_container<InType>, FuncHelpUtils::nested_value<InType> >;
+    OutType result = FuncHelpUtils::makeWithResource<OutType>(resource);
+    FuncHelpUtils::appendFlattened(result, container);
+    return result;
+}
+
+template <template <class...> class OutContainer,
+          class InType>
+auto flatten(std::pmr::memory_resource *resource, const InType &container)
+ -> OutContainer<FuncHelpUtils::nested_value<InType> >
+{
+    using OutType = OutContainer<FuncHelpUtils::nested_value<InType> >;
+    OutType result = FuncHelpUtils::makeWithResource<OutType>(resource);
+    FuncHelpUtils::appendFlattened(result, container);
+    return result;
+}
+
+template <class InType,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::uses_memory_resource<InType>::value> >
+auto flatten(const InType &container)
+ -> FuncHelpUtils::pmr_result<FuncHelpUtils::nested_container<InType>, FuncHelpUtils::nested_value<InType> >
+{
+    return flatten(FuncHelpUtils::resourceOf(container), container);
+}
+
+template <template <class...> class OutContainer,
+          class InType,
+          class = FuncHelpUtils::enable_if_t<FuncHelpUtils::uses_memory_resource<InType>::value> >
+auto flatten(const InType &container)
+ -> OutContainer<FuncHelpUtils::nested_value<InType> >
+{
+    return flatten<OutContainer>(FuncHelpUtils::resourceOf(container), container);
+}
+
+#endif // PMR_FUNCTIONAL_HELPERS_H_GUARD
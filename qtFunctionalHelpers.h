@@ -13,6 +13,7 @@
 #include <QVector>
 #include <QList>
 #include <QSet>
+#include <QHash>
 #include <QLinkedList>
 
 // These need to be declared before functionalHelpers.h is included so that the macros
@@ -24,6 +25,37 @@ namespace FuncHelpUtils {
         container.reserve(size);
     }
     
+    template<class U>
+    inline void reserveSize(QList<U> &container, int size)
+    {
+        container.reserve(size);
+    }
+    
+    inline void reserveSize(QStringList &container, int size)
+    {
+        container.reserve(size);
+    }
+    
+    template<class U>
+    inline void reserveSize(QSet<U> &container, int size)
+    {
+        container.reserve(size);
+    }
+    
+    template<class K, class U>
+    inline void reserveSize(QHash<K, U> &container, int size)
+    {
+        container.reserve(size);
+    }
+    
+    template<class U>
+    inline void shrinkSize(QVector<U> &container)
+    {
+        if (container.size() < container.capacity() / 2) {
+            container.squeeze();
+        }
+    }
+    
     template<class U>
     inline void addItem(QSet<U> &container, const U &item)
     {
@@ -34,6 +66,29 @@ namespace FuncHelpUtils {
     {
         container.append(item);
     }
+    
+    template<class U>
+    inline void moveItem(QList<U> &container, U &&item)
+    {
+        container.append(std::move(item));
+    }
+    
+    template<class U>
+    inline void moveItem(QVector<U> &container, U &&item)
+    {
+        container.append(std::move(item));
+    }
+    
+    template<class U>
+    inline void moveItem(QSet<U> &container, U &&item)
+    {
+        container.insert(std::move(item));
+    }
+    
+    inline void moveItem(QStringList &container, QString &&item)
+    {
+        container.append(std::move(item));
+    }
 }
 
 #include <functionalHelpers.h>
@@ -68,6 +123,17 @@ QStringList filter(const QStringList &container, const F &pred)
     return filter<QStringList, QStringList>(container, pred);
 }
 
+template <class F>
+QStringList filter(QStringList &&container, const F &pred)
+{
+    FUNC_HELPERS_PROFILE_SCOPE("filter");
+    FUNC_HELPERS_PROFILE_VISIT(container.size());
+    FUNC_HELPERS_PROFILE_CALL(container.size());
+    FuncHelpUtils::keepIf(container, pred);
+    FUNC_HELPERS_PROFILE_OUTPUT(container);
+    return std::move(container);
+}
+
 // reject
 template <class F>
 QStringList reject(const QStringList &container, const F &pred)
@@ -75,6 +141,52 @@ QStringList reject(const QStringList &container, const F &pred)
     return reject<QStringList, QStringList>(container, pred);
 }
 
+template <class F>
+QStringList reject(QStringList &&container, const F &pred)
+{
+    FUNC_HELPERS_PROFILE_SCOPE("reject");
+    FUNC_HELPERS_PROFILE_VISIT(container.size());
+    FUNC_HELPERS_PROFILE_CALL(container.size());
+    FuncHelpUtils::keepIf(container, [&pred] (const QString &val) { return !std::ref(pred)(val); });
+    FUNC_HELPERS_PROFILE_OUTPUT(container);
+    return std::move(container);
+}
+
+// groupBy, countBy and keyBy
+
+// Qt containers are grouped into a QHash, as long as qHash supports the key.
+
+namespace FuncHelpUtils {
+    template <class T>
+    struct is_qt_container : std::false_type {};
+    
+    template <class U>
+    struct is_qt_container<QList<U> > : std::true_type {};
+    
+    template <class U>
+    struct is_qt_container<QVector<U> > : std::true_type {};
+    
+    template <class U>
+    struct is_qt_container<QSet<U> > : std::true_type {};
+    
+    template <class U>
+    struct is_qt_container<QLinkedList<U> > : std::true_type {};
+    
+    template <>
+    struct is_qt_container<QStringList> : std::true_type {};
+    
+    template <class Key, class = void>
+    struct has_qhash : std::false_type {};
+    
+    template <class Key>
+    struct has_qhash<Key, decltype(void(qHash(std::declval<const Key &>())))> : std::true_type {};
+    
+    template <class InContainer, class Key, class Value>
+    struct hash_map_for<InContainer, Key, Value, enable_if_t<is_qt_container<InContainer>::value && has_qhash<Key>::value> > {
+        using type = QHash<Key, Value>;
+    };
+}
+
 // sorted
 
 // Adding an overload for convenient sorting of QStringLists
@@ -85,6 +197,12 @@ inline QStringList sorted(const QStringList &list, Qt::CaseSensitivity sensitivi
     return result;
 }
 
+inline QStringList sorted(QStringList &&list, Qt::CaseSensitivity sensitivity=Qt::CaseSensitive)
+{
+    list.sort(sensitivity);
+    return std::move(list);
+}
+
 // contains
 
 template <class T>
@@ -103,6 +221,7 @@ template <template <class> class Container, class T, template <class> class Iter
 Container<T> reversed(const Container<T> &container)
 {
     Container<T> result;
+    FuncHelpUtils::reserveSize(result, container.size());
     Iterator<T> it(container);
     it.toBack();
     
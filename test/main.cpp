@@ -1,4 +1,9 @@
 #include <qtFunctionalHelpers.h>
+#include <parallelFunctionalHelpers.h>
+#if __cplusplus >= 201703L
+#include <pmrFunctionalHelpers.h>
+#include <arrayFunctionalHelpers.h>
+#endif
 #include <QDebug>
 #include <QItemSelection>
 
@@ -91,6 +96,9 @@ const QVector<int> QVectorNumbers = {1,2,3,4,5};
 const QSet<int> QSetNumbers = {1,2,3,4,5};
 const QLinkedList<int> QLinkedListNumbers = {1,2,3,4,5};
 
+// 0 to 999 in a scrambled order
+const vector<int> shuffledNumbers = mapRange<vector>(1000, [] (int x) { return (x*7919) % 1000; });
+
 const list<int> listEvenNumbers = {2,4,6,8,10};
 const list<int> listOddNumbers = {1,3,5,7,9};
 
@@ -158,6 +166,7 @@ void testMap()
     TEST(::map(QLinkedListNumbers, [] (int x) { return x*2; }), QLinkedListExpected);
     TEST(::map<vector>(listNumbers, [] (int x) { return x*2; }), vectorExpected);
     TEST(::map<set>(listNumbers, [] (int x) { return x*2; }), setExpected);
+    TEST(::map<unordered_set>(listNumbers, [] (int x) { return x*2; }), unordered_set<int>({2,4,6,8,10}));
     TEST(::map<QList>(listNumbers, [] (int x) { return x*2; }), QListExpected);
     TEST(::map<QVector>(listNumbers, [] (int x) { return x*2; }), QVectorExpected);
     TEST(::map<QSet>(listNumbers, [] (int x) { return x*2; }), QSetExpected);
@@ -173,6 +182,13 @@ void testMap()
     TEST(::map(stringList, [] (const QString &a) { return a.toUpper(); }),
          QStringList({"AAAAA", "BBBB", "CCC", "DD", "E"}));
     TEST(::map(stringList, &QString::toUpper), QStringList({"AAAAA", "BBBB", "CCC", "DD", "E"}));
+    
+    TEST(::map(vector<int>(vectorNumbers), [] (int x) { return x*2; }), vectorExpected);
+    TEST(::map(list<int>(listNumbers), [] (int x) { return x*2; }), listExpected);
+    TEST(::map(set<int>(setNumbers), [] (int x) { return x*2; }), setExpected);
+    TEST(::map(QVector<int>(QVectorNumbers), [] (int x) { return x*2; }), QVectorExpected);
+    TEST(::map(vector<Foo>(vectorFoos), &Foo::fooTimesTwo), vectorExpected);
+    TEST(::map(string("abcde"), [] (char c) { return char(toupper(c)); }), string("ABCDE"));
 }
 
 void testCompr()
@@ -285,6 +301,7 @@ void testFilter()
     
     TEST(filter<vector>(listNumbers, [] (int x) { return (x%2) == 0; }), vectorExpected);
     TEST(filter<set>(listNumbers, [] (int x) { return (x%2) == 0; }), setExpected);
+    TEST(filter<unordered_set>(listNumbers, [] (int x) { return (x%2) == 0; }), unordered_set<int>({2,4}));
     TEST(filter<QList>(listNumbers, [] (int x) { return (x%2) == 0; }), QListExpected);
     TEST(filter<QVector>(listNumbers, [] (int x) { return (x%2) == 0; }), QVectorExpected);
     TEST(filter<QSet>(listNumbers, [] (int x) { return (x%2) == 0; }), QSetExpected);
@@ -293,6 +310,38 @@ void testFilter()
     TEST(filter(std::string("aBcDeFgH"), isupper), std::string("BDFH"));
     TEST(filter(stringList, &QString::isEmpty), QStringList());
     TEST(filter(stringList, [] (const QString &a) { return !a.isEmpty(); }), stringList);
+    
+    TEST(filter(list<int>(listNumbers), [] (int x) { return (x%2) == 0; }), listExpected);
+    TEST(filter(vector<int>(vectorNumbers), [] (int x) { return (x%2) == 0; }), vectorExpected);
+    TEST(filter(set<int>(setNumbers), [] (int x) { return (x%2) == 0; }), setExpected);
+    TEST(filter(forward_list<int>({1,2,3,4,5}), [] (int x) { return (x%2) == 0; }), forward_list<int>({2,4}));
+    TEST(filter(QList<Foo>(QListFoos), &Foo::isEven), QList<Foo>({fooB, fooD}));
+    TEST(filter(QSet<int>(QSetNumbers), [] (int x) { return (x%2) == 0; }), QSetExpected);
+    TEST(filter(QStringList(stringList), [] (const QString &a) { return a.size() > 3; }), QStringList({"aaaaa", "bbbb"}));
+    TEST(filter<set>(vector<int>(vectorNumbers), [] (int x) { return (x%2) == 0; }), setExpected);
+    TEST(filter<QList>(vector<Foo>(vectorFoos), &Foo::isEven), QList<Foo>({fooB, fooD}));
+    
+    // Long enough to go through the vectorized compaction in blocks, with
+    // some values left over at the end
+    const vector<int> manyNumbers = range<vector>(1000);
+    TEST(filter(manyNumbers, isEven), mapRange<vector>(500, timesTwo));
+    TEST(filter(vector<int>(manyNumbers), isEven), mapRange<vector>(500, timesTwo));
+    TEST(filter(QVector<double>({0.5, 1.5, 2.5}), [] (double x) { return x > 1; }), QVector<double>({1.5, 2.5}));
+    
+    // Results much smaller than the container don't keep room for every value
+    const auto isFive = [] (int x) { return x == 5; };
+    TEST(filter(manyNumbers, isFive).capacity() < manyNumbers.size() / 2, true);
+    TEST(filter(vector<int>(manyNumbers), isFive).capacity() < manyNumbers.size() / 2, true);
+    TEST(filter(range<QVector>(1000), isFive).capacity() < 500, true);
+    
+    // Small trivially copyable values that can't be default constructed are
+    // added one at a time instead
+    const vector<reference_wrapper<const Foo> > fooRefs(vectorFoos.begin(), vectorFoos.end());
+    const auto getValue = [] (const Foo &foo) { return foo.getValue(); };
+    TEST(::map(filter(fooRefs, [] (const Foo &foo) { return foo.isEven(); }), getValue), vector<int>({2, 4}));
+    TEST(::map(reject(fooRefs, [] (const Foo &foo) { return foo.isEven(); }), getValue), vector<int>({1, 3, 5}));
+    TEST(::map(filter(vector<reference_wrapper<const Foo> >(fooRefs), [] (const Foo &foo) { return foo.isEven(); }), getValue),
+         vector<int>({2, 4}));
 }
 
 void testReject()
@@ -336,6 +385,91 @@ void testReject()
     TEST(reject(std::string("aBcDeFgH"), isupper), std::string("aceg"));
     TEST(reject(stringList, &QString::isEmpty), stringList);
     TEST(reject(stringList, [] (const QString &a) { return !a.isEmpty(); }), QStringList());
+    
+    TEST(reject(list<int>(listNumbers), [] (int x) { return (x%2) == 0; }), listExpected);
+    TEST(reject(vector<int>(vectorNumbers), [] (int x) { return (x%2) == 0; }), vectorExpected);
+    TEST(reject(set<int>(setNumbers), [] (int x) { return (x%2) == 0; }), setExpected);
+    TEST(reject(QVector<Foo>(QVectorFoos), &Foo::isEven), QVector<Foo>({fooA, fooC, fooE}));
+    TEST(reject(QStringList(stringList), [] (const QString &a) { return a.size() > 3; }), QStringList({"ccc", "dd", "e"}));
+    TEST(reject<QSet>(vector<int>(vectorNumbers), [] (int x) { return (x%2) == 0; }), QSetExpected);
+    
+    const vector<int> manyNumbers = range<vector>(1001);
+    TEST(reject(manyNumbers, isEven), mapRange<vector>(500, [] (int x) { return x*2 + 1; }));
+    TEST(reject(vector<int>(manyNumbers), isEven), mapRange<vector>(500, [] (int x) { return x*2 + 1; }));
+}
+
+void testPartition()
+{
+    typedef pair<vector<int>, vector<int> > VectorPair;
+    typedef pair<list<int>, list<int> > ListPair;
+    const VectorPair vectorExpected(vector<int>({2, 4}), vector<int>({1, 3, 5}));
+    const ListPair listExpected(list<int>({2, 4}), list<int>({1, 3, 5}));
+    
+    TEST(partition(vectorNumbers, [] (int x) { return (x%2) == 0; }), vectorExpected);
+    TEST(partition(listNumbers, &isEven), listExpected);
+    TEST(partition(setNumbers, &isEven), make_pair(set<int>({2, 4}), set<int>({1, 3, 5})));
+    TEST(partition(QListNumbers, &isEven), make_pair(QList<int>({2, 4}), QList<int>({1, 3, 5})));
+    TEST(partition(QSetNumbers, &isEven), make_pair(QSet<int>({2, 4}), QSet<int>({1, 3, 5})));
+    
+    TEST(partition<vector>(listNumbers, &isEven), vectorExpected);
+    TEST(partition<list>(vectorNumbers, bind(isMultiple, placeholders::_1, 2)), listExpected);
+    TEST(partition<QVector>(listNumbers, &isEven), make_pair(QVector<int>({2, 4}), QVector<int>({1, 3, 5})));
+    TEST(partition<list>(listFoos, &Foo::isEven), make_pair(list<Foo>({fooB, fooD}), list<Foo>({fooA, fooC, fooE})));
+    TEST(partition<list>(listFooPtrs, &Foo::baseIsEven),
+         make_pair(list<Foo *>({&fooB, &fooD}), list<Foo *>({&fooA, &fooC, &fooE})));
+    
+    TEST(partition(std::string("aBcDeFgH"), isupper), make_pair(std::string("BDFH"), std::string("aceg")));
+    TEST(partition(stringList, &QString::isEmpty), make_pair(QStringList(), stringList));
+    
+    TEST(partition(vector<int>(vectorNumbers), &isEven), vectorExpected);
+    TEST(partition(list<int>(listNumbers), &isEven), listExpected);
+    TEST(partition(QStringList(stringList), [] (const QString &a) { return a.size() > 3; }),
+         make_pair(QStringList({"aaaaa", "bbbb"}), QStringList({"ccc", "dd", "e"})));
+    TEST(partition<list>(vector<int>(vectorNumbers), &isEven), listExpected);
+    
+    const vector<int> manyNumbers = range<vector>(1001);
+    TEST(partition(manyNumbers, isEven), make_pair(filter(manyNumbers, isEven), reject(manyNumbers, isEven)));
+    
+    // Neither side keeps room for every value when it got only a few of them
+    const auto fewNumbers = partition(manyNumbers, [] (int x) { return x < 10; });
+    TEST(fewNumbers.first.capacity() < manyNumbers.size() / 2, true);
+    TEST(partition(manyNumbers, [] (int x) { return x >= 10; }).second.capacity() < manyNumbers.size() / 2, true);
+    
+    // Small trivially copyable values that can't be default constructed are
+    // added one at a time
+    const vector<reference_wrapper<const Foo> > fooRefs(vectorFoos.begin(), vectorFoos.end());
+    const auto fooParts = partition(fooRefs, [] (const Foo &foo) { return foo.isEven(); });
+    TEST(::map(fooParts.first, [] (const Foo &foo) { return foo.getValue(); }), vector<int>({2, 4}));
+    
+    TEST(partitionBy(vectorNumbers, [] (int x) { return x%3; }, 3),
+         vector<vector<int> >({{3}, {1, 4}, {2, 5}}));
+    TEST(partitionBy<set>(listNumbers, [] (int x) { return x - 5; }, 2), vector<set<int> >({{5}, {}}));
+    TEST(partitionBy(QListNumbers, [] (int x) { return x/4; }, 3), vector<QList<int> >({{1, 2, 3}, {4, 5}, {}}));
+    TEST(partitionBy(vectorNumbers, [] (int x) { return x; }, 0), vector<vector<int> >());
+}
+
+void testGroupBy()
+{
+    const auto byRemainder = [] (int x) { return x%3; };
+    const auto byLength = [] (const QString &s) { return s.size() > 3; };
+    
+    TEST(groupBy(vectorNumbers, byRemainder), (unordered_map<int, vector<int> >({{0, {3}}, {1, {1, 4}}, {2, {2, 5}}})));
+    TEST(groupBy(listFoos, &Foo::isEven), (unordered_map<bool, list<Foo> >({{true, {fooB, fooD}}, {false, {fooA, fooC, fooE}}})));
+    TEST(groupBy<set>(vectorNumbers, &isEven), (unordered_map<bool, set<int> >({{true, {2, 4}}, {false, {1, 3, 5}}})));
+    TEST(groupBy(QListNumbers, byRemainder), (QHash<int, QList<int> >({{0, {3}}, {1, {1, 4}}, {2, {2, 5}}})));
+    TEST(groupBy(stringList, byLength), (QHash<bool, QList<QString> >({{true, {"aaaaa", "bbbb"}}, {false, {"ccc", "dd", "e"}}})));
+    TEST(groupBy(vector<int>(vectorNumbers), byRemainder), groupBy(vectorNumbers, byRemainder));
+    TEST(groupBy(vector<int>(), byRemainder).empty(), true);
+    TEST(groupBy(range(1, 6), byRemainder), groupBy(vectorNumbers, byRemainder));
+    
+    TEST(countBy(vectorNumbers, byRemainder), (unordered_map<int, size_t>({{0, 1}, {1, 2}, {2, 2}})));
+    TEST(countBy(setFoos, &Foo::isEven), (unordered_map<bool, size_t>({{true, 2}, {false, 3}})));
+    TEST(countBy(QVectorNumbers, &isEven), (QHash<bool, size_t>({{true, 2}, {false, 3}})));
+    TEST(countBy(string("banana"), [] (char c) { return c; }), (unordered_map<char, size_t>({{'a', 3}, {'b', 1}, {'n', 2}})));
+    
+    TEST(keyBy(vectorNumbers, byRemainder), (unordered_map<int, int>({{0, 3}, {1, 4}, {2, 5}})));
+    TEST(keyBy(vectorFoos, &Foo::getValue).at(3), fooC);
+    TEST(keyBy(stringList, byLength), (QHash<bool, QString>({{true, "bbbb"}, {false, "e"}})));
 }
 
 void testAllOf()
@@ -364,6 +498,17 @@ void testAllOf()
     TEST(allOf(QLinkedListNumbers, [] (int x) { return (x%2) == 0; }), false);
     TEST(allOf(stringList, &QString::isEmpty), false);
     TEST(allOf(stringList, [] (const QString &a) { return !a.isEmpty(); }), true);
+    
+    TEST(allOf(range<vector>(1, 1001), [] (int x) { return x > 0; }), true);
+    TEST(allOf(range<vector>(1, 1001), [] (int x) { return x < 1000; }), false);
+    TEST(allOf(vector<int>(), [] (int x) { return x > 0; }), true);
+    TEST(allOf(range<vector>(1, 1001), purePredicate([] (int x) { return x > 0; })), true);
+    TEST(allOf(range<vector>(1, 1001), purePredicate([] (int x) { return x < 1000; })), false);
+    
+    // Only pure predicates are called past the value that decides the result
+    int calls = 0;
+    TEST(allOf(range<vector>(1, 1001), [&calls] (int x) { ++calls; return x < 10; }), false);
+    TEST(calls, 10);
 }
 
 void testAnyOf()
@@ -392,6 +537,10 @@ void testAnyOf()
     TEST(anyOf(QLinkedListNumbers, [] (int x) { return (x%2) == 0; }), true);
     TEST(anyOf(stringList, &QString::isEmpty), false);
     TEST(anyOf(stringList, [] (const QString &a) { return !a.isEmpty(); }), true);
+    
+    TEST(anyOf(range<vector>(1, 1001), [] (int x) { return x == 1000; }), true);
+    TEST(anyOf(range<vector>(1, 1001), [] (int x) { return x > 1000; }), false);
+    TEST(anyOf(vector<int>(), [] (int x) { return x > 0; }), false);
 }
 
 void testExtremum()
@@ -455,6 +604,10 @@ void testMin()
     TEST(min(list<CallableClass>(), CallableClass(123)), CallableClass(0));
     TEST(min(list<CallableClass>({CallableClass(1), CallableClass(2)}), CallableClass(123)), CallableClass(2));
     
+    TEST(min(vector<int>(), 123), 123);
+    TEST(min(reversed(range<vector>(1, 1001))), 1);
+    TEST(min(vector<double>({3.5, -2.5, 7.0})), -2.5);
+    
     TEST(min(stringList), QString("aaaaa"));
     TEST(min(stringList, &QString::length), QString("e"));
 }
@@ -489,6 +642,44 @@ void testMax()
     // Example of gotcha where the second argument to max is callable with the value type of the passed in container:
     TEST(max(list<CallableClass>(), CallableClass(123)), CallableClass(0));
     TEST(max(list<CallableClass>({CallableClass(1), CallableClass(2)}), CallableClass(123)), CallableClass(1));
+    
+    TEST(max(vector<int>(), 123), 123);
+    TEST(max(range<vector>(1, 1001)), 1000);
+    TEST(max(vector<double>({3.5, -2.5, 7.0})), 7.0);
+}
+
+void testMinNMaxN()
+{
+    TEST(minN(vectorNumbers, 2), vector<int>({1, 2}));
+    TEST(minN(listNumbers, 3), list<int>({1, 2, 3}));
+    TEST(minN(setNumbers, 2), set<int>({1, 2}));
+    TEST(minN(QListNumbers, 2), QList<int>({1, 2}));
+    TEST(minN<vector>(QLinkedListNumbers, 10), vector<int>({1, 2, 3, 4, 5}));
+    TEST(minN(vectorNumbers, 0), vector<int>());
+    TEST(minN(vectorNumbers, -1), vector<int>());
+    
+    TEST(maxN(vectorNumbers, 2), vector<int>({5, 4}));
+    TEST(maxN(listNumbers, 3), list<int>({5, 4, 3}));
+    TEST(maxN<QVector>(setNumbers, 2), QVector<int>({5, 4}));
+    TEST(maxN(list<int>(), 3), list<int>());
+    TEST(minN(list<int>(), numeric_limits<int>::max()), list<int>());
+    TEST(maxN(setNumbers, 400000000), set<int>({1, 2, 3, 4, 5}));
+    TEST(minN<vector>(forward_list<int>({3, 1, 2}), numeric_limits<int>::max()), vector<int>({1, 2, 3}));
+    
+    TEST(minN(listFoos, 2, &Foo::getValue), list<Foo>({fooA, fooB}));
+    TEST(minN(listFooPtrs, 2, &Foo::baseGetValue), list<Foo *>({&fooA, &fooB}));
+    TEST(minN<vector>(QListFoos, 1, [] (const Foo &a) { return -a.value; }), vector<Foo>({fooE}));
+    TEST(maxN(vectorFoos, 2, &Foo::getValue), vector<Foo>({fooE, fooD}));
+    TEST(maxN(QListFooPtrs, 2, &Foo::getValue), QList<Foo *>({&fooE, &fooD}));
+    TEST(maxN(stringList, 2, &QString::length), QStringList({"aaaaa", "bbbb"}));
+    
+    TEST(topK(vectorNumbers, 2, [] (int a, int b) { return a > b; }), vector<int>({5, 4}));
+    TEST(topK<list>(QSetNumbers, 3, less<int>()), list<int>({1, 2, 3}));
+    TEST(topK(listFoos, 2, [] (const Foo &a, const Foo &b) { return a.value%2 < b.value%2; }).size(), 2u);
+    
+    TEST(minN(shuffledNumbers, 5), vector<int>({0, 1, 2, 3, 4}));
+    TEST(maxN(shuffledNumbers, 3), vector<int>({999, 998, 997}));
+    TEST(minN(shuffledNumbers, 1000), range<vector>(1000));
 }
 
 void testReduce()
@@ -536,6 +727,43 @@ void testSum()
     TEST(sum(list<long long>({1,2,3,4,5})), 15);
     TEST(sum(list<float>({1.,2.,3.,4.,5.})), 15.0);
     TEST(sum(list<unsigned char>({'\1','\2','\3','\4','\5'})), (unsigned char)15);
+    
+    vector<int> manyNumbers = range<vector>(1, 1001);
+    TEST(sum(manyNumbers), 500500);
+    TEST(sum(manyNumbers, 100), 500600);
+    TEST(sum(vector<int>()), 0);
+    TEST(sum(vector<double>({0.5, 1.5, 2.0})), 4.0);
+    TEST(sum(QVector<float>({1.,2.,3.,4.,5.})), 15.0);
+    
+    TEST(wideSum(vector<int>(4, 2000000000)), 8000000000LL);
+    TEST(wideSum(list<unsigned char>(300, '\1')), 300ULL);
+    TEST(wideSum(listFoos), Foo(15));
+    
+    TEST(compensatedSum(vector<double>(1000, 0.1)) == sum(list<double>(1000, 0.1)), false);
+    TEST(compensatedSum(vector<double>(1000, 0.1)), 100.0);
+    TEST(compensatedSum(vectorNumbers), 15);
+}
+
+void testAggregate()
+{
+    TEST(aggregate(vectorNumbers, minOf(), maxOf(), sumOf(), countOf()), make_tuple(1, 5, 15, size_t(5)));
+    TEST(aggregate(listNumbers, minOf(), maxOf(), sumOf(), countOf()), make_tuple(1, 5, 15, size_t(5)));
+    TEST(aggregate(QSetNumbers, sumOf(), meanOf(), varianceOf()), make_tuple(15, 3.0, 2.0));
+    TEST(aggregate(vector<double>({2.5, -1.0, 4.5}), maxOf(), meanOf()), make_tuple(4.5, 2.0));
+    TEST(aggregate(vector<int>(), minOf(), maxOf(), countOf(), meanOf(), varianceOf()), make_tuple(0, 0, size_t(0), 0.0, 0.0));
+    TEST(aggregate(vectorNumbers), tuple<>());
+    TEST(aggregate(vector<int>(100, numeric_limits<int>::max()), minOf(), maxOf(), meanOf()),
+         make_tuple(numeric_limits<int>::max(), numeric_limits<int>::max(), double(numeric_limits<int>::max())));
+    
+    TEST(aggregate(listFoos, minOf(&Foo::getValue), maxOf(&Foo::baseGetValue), sumOf(&Foo::getValue)), make_tuple(fooA, fooE, 15));
+    TEST(aggregate(QListFooPtrs, minOf(&Foo::getValue), countOf()), make_tuple(&fooA, size_t(5)));
+    TEST(aggregate(vectorFoos, meanOf([] (const Foo &a) { return a.value*2; }), varianceOf(&Foo::getValue)), make_tuple(6.0, 2.0));
+    TEST(aggregate(stringList, minOf(&QString::length), maxOf(&QString::length)), make_tuple(QString("e"), QString("aaaaa")));
+    
+    const vector<int> manyNumbers = range<vector>(1, 1001);
+    TEST(aggregate(manyNumbers, minOf(), maxOf(), sumOf()), make_tuple(min(manyNumbers), max(manyNumbers), sum(manyNumbers)));
+    TEST(aggregate(manyNumbers, meanOf(), varianceOf()), make_tuple(500.5, 83333.25));
+    TEST(aggregate(mapRange<vector>(1000, [] (int x) { return 1e9 + (x%2); }), meanOf(), varianceOf()), make_tuple(1e9 + 0.5, 0.25));
 }
 
 void testSorted()
@@ -564,6 +792,64 @@ void testSorted()
     QStringList items = {"CCC", "eee", "Bbb", "aaa", "DDD"};
     TEST(sorted(items), QStringList({"Bbb", "CCC", "DDD", "aaa", "eee"}));
     TEST(sorted(items, Qt::CaseInsensitive), QStringList({"aaa", "Bbb", "CCC", "DDD", "eee"}));
+    TEST(sorted(QStringList(items), Qt::CaseInsensitive), QStringList({"aaa", "Bbb", "CCC", "DDD", "eee"}));
+    TEST(items, QStringList({"CCC", "eee", "Bbb", "aaa", "DDD"}));
+    
+    vector<int> unsortedVector = {3,5,1,4,2};
+    TEST(sorted(unsortedVector), vectorNumbers);
+    TEST(unsortedVector, vector<int>({3,5,1,4,2}));
+    TEST(sorted(std::move(unsortedVector), [] (int a, int b) { return a > b; }), vector<int>({5,4,3,2,1}));
+    
+    const auto byTens = [] (int a, int b) { return a/10 < b/10; };
+    TEST(stableSorted(vector<int>({31,12,35,14,33,11})), vector<int>({11,12,14,31,33,35}));
+    TEST(stableSorted(vector<int>({31,12,35,14,33,11}), byTens), vector<int>({12,14,11,31,35,33}));
+    TEST(stableSorted(list<int>({31,12,35,14,33,11}), byTens), list<int>({12,14,11,31,35,33}));
+    TEST(stableSorted(forward_list<int>({31,12,35,14,33,11}), byTens), forward_list<int>({12,14,11,31,35,33}));
+    TEST(stableSorted(QList<Foo>({fooC, fooB, fooD, fooE, fooA}), &Foo::isLessThan), QListFoos);
+}
+
+void testSortedBy()
+{
+    TEST(sortedBy(list<int>({3,5,1,4,2}), [] (int x) { return -x; }), list<int>({5,4,3,2,1}));
+    TEST(sortedBy(vector<int>({3,5,1,4,2}), [] (int x) { return x; }), vectorNumbers);
+    TEST(sortedBy(forward_list<int>({3,5,1,4,2}), [] (int x) { return x%3; }), forward_list<int>({3,1,4,5,2}));
+    TEST(sortedBy(QVector<int>({3,5,1,4,2}), [] (int x) { return double(x)/2; }), QVectorNumbers);
+    TEST(sortedBy(QLinkedList<int>({3,5,1,4,2}), [] (int x) { return x; }), QLinkedListNumbers);
+    
+    TEST(sortedBy(list<Foo>({fooC, fooB, fooD, fooE, fooA}), &Foo::getValue), listFoos);
+    TEST(sortedBy(list<Foo *>({&fooC, &fooB, &fooD, &fooE, &fooA}), &Foo::baseGetValue), listFooPtrs);
+    TEST(sortedBy(DerivedList({fooC, fooB, fooD, fooE, fooA}), &Foo::getValue), DerivedList(listFoos));
+    TEST(sortedBy(QList<Foo>({fooC, fooB, fooD, fooE, fooA}), [] (const Foo &a) { return a.value; }), QListFoos);
+    
+    QStringList items = {"CCC", "eee", "Bbb", "aaa", "DDD"};
+    TEST(sortedBy(items, &QString::toLower), QStringList({"aaa", "Bbb", "CCC", "DDD", "eee"}));
+    TEST(sortedBy(items, &QString::length), items);
+    TEST(items, QStringList({"CCC", "eee", "Bbb", "aaa", "DDD"}));
+    
+    const vector<int> manyNumbers = ::map(shuffledNumbers, [] (int x) { return x - 500; });
+    TEST(sortedBy(manyNumbers, [] (int x) { return x; }), range<vector>(-500, 500));
+    TEST(sortedBy(manyNumbers, [] (int x) { return float(x); }), range<vector>(-500, 500));
+    TEST(sortedBy(manyNumbers, [] (int x) { return x/100; }), flatten(mapRange<vector>(-5, 5, [&manyNumbers] (int bucket) {
+        return filter(manyNumbers, [bucket] (int x) { return x/100 == bucket; });
+    })));
+    
+    // More values than RadixSortMinSize, so that they're radix sorted
+    const vector<int> moreNumbers = mapRange<vector>(5000, [] (int x) { return (x*7919) % 5000 - 2500; });
+    const auto bySign = [] (int x) { return x < 0 ? -0.0 : 0.0; };
+    TEST(sortedBy(moreNumbers, [] (int x) { return x; }), range<vector>(-2500, 2500));
+    TEST(sortedBy(moreNumbers, [] (int x) { return -(long long)x; }), reversed(range<vector>(-2500, 2500)));
+    TEST(sortedBy(moreNumbers, [] (int x) { return double(x)/3; }), range<vector>(-2500, 2500));
+    TEST(sortedBy(moreNumbers, [] (int x) { return float(-x); }), reversed(range<vector>(-2500, 2500)));
+    TEST(sortedBy(moreNumbers, [] (int x) { return x/100; }),
+         stableSorted(moreNumbers, [] (int a, int b) { return a/100 < b/100; }));
+    TEST(sortedBy(list<int>(moreNumbers.begin(), moreNumbers.end()), [] (int x) { return unsigned(x + 2500)/7; }),
+         stableSorted(list<int>(moreNumbers.begin(), moreNumbers.end()), [] (int a, int b) { return (a + 2500)/7 < (b + 2500)/7; }));
+    TEST(sortedBy(moreNumbers, bySign), moreNumbers);
+    
+    const vector<double> signedZeros = mapRange<vector>(2000, [] (int x) { return (x%4 == 0) ? -0.0 : (x%4 == 1) ? 0.0 : x - 1000.5; });
+    const auto signOf = [] (double x) { return signbit(x); };
+    TEST(sortedBy(signedZeros, [] (double x) { return x; }), stableSorted(signedZeros));
+    TEST(::map(sortedBy(signedZeros, [] (double x) { return x; }), signOf), ::map(stableSorted(signedZeros), signOf));
 }
 
 void testContains()
@@ -578,6 +864,39 @@ void testContains()
     TEST(contains(QVectorNumbers, 1), true);
     TEST(contains(QSetNumbers, 4), true);
     TEST(contains(stringList, "bbbb"), true);
+    
+    vector<int> manyNumbers = range<vector>(1, 1001);
+    TEST(contains(manyNumbers, 1000), true);
+    TEST(contains(manyNumbers, 1001), false);
+    TEST(contains(manyNumbers, 500.0), true);
+    TEST(contains(vector<double>({0.5, 1.5}), 1.5), true);
+    
+    TEST(contains(unordered_set<int>({1, 2, 3}), 2), true);
+    TEST(contains(multiset<int>({1, 1, 5}), 5), true);
+    TEST(contains(setNumbers, 4.5), false);
+    TEST(contains(unordered_map<int, QString>({{1, "a"}, {2, "b"}}), 2), true);
+    TEST(contains(unordered_map<int, QString>({{1, "a"}, {2, "b"}}), 3), false);
+    TEST(contains(QHash<QString, int>({{"a", 1}}), 1), true);
+    TEST(contains(QHash<int, int>({{1, 2}}), 1), false);
+    TEST(contains(QMap<int, int>({{1, 2}}), 2), true);
+    TEST(containsKey(QHash<QString, int>({{"a", 1}}), "a"), true);
+    TEST(containsKey(QMap<int, int>({{1, 2}}), 2), false);
+    TEST(containsKey(unordered_map<int, QString>({{1, "a"}}), 1), true);
+    TEST(omit(vectorNumbers, QHash<int, int>({{1, 2}, {3, 4}})), vector<int>({1, 3, 5}));
+    
+    auto numberIndex = index(manyNumbers);
+    TEST(numberIndex.size(), size_t(1000));
+    TEST(contains(numberIndex, 1000), true);
+    TEST(contains(numberIndex, 1001), false);
+    TEST(numberIndex(500), true);
+    TEST(filter(vector<int>({0, 1, 999, 1001}), numberIndex), vector<int>({1, 999}));
+    TEST(filter(stringList, index(QStringList({"a", "ccc"}))), QStringList({"ccc"}));
+    TEST(index(vector<Foo>({fooA, fooB})).contains(fooB), true);
+    auto rangeIndex = index(range(0, 2000));
+    TEST(rangeIndex.contains(1999), true);
+    TEST(rangeIndex.contains(2000), false);
+    TEST(omit(manyNumbers, index(range(1, 999))), vector<int>({999, 1000}));
+    TEST(index(vector<bool>({false})).contains(true), false);
 }
 
 void testOmit()
@@ -619,6 +938,66 @@ void testOmit()
     TEST(omit<QLinkedList>(vectorNumbers, list<int>({1, 2, 3})), QLinkedList<int>({4, 5}));
     TEST(omit(string("abcde"), 'a'), string("bcde"));
     TEST(omit(string("abcde"), string("ace")), string("bd"));
+    
+    TEST(omit(vector<int>({1, 2, 3, 2}), 2), vector<int>({1, 3}));
+    TEST(omit(set<int>({1, 2, 3, 4, 5}), list<int>({1, 2, 3})), set<int>({4, 5}));
+    TEST(omit(QList<int>({1, 2, 3, 4, 5}), set<int>({1, 2, 3})), QList<int>({4, 5}));
+    TEST(omit<set>(vector<int>({1, 2, 3, 2}), 2), set<int>({1, 3}));
+    TEST(omit<QList>(vector<int>({1, 2, 3, 4, 5}), list<int>({1, 2, 3})), QList<int>({4, 5}));
+    
+    vector<int> manyNumbers = range<vector>(0, 100);
+    vector<int> manyEvenNumbers = range<vector>(0, 100, 2);
+    vector<int> manyOddNumbers = range<vector>(1, 100, 2);
+    TEST(omit(manyNumbers, manyEvenNumbers), manyOddNumbers);
+    TEST(omit(manyNumbers, reversed(manyEvenNumbers)), manyOddNumbers);
+    TEST(omit(reversed(manyNumbers), manyEvenNumbers), reversed(manyOddNumbers));
+    TEST(omit<list>(manyNumbers, list<int>(manyEvenNumbers.begin(), manyEvenNumbers.end())), list<int>(manyOddNumbers.begin(), manyOddNumbers.end()));
+    TEST(omit(vector<Foo>(manyNumbers.begin(), manyNumbers.end()), vector<Foo>(manyEvenNumbers.rbegin(), manyEvenNumbers.rend())),
+         vector<Foo>(manyOddNumbers.begin(), manyOddNumbers.end()));
+    TEST(omit(map(manyNumbers, [] (int x) { return QString::number(x); }), map(manyEvenNumbers, [] (int x) { return QString::number(x); })),
+         map(manyOddNumbers, [] (int x) { return QString::number(x); }));
+    TEST(omit(manyNumbers, index(manyEvenNumbers)), manyOddNumbers);
+    TEST(omit<list>(manyNumbers, index(vector<int>(manyEvenNumbers))), list<int>(manyOddNumbers.begin(), manyOddNumbers.end()));
+}
+
+void testIntersect()
+{
+    TEST(intersect(listNumbers, list<int>({2, 4, 6})), list<int>({2, 4}));
+    TEST(intersect(vectorNumbers, set<int>({2, 4, 6})), vector<int>({2, 4}));
+    TEST(intersect(vector<int>({5, 1, 4, 2, 3}), list<int>({2, 4, 6})), vector<int>({4, 2}));
+    TEST(intersect(vector<int>({1, 2, 2, 3}), vector<int>({2})), vector<int>({2, 2}));
+    TEST(intersect(listFoos, list<Foo>({fooB, fooD})), list<Foo>({fooB, fooD}));
+    TEST(intersect(QListNumbers, QSet<int>({1, 5})), QList<int>({1, 5}));
+    TEST(intersect<set>(vectorNumbers, list<int>({2, 4, 6})), set<int>({2, 4}));
+    TEST(intersect(vectorNumbers, list<int>()), vector<int>());
+    
+    vector<int> manyNumbers = range<vector>(0, 100);
+    vector<int> manyEvenNumbers = range<vector>(0, 100, 2);
+    TEST(intersect(manyNumbers, manyEvenNumbers), manyEvenNumbers);
+    TEST(intersect(manyNumbers, reversed(manyEvenNumbers)), manyEvenNumbers);
+    TEST(intersect(reversed(manyNumbers), manyEvenNumbers), reversed(manyEvenNumbers));
+}
+
+void testUnionOf()
+{
+    TEST(unionOf(vector<int>({3, 1, 2}), list<int>({2, 4, 1, 5})), vector<int>({3, 1, 2, 4, 5}));
+    TEST(unionOf(listNumbers, set<int>({4, 5, 6})), list<int>({1, 2, 3, 4, 5, 6}));
+    TEST(unionOf(setNumbers, vector<int>({0, 6})), set<int>({0, 1, 2, 3, 4, 5, 6}));
+    TEST(unionOf(listFoos, list<Foo>({fooA, Foo(100)})), list<Foo>({fooA, fooB, fooC, fooD, fooE, Foo(100)}));
+    TEST(unionOf<QList>(vectorNumbers, list<int>({6})), QList<int>({1, 2, 3, 4, 5, 6}));
+    TEST(unionOf(vector<int>(), list<int>({1, 2})), vector<int>({1, 2}));
+    
+    vector<int> manyEvenNumbers = range<vector>(0, 100, 2);
+    vector<int> manyOddNumbers = range<vector>(1, 100, 2);
+    TEST(sorted(unionOf(manyEvenNumbers, manyOddNumbers)), range<vector>(0, 100));
+    TEST(unionOf(manyEvenNumbers, range<vector>(0, 100)), unionOf(manyEvenNumbers, manyOddNumbers));
+}
+
+void testDifference()
+{
+    TEST(difference(vector<int>({5, 1, 4, 2, 3}), list<int>({2, 4, 6})), vector<int>({5, 1, 3}));
+    TEST(difference(setNumbers, set<int>({1, 2, 3})), set<int>({4, 5}));
+    TEST(difference<list>(vectorNumbers, QSet<int>({1, 2, 3})), list<int>({4, 5}));
 }
 
 void testReversed()
@@ -629,6 +1008,13 @@ void testReversed()
     TEST(reversed(QListNumbers), QList<int>({5, 4, 3, 2, 1}));
     TEST(reversed(QVectorNumbers), QVector<int>({5, 4, 3, 2, 1}));
     TEST(reversed(QLinkedListNumbers), QLinkedList<int>({5, 4, 3, 2, 1}));
+    
+    TEST(reversed(list<int>({1, 2, 3, 4, 5})), list<int>({5, 4, 3, 2, 1}));
+    TEST(reversed(vector<int>({1, 2, 3, 4, 5})), vector<int>({5, 4, 3, 2, 1}));
+    TEST(reversed(forward_list<int>({1, 2, 3, 4, 5})), forward_list<int>({5, 4, 3, 2, 1}));
+    TEST(reversed(set<int>({1, 2, 3, 4, 5})), setNumbers);
+    TEST(reversed(QList<int>({1, 2, 3, 4, 5})), QList<int>({5, 4, 3, 2, 1}));
+    TEST(reversed(QLinkedList<int>({1, 2, 3, 4, 5})), QLinkedList<int>({5, 4, 3, 2, 1}));
 }
 
 void testFirst()
@@ -687,6 +1073,9 @@ void testRange()
     TEST(range<set>(1, 6, 2), set<int>({1, 3, 5}));
     TEST(range<set>(1, 6), setNumbers);
     TEST(range<set>(5), set<int>({0, 1, 2, 3, 4}));
+    TEST(range<unordered_set>(5), unordered_set<int>({0, 1, 2, 3, 4}));
+    TEST(range<vector>(1, 6, 2).capacity(), size_t(3));
+    TEST(range<vector>(-1, -6, -1).capacity(), size_t(5));
     
     TEST(range<QList>(1, 6, 1), QListNumbers);
     TEST(range<QList>(5, 0, -1), reversed(QListNumbers));
@@ -715,6 +1104,48 @@ void testRange()
     TEST(range<QLinkedList>(1, 6, 2), QLinkedList<int>({1, 3, 5}));
     TEST(range<QLinkedList>(1, 6), QLinkedListNumbers);
     TEST(range<QLinkedList>(5), QLinkedList<int>({0, 1, 2, 3, 4}));
+    TEST(range<vector>(2147483640, 2147483647, 3), vector<int>({2147483640, 2147483643, 2147483646}));
+    
+    // Lazy ranges
+    const auto lazy = range(5, 0, -1);
+    TEST(lazy.size(), size_t(5));
+    TEST(lazy[1], 4);
+    TEST(vector<int>(lazy.begin(), lazy.end()), reversed(vectorNumbers));
+    TEST(range(1, 6), range(1, 6, 1));
+    TEST(range(5).size(), size_t(5));
+    TEST(range(1, 6, 2).size(), size_t(3));
+    TEST(range(6, 1).empty(), true);
+    TEST(range(1, 6, 0).empty(), true);
+    TEST(range(10u, 0u, -3).size(), size_t(4));
+    TEST(range(10u, 0u, -3)[3], 1u);
+    TEST(range(0.0, 1.0, 0.25).size(), size_t(4));
+    TEST(range(0.0, 1.0, 0.25)[3], 0.75);
+    TEST(range(-5, 5u).size(), size_t(10));
+    TEST(range(-1, vectorNumbers.size())[0], -1LL);
+    TEST(range(-1, vectorNumbers.size()).size(), size_t(6));
+    TEST((is_same<decltype(range(short(0), short(5))), LazyRange<short> >::value), true);
+    TEST(range(short(0), short(5))[4], short(4));
+    TEST(range(uint8_t(200)).size(), size_t(200));
+    TEST(int(range(uint8_t(200))[199]), 199);
+    TEST(mapRange<vector>(short(3), [] (short x) { return x*2; }), vector<int>({0, 2, 4}));
+    TEST(range(0, 5000000000LL).size(), size_t(5000000000LL));
+    TEST(range(0, 5000000000LL)[4999999999LL], 4999999999LL);
+    TEST(range(INT64_MIN, INT64_MAX, INT64_MAX)[2], INT64_MAX - 1);
+    TEST(*(range(5).end() - 1), 4);
+    TEST(::map(range(1, 6), [] (int x) { return x; }), vectorNumbers);
+    TEST(::map<list>(range(1, 6), [] (int x) { return Foo(x); }), listFoos);
+    TEST(filter(range(1, 6), isEven), vector<int>({2, 4}));
+    TEST(filter<set>(lazy, isEven), set<int>({2, 4}));
+    TEST(reject(range(1, 6), isEven), vector<int>({1, 3, 5}));
+    TEST(compr(range(1, 6), [] (int x) { return Foo(x); }, isEven), vector<Foo>({fooB, fooD}));
+    TEST(reduce(range(1, 6), [] (int a, int b) { return a*b; }), 120);
+    TEST(sum(range(1, 6)), 15);
+    TEST(sum(range(0, 100000000LL)), 4999999950000000LL);
+    TEST(allOf(range(1, 6), [] (int x) { return x > 0; }), true);
+    TEST(anyOf(range(1, 6), [] (int x) { return x > 5; }), false);
+    TEST(min(lazy), 1);
+    TEST(max(lazy, [] (int x) { return -x; }), 1);
+    TEST(last(lazy), 1);
 }
 
 void testMapRange()
@@ -806,6 +1237,17 @@ void testMapRange()
     TEST(mapRange<QLinkedList>(1, 6, 1, [] (int x) { return x; }, [] (int x) { return (x%2) == 0; }), QLinkedList<int>({2, 4}));
     TEST(mapRange<QLinkedList>(1, 6, [] (int x) { return x; }, [] (int x) { return (x%2) == 0; }), QLinkedList<int>({2, 4}));
     TEST(mapRange<QLinkedList>(5, [] (int x) { return x+1; }, [] (int x) { return (x%2) == 0; }), QLinkedList<int>({1, 3, 5}));
+    
+    // Lazy mapRange
+    TEST(mapRange(1, 6, 1, [] (int x) { return x; }).to<vector>(), vectorNumbers);
+    TEST(mapRange(5, 0, -1, [] (int x) { return Foo(x); }).to<vector>(), reversed(vectorFoos));
+    TEST(mapRange(1, 6, [] (int x) { return x; }).to<list>(), listNumbers);
+    TEST(mapRange(5, [] (int x) { return x+1; }).to<set>(), setNumbers);
+    TEST(mapRange(1, 6, 1, [] (int x) { return x; }, [] (int x) { return (x%2) == 0; }).to<vector>(), vector<int>({2, 4}));
+    TEST(mapRange(1, 6, [] (int x) { return Foo(x); }, [] (int x) { return (x%2) == 0; }).to<vector>(), vector<Foo>({fooB, fooD}));
+    TEST(mapRange(5, [] (int x) { return x+1; }, [] (int x) { return (x%2) == 0; }).to<QList>(), QList<int>({1, 3, 5}));
+    TEST(sum(mapRange(0LL, 3000000000LL, 1000000000LL, [] (long long x) { return x/1000000000; })), 3LL);
+    TEST(first(mapRange(1000000000, [] (int x) { return x*2; }, [] (int x) { return x > 10; })), 22);
 }
 
 void testFlatten()
@@ -833,8 +1275,396 @@ void testFlatten()
     TEST(flatten<list>(std::vector<std::vector<int> >({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}})), std::list<int>({1,2,3,4,5,6,7,8,9}));
     TEST(flatten<list>(std::list<std::vector<int> >({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}})), std::list<int>({1,2,3,4,5,6,7,8,9}));
     TEST(flatten<set>(std::list<std::set<int> >({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}})), std::set<int>({1,2,3,4,5,6,7,8,9}));
+    TEST(flatten(std::vector<std::string>({"ab", "", "c"})), std::string("abc"));
+    TEST(flatten(std::vector<std::vector<std::string> >({{"a", "b"}, {}, {"c"}})), std::vector<std::string>({"a", "b", "c"}));
+    TEST(flatten(std::vector<std::vector<int> >({{1, 2, 3}, {4, 5, 6}, {7, 8, 9}})).capacity(), size_t(9));
+}
+
+void testFlatMap()
+{
+    const auto repeat = [] (int x) { return std::vector<int>(x, x); };
+    const vector<vector<string> > groups = {{"a", "b"}, {}, {"c"}};
+    
+    TEST(flatMap(vectorNumbers, repeat), std::vector<int>({1, 2, 2, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 5}));
+    TEST(flatMap(listNumbers, [] (int x) { return std::list<int>({x, -x}); }), std::list<int>({1, -1, 2, -2, 3, -3, 4, -4, 5, -5}));
+    TEST(flatMap<set>(vectorNumbers, repeat), setNumbers);
+    TEST(flatMap<vector>(QListNumbers, [] (int x) { return QVector<int>({x*2}); }), std::vector<int>({2, 4, 6, 8, 10}));
+    TEST(flatMap(QVectorFoos, [] (const Foo &foo) { return QList<Foo>({foo, foo}); }), QVector<Foo>({fooA, fooA, fooB, fooB, fooC, fooC, fooD, fooD, fooE, fooE}));
+    TEST(flatMap(vector<int>(), repeat), vector<int>());
+    
+    // References to containers are copied from rather than moved from
+    TEST(flatMap(groups, [] (const vector<string> &group) -> const vector<string> & { return group; }), vector<string>({"a", "b", "c"}));
+    TEST(groups[0], vector<string>({"a", "b"}));
+    TEST(flatMap(groups, [] (const vector<string> &group) { return ::map(group, [] (const string &s) { return s + s; }); }), vector<string>({"aa", "bb", "cc"}));
+}
+
+void testInto()
+{
+    vector<int> buffer;
+    TEST(::mapInto(buffer, vectorNumbers, timesTwo), vector<int>({2, 4, 6, 8, 10}));
+    
+    // Reusing the buffer keeps its storage
+    const int *bufferData = buffer.data();
+    TEST(filterInto(buffer, vectorNumbers, isEven), vector<int>({2, 4}));
+    TEST(buffer.data(), bufferData);
+    TEST(rejectInto(buffer, listNumbers, isEven), vector<int>({1, 3, 5}));
+    TEST(comprInto(buffer, QVectorNumbers, timesTwo, isEven), vector<int>({4, 8}));
+    TEST(flattenInto(buffer, std::list<std::vector<int> >({{1, 2}, {3}})), vector<int>({1, 2, 3}));
+    TEST(rangeInto(buffer, 1, 10, 3), vector<int>({1, 4, 7}));
+    TEST(mapRangeInto(buffer, 4, timesTwo), vector<int>({0, 2, 4, 6}));
+    TEST(mapRangeInto(buffer, 6, [] (int x) { return x+1; }, isEven), vector<int>({1, 3, 5}));
+    
+    QSet<int> qset;
+    TEST(filterInto(qset, vectorNumbers, isEven), QSet<int>({2, 4}));
+    
+    QStringList strings;
+    TEST(::mapInto(strings, stringList, [] (const QString &x) { return x.toUpper(); }), QStringList({"AAAAA", "BBBB", "CCC", "DD", "E"}));
+    
+    std::list<int> appended = {0};
+    ::mapInto(std::back_inserter(appended), vectorNumbers, timesTwo);
+    TEST(appended, std::list<int>({0, 2, 4, 6, 8, 10}));
+    
+    int array[5] = {};
+    TEST(filterInto(array, vectorNumbers, isEven) - array, 2);
+    TEST(array[1], 4);
+}
+
+void testView()
+{
+    int mapCalls = 0;
+    auto numbersView = view(vectorNumbers) | mapped([&mapCalls] (int x) { ++mapCalls; return x*2; })
+                                           | filtered([] (int x) { return x > 2; })
+                                           | rejected([] (int x) { return x == 8; });
+    TEST(mapCalls, 0);
+    TEST(numbersView.to<vector>(), vector<int>({4, 6, 10}));
+    TEST(mapCalls, 5);
+    TEST(numbersView.to<QList>(), QList<int>({4, 6, 10}));
+    TEST(numbersView.to<set<int> >(), set<int>({4, 6, 10}));
+    TEST(sum(numbersView), 20);
+    TEST(sum(numbersView, 100), 120);
+    TEST(reduce(numbersView, [] (int a, int b) { return a*b; }), 240);
+    TEST(reduce(numbersView, [] (const QString &a, int b) { return a + QString::number(b); }, QString("")), QString("4610"));
+    TEST(allOf(numbersView, &isEven), true);
+    TEST(anyOf(numbersView, [] (int x) { return x == 8; }), false);
+    
+    mapCalls = 0;
+    TEST(first(numbersView), 4);
+    TEST(mapCalls, 2);
+    TEST(first(view(listNumbers) | filtered([] (int x) { return x > 100; })), 0);
+    TEST(first(view(listNumbers) | filtered([] (int x) { return x > 100; }), 42), 42);
+    
+    TEST((view(listFoos) | filtered(&Foo::isEven) | mapped(&Foo::fooTimesTwo)).to<list>(), list<int>({4, 8}));
+    TEST((view(QListFooPtrs) | rejected(&Foo::isEven) | mapped(&Foo::getValue)).to<QVector>(), QVector<int>({1, 3, 5}));
+    TEST((view(stringList) | mapped(&QString::toUpper)).to<QStringList>(), QStringList({"AAAAA", "BBBB", "CCC", "DD", "E"}));
+    TEST((view(vector<int>({3, 4})) | mapped(&timesTwo)).to<vector>(), vector<int>({6, 8}));
+}
+
+void testZip()
+{
+    typedef tuple<const int &, const Foo &> NumberAndFoo;
+    typedef tuple<size_t, const QString &> IndexAndString;
+    const auto valuesMatch = [] (const NumberAndFoo &t) { return get<0>(t) == get<1>(t).getValue(); };
+    
+    TEST(zip(listNumbers, vectorFoos).to<vector>(), (vector<tuple<int, Foo> >({make_tuple(1, fooA), make_tuple(2, fooB), make_tuple(3, fooC),
+                                                                                make_tuple(4, fooD), make_tuple(5, fooE)})));
+    TEST(zip(vectorNumbers, QLinkedList<int>({5, 4, 3})).to<list>(), (list<tuple<int, int> >({make_tuple(1, 5), make_tuple(2, 4), make_tuple(3, 3)})));
+    TEST(zip(vectorNumbers, listNumbers, QListNumbers).to<vector>().size(), size_t(5));
+    TEST(zip(vector<int>(), listFoos).to<vector>().empty(), true);
+    TEST(allOf(zip(listNumbers, listFoos), valuesMatch), true);
+    TEST(anyOf(zip(listNumbers, reversed(listFoos)), valuesMatch), true);
+    TEST(reduce(zip(vectorNumbers, listFoos), [] (int memo, const NumberAndFoo &t) { return memo + get<0>(t)*get<1>(t).getValue(); }, 0), 55);
+    TEST(filter(zip(listNumbers, reversed(vectorFoos)), valuesMatch), (vector<tuple<int, Foo> >({make_tuple(3, fooC)})));
+    TEST((zip(listNumbers, listFoos) | rejected([] (const NumberAndFoo &t) { return get<1>(t).isEven(); })
+                                     | mapped([] (const NumberAndFoo &t) { return get<0>(t); })).to<QList>(), QList<int>({1, 3, 5}));
+    
+    TEST(enumerate(stringList).to<vector>(), (vector<tuple<size_t, QString> >({make_tuple(0, "aaaaa"), make_tuple(1, "bbbb"), make_tuple(2, "ccc"),
+                                                                               make_tuple(3, "dd"), make_tuple(4, "e")})));
+    TEST(allOf(enumerate(stringList), [] (const IndexAndString &t) { return get<0>(t) + get<1>(t).size() == 5; }), true);
+    TEST(::map(enumerate(QLinkedList<QString>({"a", "b"})), [] (const IndexAndString &t) { return get<1>(t) + QString::number(get<0>(t)); }),
+         vector<QString>({"a0", "b1"}));
+    
+    TEST(mapWith(vectorNumbers, listFoos, [] (int x, const Foo &foo) { return x + foo.getValue(); }), vector<int>({2, 4, 6, 8, 10}));
+    TEST(mapWith(listNumbers, QLinkedListNumbers, [] (int a, int b) { return a*b; }), list<int>({1, 4, 9, 16, 25}));
+    TEST(mapWith<QVector>(stringList, range(3), [] (const QString &s, int i) { return s.size() + i; }), QVector<int>({5, 5, 5}));
+}
+
+void testChunked()
+{
+    typedef SliceOf<vector<int> > VectorSlice;
+    typedef SliceOf<list<int> > ListSlice;
+    typedef SliceOf<QStringList> StringSlice;
+    const auto sumSlice = [] (const VectorSlice &slice) { return sum(slice); };
+    
+    TEST(::map(chunked(vectorNumbers, 2), sumSlice), vector<int>({3, 7, 5}));
+    TEST(::map(chunked(listNumbers, 3), [] (const ListSlice &slice) { return slice.size(); }), vector<size_t>({3, 2}));
+    TEST(::map(chunked(stringList, 5), [] (const StringSlice &slice) { return slice[4]; }), vector<QString>({"e"}));
+    TEST(::map(chunked(vectorNumbers, 0), sumSlice).empty(), true);
+    TEST(::map(chunked(vector<int>(), 2), sumSlice).empty(), true);
+    TEST(reduce(chunked(vectorNumbers, 2), [] (int memo, const VectorSlice &slice) { return memo + max(slice); }, 0), 11);
+    TEST(reduce(chunked(vector<int>({1, 2, 3}), 2), [] (int memo, const VectorSlice &slice) { return memo + sum(slice); }, 0), 6);
+    TEST(allOf(chunked(listNumbers, 2), [] (const ListSlice &slice) { return !slice.empty(); }), true);
+    
+    TEST(::map(windowed(vectorNumbers, 3), sumSlice), vector<int>({6, 9, 12}));
+    TEST(::map(windowed(vectorNumbers, 2, 2), sumSlice), vector<int>({3, 7}));
+    TEST(::map(windowed(listNumbers, 1, 3), [] (const ListSlice &slice) { return slice.front(); }), vector<int>({1, 4}));
+    TEST(::map(windowed(vectorNumbers, 6), sumSlice).empty(), true);
+    TEST(::map(windowed(vectorNumbers, 2, 0), sumSlice).empty(), true);
+    
+    const VectorSlice slice = first(chunked(vectorNumbers, 4));
+    TEST(::map(slice, [] (int x) { return x*2; }), vector<int>({2, 4, 6, 8}));
+    TEST(filter(slice, isEven), vector<int>({2, 4}));
+    TEST(reject<list>(slice, isEven), list<int>({1, 3}));
+    TEST(contains(slice, 4), true);
+    TEST(contains(slice, 5), false);
+}
+
+void testSmallVector()
+{
+    const SmallVector<int> smallNumbers = {1, 2, 3, 4, 5};
+    const auto isOdd = [] (int x) { return (x%2) == 1; };
+    
+    TEST(filter<SmallVector>(vectorNumbers, isEven), SmallVector<int>({2, 4}));
+    TEST(filter<SmallVector>(range<vector>(100), [] (int x) { return x == 50; }).isInline(), true);
+    TEST(compr<SmallVector>(range<vector>(100), &timesTwo, [] (int x) { return x == 50; }).isInline(), true);
+    TEST(::map<SmallVector>(range<vector>(100), &timesTwo).capacity(), size_t(100));
+    TEST(flatten<SmallVector>(vector<vector<int> >(20, vectorNumbers)).capacity(), size_t(100));
+    TEST(is_nothrow_move_constructible<SmallVector<int> >::value, true);
+    TEST(is_nothrow_move_assignable<SmallVector<QString> >::value, true);
+    TEST(compr<SmallVector>(listNumbers, &timesTwo, isOdd), SmallVector<int>({2, 6, 10}));
+    TEST(omit<SmallVector>(QVectorNumbers, listNumbers), SmallVector<int>());
+    TEST(reject<SmallVectorOf<2>::type>(listFoos, &Foo::isEven), (SmallVectorOf<2>::type<Foo>({fooA, fooC, fooE})));
+    TEST(::map<SmallVector>(stringList, [] (const QString &s) { return s.size(); }), SmallVector<int>({5, 4, 3, 2, 1}));
+    
+    TEST(::map(smallNumbers, &timesTwo), SmallVector<int>({2, 4, 6, 8, 10}));
+    TEST(filter(smallNumbers, isOdd), SmallVector<int>({1, 3, 5}));
+    TEST(filter<list>(smallNumbers, isOdd), list<int>({1, 3, 5}));
+    TEST(reject(SmallVector<int>(smallNumbers), isOdd), SmallVector<int>({2, 4}));
+    TEST(sum(smallNumbers), 15);
+    TEST(max(smallNumbers), 5);
+    TEST(reduce(smallNumbers, [] (int a, int b) { return a*b; }), 120);
+    TEST(contains(smallNumbers, 3), true);
+    TEST(sorted(SmallVector<int>({3, 1, 2})), SmallVector<int>({1, 2, 3}));
+    TEST(reversed(smallNumbers), SmallVector<int>({5, 4, 3, 2, 1}));
+    TEST(last(smallNumbers), 5);
+    
+    SmallVectorOf<2>::type<QString> strings(stringList.begin(), stringList.end());
+    TEST(strings.isInline(), false);
+    TEST(strings.size(), size_t(5));
+    TEST(::map(strings, [] (const QString &s) { return s.size(); }), (SmallVectorOf<2>::type<int>({5, 4, 3, 2, 1})));
+    strings.erase(strings.begin() + 1, strings.end());
+    TEST(SmallVector<QString>(std::move(strings)), SmallVector<QString>({"aaaaa"}));
+}
+
+#ifdef FUNC_HELPERS_PROFILE
+void testProfile()
+{
+    resetProfile();
+    
+    {
+        FUNC_HELPERS_PROFILE_SITE("evens");
+        filter(vectorNumbers, isEven);
+        filter(listNumbers, isEven);
+        ::map(listNumbers, &timesTwo);
+    }
+    
+    vector<HelperProfile> profiles = profileSnapshot();
+    TEST(profiles.size(), size_t(2));
+    TEST(profiles[0].helper, string("filter"));
+    TEST(profiles[0].site, string("evens"));
+    TEST(profiles[0].line > 0, true);
+    TEST(profiles[0].calls, 2ULL);
+    TEST(profiles[0].visited, 10ULL);
+    TEST(profiles[0].invocations, 10ULL);
+    TEST(profiles[0].added, 4ULL);
+    TEST(profiles[0].outputItems, 4ULL);
+    TEST(profiles[0].largestOutput, 2ULL);
+    TEST(profiles[1].helper, string("map"));
+    TEST(profiles[1].visited, 5ULL);
+    TEST(profiles[1].outputItems, 5ULL);
+    
+    // Results are reserved when the size of container is known, so only the
+    // forward_list makes the vector reallocate.
+    resetProfile();
+    vector<int> reserved;
+    vector<int> grown;
+    mapInto(reserved, listNumbers, &timesTwo);
+    comprInto(grown, forward_list<int>(listNumbers.begin(), listNumbers.end()), &timesTwo, isEven);
+    profiles = profileSnapshot();
+    TEST(profiles.size(), size_t(2));
+    TEST(profiles[0].helper, string("comprInto"));
+    TEST(profiles[0].site, string());
+    TEST(profiles[0].invocations, 7ULL);
+    TEST(profiles[0].reallocations > 0, true);
+    TEST(profiles[1].helper, string("mapInto"));
+    TEST(profiles[1].reallocations, 0ULL);
+    
+    // Helpers called by func get their own counts, and threads that have
+    // exited are still included.
+    resetProfile();
+    std::thread([] {
+        ::map(vectorNumbers, [] (int x) { return filter(range<vector>(x), isEven).size(); });
+    }).join();
+    profiles = profileSnapshot();
+    TEST(profiles.size(), size_t(2));
+    TEST(profiles[0].calls, 5ULL);
+    TEST(profiles[0].visited, 15ULL);
+    TEST(profiles[1].calls, 1ULL);
+    TEST(profiles[1].visited, 5ULL);
+    
+    // Code that helpers share, like moving items out of a temporary, counts
+    // into the helper that called it rather than the one calling func.
+    resetProfile();
+    ::map(vectorNumbers, [] (int x) { return omit<list>(range<vector>(x), 0).size(); });
+    profiles = profileSnapshot();
+    TEST(profiles.size(), size_t(2));
+    TEST(profiles[0].helper, string("map"));
+    TEST(profiles[0].visited, 5ULL);
+    TEST(profiles[1].helper, string("omit"));
+    TEST(profiles[1].calls, 5ULL);
+    TEST(profiles[1].visited, 15ULL);
+    resetProfile();
+    TEST(profileSnapshot().empty(), true);
+}
+#endif
+
+void testParallel()
+{
+    // A small minimum chunk size so that even these small containers get
+    // split up between threads
+    const ParallelPolicy policy = par.withMinChunkSize(2);
+    const ParallelPolicy unorderedPolicy = parUnordered.withMinChunkSize(2);
+    const vector<int> numbers = range<vector>(1000);
+    const auto times2 = [] (int x) { return x*2; };
+    const auto isOdd = [] (int x) { return (x%2) == 1; };
+    
+    TEST(::map(policy, numbers, times2), ::map(numbers, times2));
+    TEST(::map<list>(policy, numbers, times2), ::map<list>(numbers, times2));
+    TEST(::map(unorderedPolicy, numbers, times2), ::map(numbers, times2));
+    TEST(::map(policy, vectorFoos, &Foo::fooTimesTwo), vector<int>({2, 4, 6, 8, 10}));
+    TEST(::map(policy, QVectorNumbers, times2), QVector<int>({2, 4, 6, 8, 10}));
+    TEST(::map(policy, listNumbers, times2), listEvenNumbers);
+    TEST(compr(policy, numbers, times2, isOdd), compr(numbers, times2, isOdd));
+    TEST(compr<QSet>(unorderedPolicy, numbers, times2, isOdd), compr<QSet>(numbers, times2, isOdd));
+    TEST(filter(policy, numbers, isOdd), filter(numbers, isOdd));
+    TEST(filter(policy, vectorFooPtrs, &Foo::isEven), vector<Foo *>({&fooB, &fooD}));
+    TEST(sorted(filter(unorderedPolicy, numbers, isOdd)), filter(numbers, isOdd));
+    TEST(filter<set>(unorderedPolicy, numbers, isOdd), filter<set>(numbers, isOdd));
+    TEST(reject(policy, numbers, isOdd), reject(numbers, isOdd));
+    TEST(reject<QList>(policy, QVectorFoos, &Foo::isEven), QList<Foo>({fooA, fooC, fooE}));
+    
+    const auto byTens = [] (int a, int b) { return a/10 < b/10; };
+    TEST(sorted(policy, shuffledNumbers), numbers);
+    TEST(sorted(policy, vector<int>(shuffledNumbers)), numbers);
+    TEST(sorted(policy, shuffledNumbers, [] (int a, int b) { return a > b; }), sorted(numbers, [] (int a, int b) { return a > b; }));
+    TEST(sorted(policy, QVector<Foo>({fooC, fooB, fooD, fooE, fooA}), &Foo::isLessThan), QVectorFoos);
+    TEST(sorted(policy, list<int>({3,5,1,4,2})), listNumbers);
+    TEST(stableSorted(policy, shuffledNumbers, byTens), stableSorted(shuffledNumbers, byTens));
+    TEST(stableSorted(policy.withThreads(3), shuffledNumbers, byTens), stableSorted(shuffledNumbers, byTens));
+    TEST(stableSorted(policy, vector<int>(shuffledNumbers)), numbers);
+    
+    // Enough values for several blocks, so that the sums depend on the order
+    // they're added in
+    const vector<double> fractions = mapRange<vector>(10000, [] (int x) { return 1.0 / (x + 1); });
+    const list<double> fractionList(fractions.begin(), fractions.end());
+    const auto add = [] (double a, double b) { return a + b; };
+    const auto countOdd = [] (int memo, int x) { return memo + (x%2); };
+    const auto byLastDigit = [] (int x) { return x % 10; };
+    TEST(sum(policy, fractions), sum(policy.withThreads(1), fractions));
+    TEST(sum(policy.withThreads(3), fractions), sum(policy.withThreads(1), fractions));
+    TEST(reduce(policy, fractions, add), reduce(policy.withThreads(1), fractions, add));
+    TEST(reduce(policy, fractionList, add), reduce(policy.withThreads(3), fractionList, add));
+    TEST(reduce(policy, numbers, std::plus<int>()), sum(numbers));
+    TEST(reduce(policy, numbers, std::plus<int>(), 10), sum(numbers, 10));
+    TEST(reduce(policy, vector<int>(), std::plus<int>(), 10), 10);
+    TEST(reduce(policy, numbers, countOdd, 0, std::plus<int>()), 500);
+    TEST(reduce(policy, stringList, [] (int memo, const QString &s) { return memo + s.size(); }, 0, std::plus<int>()), 15);
+    TEST(sum(policy, numbers, 10), sum(numbers, 10));
+    TEST(sum(policy, listNumbers), 15);
+    TEST(min(policy, shuffledNumbers), 0);
+    TEST(max(policy, shuffledNumbers), 999);
+    TEST(min(policy, shuffledNumbers, byLastDigit), min(shuffledNumbers, byLastDigit));
+    TEST(max(policy, shuffledNumbers, byLastDigit), max(shuffledNumbers, byLastDigit));
+    TEST(max(policy, vectorFoos, &Foo::fooTimesTwo), fooE);
+    TEST(extremum(policy, shuffledNumbers, [] (int a, int b) { return a%7 < b%7; }), extremum(shuffledNumbers, [] (int a, int b) { return a%7 < b%7; }));
+    TEST(min(policy, vector<int>()), 0);
+    
+    TEST(groupBy(policy, shuffledNumbers, byLastDigit), groupBy(shuffledNumbers, byLastDigit));
+    TEST(groupBy<list>(policy.withThreads(3), shuffledNumbers, byLastDigit), groupBy<list>(shuffledNumbers, byLastDigit));
+    TEST(groupBy(policy, QVectorFoos, &Foo::isEven), (QHash<bool, QVector<Foo> >({{true, {fooB, fooD}}, {false, {fooA, fooC, fooE}}})));
+    TEST(groupBy(policy, listNumbers, &isEven), groupBy(listNumbers, &isEven));
+    TEST(countBy(policy, shuffledNumbers, byLastDigit), countBy(shuffledNumbers, byLastDigit));
+    TEST(countBy(policy, shuffledNumbers, byLastDigit).at(7), size_t(100));
+    TEST(keyBy(policy, shuffledNumbers, byLastDigit), keyBy(shuffledNumbers, byLastDigit));
+    TEST(keyBy(policy, numbers, byLastDigit).at(7), 997);
+}
+
+#if __cplusplus >= 201703L
+
+void testPmr()
+{
+    std::pmr::monotonic_buffer_resource arena;
+    const auto times2 = [] (int x) { return x*2; };
+    const auto isOdd = [] (int x) { return (x%2) == 1; };
+    
+    std::pmr::vector<int> doubled = ::map(&arena, vectorNumbers, times2);
+    TEST(doubled, std::pmr::vector<int>({2, 4, 6, 8, 10}));
+    TEST(doubled.get_allocator().resource(), &arena);
+    TEST(::map<std::pmr::list>(&arena, vectorNumbers, times2).get_allocator().resource(), &arena);
+    TEST(::map<QVector>(&arena, vectorNumbers, times2), QVector<int>({2, 4, 6, 8, 10}));
+    TEST(::map(doubled, times2).get_allocator().resource(), &arena);
+    TEST(compr(doubled, times2, [] (int x) { return x > 4; }), std::pmr::vector<int>({12, 16, 20}));
+    TEST(filter(&arena, listNumbers, isOdd), std::pmr::list<int>({1, 3, 5}));
+    TEST(filter<std::pmr::set>(doubled, [] (int x) { return x > 4; }).get_allocator().resource(), &arena);
+    TEST(reject(&arena, vectorNumbers, isOdd), std::pmr::vector<int>({2, 4}));
+    TEST(range<std::pmr::vector>(&arena, 5).get_allocator().resource(), &arena);
+    
+    std::pmr::vector<std::pmr::vector<int> > nested(&arena);
+    nested.push_back(std::pmr::vector<int>({1, 2}));
+    nested.push_back(std::pmr::vector<int>({3}));
+    TEST(flatten(nested), std::pmr::vector<int>({1, 2, 3}));
+    TEST(flatten(nested).get_allocator().resource(), &arena);
 }
 
+void testArray()
+{
+    // Declaring these constexpr makes sure they're computed at compile time.
+    constexpr std::array<int, 6> shuffled = {5, 3, 9, 1, 4, 1};
+    constexpr auto squares = mapRange<5>([] (int x) { return x*x; });
+    constexpr auto ascending = sorted(shuffled);
+    constexpr auto descending = sorted(shuffled, [] (int a, int b) { return a > b; });
+    constexpr auto evens = filter(shuffled, [] (int x) { return (x%2) == 0; });
+    constexpr auto odds = reject(shuffled, [] (int x) { return (x%2) == 0; });
+    constexpr int total = sum(shuffled);
+    constexpr int product = reduce(shuffled, [] (int a, int b) { return a*b; });
+    constexpr int smallest = min(shuffled);
+    constexpr int largest = max(shuffled);
+    
+    TEST(range<5>(), (std::array<int, 5>({0, 1, 2, 3, 4})));
+    TEST(range<3>(10, 5), (std::array<int, 3>({10, 15, 20})));
+    TEST(squares, (std::array<int, 5>({0, 1, 4, 9, 16})));
+    TEST(::map(shuffled, [] (int x) { return x*2; }), (std::array<int, 6>({10, 6, 18, 2, 8, 2})));
+    TEST(ascending, (std::array<int, 6>({1, 1, 3, 4, 5, 9})));
+    TEST(descending, (std::array<int, 6>({9, 5, 4, 3, 1, 1})));
+    TEST(evens.size(), size_t(1));
+    TEST(evens[0], 4);
+    TEST(vector<int>(odds.begin(), odds.end()), vector<int>({5, 3, 9, 1, 1}));
+    TEST(total, 23);
+    TEST(sum(shuffled, 10), 33);
+    TEST(product, 540);
+    TEST(reduce(shuffled, [] (int memo, int x) { return memo + (x%2); }, 0), 5);
+    TEST(smallest, 1);
+    TEST(largest, 9);
+    TEST(min(std::array<int, 0>()), 0);
+    
+    const std::array<Foo, 3> foos = {fooC, fooA, fooB};
+    TEST(::map(foos, &Foo::getValue), (std::array<int, 3>({3, 1, 2})));
+    TEST(filter(foos, &Foo::isEven).size(), size_t(1));
+    TEST(sorted(foos), (std::array<Foo, 3>({fooA, fooB, fooC})));
+    TEST(max(foos, &Foo::getValue), fooC);
+}
+
+#endif
+
 #ifdef Q_OS_MAC
 
 void testCFArray()
@@ -859,23 +1689,45 @@ int main()
     testMap();
     testFilter();
     testReject();
+    testPartition();
+    testGroupBy();
     testAllOf();
     testAnyOf();
     testExtremum();
     testMin();
     testMax();
+    testMinNMaxN();
     testReduce();
     testSum();
     testCompr();
+    testAggregate();
     testSorted();
+    testSortedBy();
     testContains();
     testOmit();
+    testIntersect();
+    testUnionOf();
+    testDifference();
     testReversed();
     testFirst();
     testLast();
     testRange();
     testMapRange();
     testFlatten();
+    testFlatMap();
+    testInto();
+    testView();
+    testZip();
+    testChunked();
+    testSmallVector();
+#ifdef FUNC_HELPERS_PROFILE
+    testProfile();
+#endif
+    testParallel();
+#if __cplusplus >= 201703L
+    testPmr();
+    testArray();
+#endif
 #ifdef Q_OS_MAC
     testCFArray();
 #endif
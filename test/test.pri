@@ -0,0 +1,24 @@
+QT += core
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += $$PWD/main.cpp
+HEADERS += ../functionalHelpers.h \
+           ../qtFunctionalHelpers.h \
+           ../parallelFunctionalHelpers.h \
+           ../pmrFunctionalHelpers.h \
+           ../arrayFunctionalHelpers.h \
+           ../CFTypeFunctionalHelpers.h
+INCLUDEPATH += ..
+
+# Each configuration builds main.cpp separately
+OBJECTS_DIR = $$TARGET
+MOC_DIR = $$TARGET
+
+macx {
+    LIBS += -framework CoreServices
+}
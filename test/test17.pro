@@ -0,0 +1,6 @@
+# Also runs the tests of pmrFunctionalHelpers.h and arrayFunctionalHelpers.h
+CONFIG += c++17
+
+TARGET = cpp-functional-helpers-test17
+
+include(test.pri)
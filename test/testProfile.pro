@@ -0,0 +1,7 @@
+# Runs the tests with FUNC_HELPERS_PROFILE counting calls to each helper
+CONFIG += c++11
+DEFINES += FUNC_HELPERS_PROFILE
+
+TARGET = cpp-functional-helpers-test-profile
+
+include(test.pri)
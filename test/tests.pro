@@ -0,0 +1,5 @@
+# Builds the tests in every configuration
+TEMPLATE = subdirs
+SUBDIRS = test.pro \
+          test17.pro \
+          testProfile.pro